@@ -0,0 +1,833 @@
+/*=============================================================================
+//  --- Airway Segmenter ---+
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+=============================================================================*/
+
+// Times the stages of the airway pipeline on synthetic phantoms of
+// increasing resolution, so that speedups and regressions can be
+// measured without patient data. Each case is run several times and
+// the minimum and median wall times are written as one CSV row; two
+// result files can be compared with CompareBenchmarks.py.
+//
+// The fast paths are also checked against their references on each
+// phantom: the matrix-free and multigrid solutions against the
+// assembled one, the threaded contours against the contours of one
+// thread, and the locator cuts against vtkCutter. The benchmark fails
+// if any of them differ.
+
+// Local includes
+#include "AirwayPhantom.h"
+#include "CrossSectionCutter.h"
+#include "CrossSectionSweep.h"
+#include "HeatFlowImageContourer.h"
+#include "LBMNoseSphere.h"
+#include "Profiler.h"
+#include "vtkPlaneCutLocator.h"
+
+#include "itkAirwayLaplaceBoundaryImageFilter.h"
+#include "itkAirwayLaplaceSolutionFilter.h"
+#include "itkLaplaceEquationSolverImageFilter.h"
+
+#include <itkAutoCropImageFilter.h>
+#include <itkImage.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionIterator.h>
+#include <itkImageToVTKImageFilter.h>
+#include <itkMultiThreader.h>
+
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkCutter.h>
+#include <vtkDiscreteMarchingCubes.h>
+#include <vtkIdTypeArray.h>
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkPlane.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+  typedef AirwayPhantom::ImageType          LabelImageType;
+  typedef itk::Image<float, 3>              SolutionImageType;
+
+  typedef itk::AutoCropImageFilter<LabelImageType, LabelImageType>           CropFilterType;
+  typedef itk::AirwayLaplaceBoundaryImageFilter<LabelImageType>              BoundaryFilterType;
+  typedef itk::LaplaceEquationSolverImageFilter<LabelImageType, SolutionImageType> SolverFilterType;
+  typedef itk::AirwayLaplaceSolutionFilter<LabelImageType, SolutionImageType> AirwayFilterType;
+
+  // Largest difference allowed between the solutions of two solvers.
+  // They stop at a relative residual of the float epsilon, which
+  // bounds their errors by about 1e-3 on the default phantom.
+  const double SolutionTolerance = 1e-3;
+
+  // Largest relative difference allowed between the lengths of two
+  // cuts, which only differ by rounding
+  const double CutLengthTolerance = 1e-9;
+
+  // Number of planes the locator cuts are checked on
+  const int NumberOfCheckedPlanes = 20;
+
+  /*******************************************************************/
+  /** Settings from the command line. */
+  /*******************************************************************/
+  struct BenchmarkOptions
+  {
+    std::string         OutputFile;
+    int                 Repetitions;
+    int                 NumberOfThreads;
+    int                 NumberOfContours;
+    std::vector<double> Spacings;
+    double              Length;
+    double              Radius;
+    double              Constriction;
+    bool                Bifurcation;
+  };
+
+  /*******************************************************************/
+  /** Wall times of the repetitions of one case and what it worked
+   *  on. Work is the size of the problem the case solves: unknowns,
+   *  triangles cut, and so on. */
+  /*******************************************************************/
+  struct BenchmarkResult
+  {
+    std::string         Benchmark;
+    std::string         Variant;
+    std::string         Phantom;
+    double              Spacing;
+    double              Voxels;
+    double              Work;
+    double              Iterations;
+    std::vector<double> Times;
+
+    // Peak resident set size of the process after the case
+    double              PeakResidentSetSize;
+  };
+
+  /*******************************************************************
+   ** Print the usage.
+   *******************************************************************/
+  void PrintUsage(const char* executable)
+  {
+    std::cerr << "Usage: " << executable << " [options]\n"
+              << "  --output <file>          CSV file of the results (default: benchmark.csv)\n"
+              << "  --repetitions <n>        Runs of each case (default: 3)\n"
+              << "  --threads <n>            Number of threads, 0 for the ITK default (default: 0)\n"
+              << "  --contours <n>           Number of heat flow contours (default: 100)\n"
+              << "  --spacings <s1,s2,...>   Voxel spacings in mm (default: 1,0.7,0.5)\n"
+              << "  --length <mm>            Airway length (default: 120)\n"
+              << "  --radius <mm>            Airway radius at the ends (default: 6)\n"
+              << "  --constriction <f>       Fraction of the radius removed halfway (default: 0.5)\n"
+              << "  --bifurcation            Split the upper third of the airway in two\n";
+  }
+
+  /*******************************************************************
+   ** Parse the command line. Returns false on unknown or incomplete
+   ** options.
+   *******************************************************************/
+  bool ParseOptions(int argc, char* argv[], BenchmarkOptions & options)
+  {
+    options.OutputFile = "benchmark.csv";
+    options.Repetitions = 3;
+    options.NumberOfThreads = 0;
+    options.NumberOfContours = 100;
+    options.Spacings.clear();
+    options.Length = 120.0;
+    options.Radius = 6.0;
+    options.Constriction = 0.5;
+    options.Bifurcation = false;
+
+    std::string spacings("1,0.7,0.5");
+    for (int i = 1; i < argc; ++i)
+      {
+      std::string option(argv[i]);
+      if (option == "--bifurcation")
+        {
+        options.Bifurcation = true;
+        continue;
+        }
+      if (i + 1 >= argc)
+        {
+        return false;
+        }
+
+      const char* value = argv[++i];
+      if (option == "--output")
+        {
+        options.OutputFile = value;
+        }
+      else if (option == "--repetitions")
+        {
+        options.Repetitions = atoi(value);
+        }
+      else if (option == "--threads")
+        {
+        options.NumberOfThreads = atoi(value);
+        }
+      else if (option == "--contours")
+        {
+        options.NumberOfContours = atoi(value);
+        }
+      else if (option == "--spacings")
+        {
+        spacings = value;
+        }
+      else if (option == "--length")
+        {
+        options.Length = atof(value);
+        }
+      else if (option == "--radius")
+        {
+        options.Radius = atof(value);
+        }
+      else if (option == "--constriction")
+        {
+        options.Constriction = atof(value);
+        }
+      else
+        {
+        return false;
+        }
+      }
+
+    std::istringstream spacingStream(spacings);
+    std::string spacing;
+    while (std::getline(spacingStream, spacing, ','))
+      {
+      if (atof(spacing.c_str()) > 0.0)
+        {
+        options.Spacings.push_back(atof(spacing.c_str()));
+        }
+      }
+
+    return options.Repetitions > 0 && options.NumberOfContours > 1 &&
+      !options.Spacings.empty() && options.Length > 0.0 && options.Radius > 0.0 &&
+      options.Constriction >= 0.0 && options.Constriction < 1.0;
+  }
+
+  /*******************************************************************/
+  /** Start a result for a case run on the phantom. */
+  /*******************************************************************/
+  BenchmarkResult StartResult(const std::string & benchmark,
+                              const std::string & variant,
+                              const AirwayPhantom & phantom)
+  {
+    BenchmarkResult result;
+    result.Benchmark = benchmark;
+    result.Variant = variant;
+    result.Phantom = phantom.GetDescription();
+    result.Spacing = phantom.GetSpacing();
+    result.Voxels = phantom.GetLabelImage()->GetLargestPossibleRegion().GetNumberOfPixels();
+    result.Work = 0.0;
+    result.Iterations = 0.0;
+    result.PeakResidentSetSize = 0.0;
+    return result;
+  }
+
+  /*******************************************************************/
+  /** Record the peak memory of a finished case, print a summary and
+   *  add it to the results. */
+  /*******************************************************************/
+  void FinishResult(BenchmarkResult & result, std::vector<BenchmarkResult> & results)
+  {
+    result.PeakResidentSetSize = Profiler::GetPeakResidentSetSize();
+    std::sort(result.Times.begin(), result.Times.end());
+
+    std::cout << result.Benchmark;
+    if (!result.Variant.empty())
+      {
+      std::cout << " (" << result.Variant << ")";
+      }
+    std::cout << " on " << result.Phantom << " at " << result.Spacing << " mm: "
+              << "min " << result.Times.front() << " s, "
+              << "median " << result.Times[result.Times.size() / 2] << " s" << std::endl;
+
+    results.push_back(result);
+  }
+
+  /*******************************************************************/
+  /** Report whether a fast path matches its reference on the phantom.
+   *  Returns matches. */
+  /*******************************************************************/
+  bool ReportCheck(const std::string & check, const AirwayPhantom & phantom, bool matches)
+  {
+    std::cout << "Check " << check << " on " << phantom.GetDescription() << " at "
+              << phantom.GetSpacing() << " mm: " << (matches ? "passed" : "FAILED")
+              << std::endl;
+    return matches;
+  }
+
+  /*******************************************************************/
+  /** Largest absolute difference between two solutions. Returns -1
+   *  if they are not defined on the same voxels. */
+  /*******************************************************************/
+  double MaximumDifference(const SolutionImageType* a, const SolutionImageType* b)
+  {
+    if (a->GetBufferedRegion() != b->GetBufferedRegion())
+      {
+      return -1.0;
+      }
+
+    typedef itk::ImageRegionConstIterator<SolutionImageType> IteratorType;
+    IteratorType aIt(a, a->GetBufferedRegion());
+    IteratorType bIt(b, b->GetBufferedRegion());
+
+    double maximum = 0.0;
+    for (; !aIt.IsAtEnd(); ++aIt, ++bIt)
+      {
+      double aValue = aIt.Get();
+      double bValue = bIt.Get();
+
+      // Both are NaN outside the solution domain
+      bool aDefined = aValue == aValue;
+      bool bDefined = bValue == bValue;
+      if (aDefined != bDefined)
+        {
+        return -1.0;
+        }
+      if (aDefined)
+        {
+        maximum = std::max(maximum, std::abs(aValue - bValue));
+        }
+      }
+
+    return maximum;
+  }
+
+  /*******************************************************************/
+  /** Crop the label image to the airway as AirwayLaplaceSolutionFilter
+   *  does. */
+  /*******************************************************************/
+  LabelImageType::Pointer CropLabelImage(const AirwayPhantom & phantom)
+  {
+    LabelImageType::SizeType padRadius;
+    padRadius.Fill(1);
+
+    CropFilterType::Pointer cropFilter = CropFilterType::New();
+    cropFilter->SetInput(phantom.GetLabelImage());
+    cropFilter->SetBackgroundValue(0);
+    cropFilter->SetPadRadius(padRadius);
+    cropFilter->Update();
+
+    LabelImageType::Pointer cropped = cropFilter->GetOutput();
+    cropped->DisconnectPipeline();
+    return cropped;
+  }
+
+  /*******************************************************************/
+  /** Time AutoCropImageFilter on the label image. */
+  /*******************************************************************/
+  void BenchmarkAutoCrop(const AirwayPhantom & phantom, const BenchmarkOptions & options,
+                         std::vector<BenchmarkResult> & results)
+  {
+    BenchmarkResult result = StartResult("AutoCropImageFilter", "", phantom);
+    for (int repetition = 0; repetition < options.Repetitions; ++repetition)
+      {
+      double start = Profiler::GetTime();
+      LabelImageType::Pointer cropped = CropLabelImage(phantom);
+      result.Times.push_back(Profiler::GetTime() - start);
+
+      result.Work = cropped->GetLargestPossibleRegion().GetNumberOfPixels();
+      }
+    FinishResult(result, results);
+  }
+
+  /*******************************************************************/
+  /** Time AddNoseSphere on the LBM labels of the phantom: 0 in the
+   *  airway and -1 elsewhere, as in ComputeLBMBoundaries. */
+  /*******************************************************************/
+  void BenchmarkNoseSphere(const AirwayPhantom & phantom, const BenchmarkOptions & options,
+                           std::vector<BenchmarkResult> & results)
+  {
+    const short INTERIOR = 0;
+    const short EXTERIOR = -1;
+    const short INFLOW = 100;
+    const double airThreshold = -250.0;
+
+    LabelImageType* labelImage = phantom.GetLabelImage();
+    LabelImageType::RegionType region = labelImage->GetLargestPossibleRegion();
+
+    BenchmarkResult result = StartResult("AddNoseSphere", "", phantom);
+    result.Work = GetNoseSphereRegion(phantom.GetNoseSphereCenter(),
+                                      phantom.GetNoseSphereRadius(),
+                                      labelImage).GetNumberOfPixels();
+    for (int repetition = 0; repetition < options.Repetitions; ++repetition)
+      {
+      // The sphere is added in place, so each run starts from fresh
+      // labels
+      LabelImageType::Pointer binaryImage = LabelImageType::New();
+      binaryImage->CopyInformation(labelImage);
+      binaryImage->SetRegions(region);
+      binaryImage->Allocate();
+
+      itk::ImageRegionConstIterator<LabelImageType> labelIt(labelImage, region);
+      itk::ImageRegionIterator<LabelImageType> binaryIt(binaryImage, region);
+      for (; !labelIt.IsAtEnd(); ++labelIt, ++binaryIt)
+        {
+        binaryIt.Set(labelIt.Get() ? INTERIOR : EXTERIOR);
+        }
+
+      double start = Profiler::GetTime();
+      AddNoseSphere(phantom.GetNoseSphereCenter(), phantom.GetNoseSphereRadius(),
+                    binaryImage.GetPointer(), phantom.GetCTImage(), airThreshold,
+                    INTERIOR, EXTERIOR, INFLOW);
+      result.Times.push_back(Profiler::GetTime() - start);
+      }
+    FinishResult(result, results);
+  }
+
+  /*******************************************************************/
+  /** Time each solver of LaplaceEquationSolverImageFilter on the
+   *  boundary conditions AirwayLaplaceSolutionFilter sets up. Returns
+   *  whether the matrix-free and multigrid solutions match the
+   *  assembled one. */
+  /*******************************************************************/
+  bool BenchmarkLaplaceSolvers(const AirwayPhantom & phantom, const BenchmarkOptions & options,
+                               std::vector<BenchmarkResult> & results)
+  {
+    BoundaryFilterType::Pointer boundaryFilter = BoundaryFilterType::New();
+    boundaryFilter->SetInput(CropLabelImage(phantom));
+    boundaryFilter->SetNasalPoint(phantom.GetNosePoint());
+    boundaryFilter->SetNasalVector(phantom.GetNoseVector());
+    boundaryFilter->SetTracheaPoint(phantom.GetTracheaPoint());
+    boundaryFilter->SetTracheaVector(phantom.GetTracheaVector());
+    boundaryFilter->Update();
+
+    const SolverFilterType::SolverType solvers[3] = {
+      SolverFilterType::ASSEMBLED_CONJUGATE_GRADIENT,
+      SolverFilterType::MATRIX_FREE_CONJUGATE_GRADIENT,
+      SolverFilterType::MULTIGRID_CONJUGATE_GRADIENT };
+    const char* solverNames[3] = { "assembled", "matrixfree", "multigrid" };
+    SolutionImageType::Pointer solutions[3];
+
+    for (int s = 0; s < 3; ++s)
+      {
+      BenchmarkResult result = StartResult("LaplaceEquationSolverImageFilter",
+                                           solverNames[s], phantom);
+      for (int repetition = 0; repetition < options.Repetitions; ++repetition)
+        {
+        SolverFilterType::Pointer solverFilter = SolverFilterType::New();
+        solverFilter->SetInput(boundaryFilter->GetOutput());
+        solverFilter->SetSolver(solvers[s]);
+        solverFilter->SetSolutionLabel(11);
+        solverFilter->SetNeumannBoundaryConditionLabel(6);
+        solverFilter->AddDirichletBoundaryCondition(4, 0.0);
+        solverFilter->AddDirichletBoundaryCondition(5, 1.0);
+
+        double start = Profiler::GetTime();
+        solverFilter->Update();
+        result.Times.push_back(Profiler::GetTime() - start);
+
+        result.Work = solverFilter->GetNumberOfUnknowns();
+        result.Iterations = solverFilter->GetCurrentIteration();
+        solutions[s] = solverFilter->GetOutput();
+        solutions[s]->DisconnectPipeline();
+        }
+      FinishResult(result, results);
+      }
+
+    bool matches = true;
+    for (int s = 1; s < 3; ++s)
+      {
+      double difference = MaximumDifference(solutions[0], solutions[s]);
+      std::cout << solverNames[s] << " solution differs from the assembled one by "
+                << difference << std::endl;
+      matches &= ReportCheck(std::string(solverNames[s]) + " solution", phantom,
+                             difference >= 0.0 && difference <= SolutionTolerance);
+      }
+    return matches;
+  }
+
+  /*******************************************************************/
+  /** Time the whole AirwayLaplaceSolutionFilter with its default
+   *  solver and return the last solution. */
+  /*******************************************************************/
+  SolutionImageType::Pointer BenchmarkAirwayLaplaceSolution(const AirwayPhantom & phantom,
+                                                            const BenchmarkOptions & options,
+                                                            std::vector<BenchmarkResult> & results)
+  {
+    SolutionImageType::Pointer solution;
+    BenchmarkResult result = StartResult("AirwayLaplaceSolutionFilter", "", phantom);
+    for (int repetition = 0; repetition < options.Repetitions; ++repetition)
+      {
+      AirwayFilterType::Pointer airwayFilter = AirwayFilterType::New();
+      airwayFilter->SetInput(phantom.GetLabelImage());
+      airwayFilter->SetNosePoint(phantom.GetNosePoint());
+      airwayFilter->SetNoseVector(phantom.GetNoseVector());
+      airwayFilter->SetTrachPoint(phantom.GetTracheaPoint());
+      airwayFilter->SetTrachVector(phantom.GetTracheaVector());
+
+      double start = Profiler::GetTime();
+      airwayFilter->Update();
+      result.Times.push_back(Profiler::GetTime() - start);
+
+      result.Work = airwayFilter->GetNumberOfUnknowns();
+      result.Iterations = airwayFilter->GetCurrentIteration();
+      solution = airwayFilter->GetOutput();
+      solution->DisconnectPipeline();
+      }
+    FinishResult(result, results);
+    return solution;
+  }
+
+  /*******************************************************************/
+  /** Whether two poly data have the same points and polygons. */
+  /*******************************************************************/
+  bool HaveSamePolygons(vtkPolyData* a, vtkPolyData* b)
+  {
+    if (a->GetNumberOfPoints() != b->GetNumberOfPoints() ||
+        a->GetNumberOfPolys() != b->GetNumberOfPolys())
+      {
+      return false;
+      }
+
+    for (vtkIdType ptId = 0; ptId < a->GetNumberOfPoints(); ++ptId)
+      {
+      double aPoint[3], bPoint[3];
+      a->GetPoint(ptId, aPoint);
+      b->GetPoint(ptId, bPoint);
+      if (aPoint[0] != bPoint[0] || aPoint[1] != bPoint[1] || aPoint[2] != bPoint[2])
+        {
+        return false;
+        }
+      }
+
+    vtkIdTypeArray* aCells = a->GetPolys()->GetData();
+    vtkIdTypeArray* bCells = b->GetPolys()->GetData();
+    if (aCells->GetNumberOfTuples() != bCells->GetNumberOfTuples())
+      {
+      return false;
+      }
+    for (vtkIdType i = 0; i < aCells->GetNumberOfTuples(); ++i)
+      {
+      if (aCells->GetValue(i) != bCells->GetValue(i))
+        {
+        return false;
+        }
+      }
+
+    return true;
+  }
+
+  /*******************************************************************/
+  /** Time HeatFlowImageContourer on the Laplace solution with
+   *  uniformly spaced values and return the last contours. matches
+   *  is set to whether they are the contours of a single thread. */
+  /*******************************************************************/
+  vtkSmartPointer<vtkPolyData> BenchmarkHeatFlowContours(const AirwayPhantom & phantom,
+                                                         SolutionImageType* solution,
+                                                         const BenchmarkOptions & options,
+                                                         std::vector<BenchmarkResult> & results,
+                                                         bool & matches)
+  {
+    typedef itk::ImageToVTKImageFilter<SolutionImageType> ConnectorType;
+    ConnectorType::Pointer connector = ConnectorType::New();
+    connector->SetInput(solution);
+    connector->Update();
+
+    std::vector<double> values(options.NumberOfContours);
+    for (int i = 0; i < options.NumberOfContours; ++i)
+      {
+      values[i] = static_cast<double>(i) / (options.NumberOfContours - 1);
+      }
+
+    vtkSmartPointer<vtkPolyData> contours;
+    BenchmarkResult result = StartResult("HeatFlowImageContourer", "", phantom);
+    for (int repetition = 0; repetition < options.Repetitions; ++repetition)
+      {
+      contours = vtkSmartPointer<vtkPolyData>::New();
+
+      double start = Profiler::GetTime();
+      HeatFlowImageContourer contourer;
+      contourer.SetNumberOfThreads(options.NumberOfThreads);
+      if (!contourer.SetInput(connector->GetOutput()))
+        {
+        std::cerr << "Could not contour the Laplace solution\n";
+        return NULL;
+        }
+      contourer.Contour(values, contours);
+      result.Times.push_back(Profiler::GetTime() - start);
+
+      result.Work = contours->GetNumberOfCells();
+      }
+    FinishResult(result, results);
+
+    vtkSmartPointer<vtkPolyData> reference = vtkSmartPointer<vtkPolyData>::New();
+    HeatFlowImageContourer contourer;
+    contourer.SetNumberOfThreads(1);
+    contourer.SetInput(connector->GetOutput());
+    contourer.Contour(values, reference);
+    matches = ReportCheck("threaded contours", phantom, HaveSamePolygons(contours, reference));
+
+    return contours;
+  }
+
+  /*******************************************************************/
+  /** Extract the airway surface from the label image, in the same
+   *  LPS coordinates as the contours. */
+  /*******************************************************************/
+  vtkSmartPointer<vtkPolyData> ExtractSurface(const AirwayPhantom & phantom)
+  {
+    typedef itk::ImageToVTKImageFilter<LabelImageType> ConnectorType;
+    ConnectorType::Pointer connector = ConnectorType::New();
+    connector->SetInput(phantom.GetLabelImage());
+    connector->Update();
+
+    vtkSmartPointer<vtkDiscreteMarchingCubes> marchingCubes =
+      vtkSmartPointer<vtkDiscreteMarchingCubes>::New();
+    marchingCubes->SetInputData(connector->GetOutput());
+    marchingCubes->SetValue(0, 1);
+    marchingCubes->Update();
+
+    vtkSmartPointer<vtkPolyData> surface = vtkSmartPointer<vtkPolyData>::New();
+    surface->ShallowCopy(marchingCubes->GetOutput());
+    return surface;
+  }
+
+  /*******************************************************************/
+  /** Total length of the line segments of a cut. */
+  /*******************************************************************/
+  double ComputeLength(vtkPolyData* cut)
+  {
+    double length = 0.0;
+    vtkCellArray* lines = cut->GetLines();
+    vtkIdType npts;
+    vtkIdType* pts;
+    for (lines->InitTraversal(); lines->GetNextCell(npts, pts); )
+      {
+      for (vtkIdType i = 0; i + 1 < npts; ++i)
+        {
+        double a[3], b[3];
+        cut->GetPoint(pts[i], a);
+        cut->GetPoint(pts[i + 1], b);
+        length += std::sqrt(vtkMath::Distance2BetweenPoints(a, b));
+        }
+      }
+    return length;
+  }
+
+  /*******************************************************************/
+  /** Cut the surface along the airway with CrossSectionCutter and the
+   *  locator and with vtkCutter. Returns whether the cuts have the
+   *  same number of segments and the same length. */
+  /*******************************************************************/
+  bool CheckCuts(const AirwayPhantom & phantom, vtkPolyData* surface,
+                 const vtkPlaneCutLocator* surfaceLocator)
+  {
+    double bounds[6];
+    surface->GetBounds(bounds);
+
+    // Tilted planes, so that the cuts do not pass through the surface
+    // points of the marching cubes
+    double normal[3] = { 0.1, 0.2, 1.0 };
+    std::vector<double> origins(3 * NumberOfCheckedPlanes);
+    CrossSectionCutter cutter;
+    cutter.SetSurface(surface, surfaceLocator);
+    for (int p = 0; p < NumberOfCheckedPlanes; ++p)
+      {
+      double* origin = &origins[3 * p];
+      origin[0] = 0.5 * (bounds[0] + bounds[1]);
+      origin[1] = 0.5 * (bounds[2] + bounds[3]);
+      origin[2] = bounds[4] + (p + 0.5) * (bounds[5] - bounds[4]) / NumberOfCheckedPlanes;
+      cutter.AddPlane(origin, normal);
+      }
+    std::vector< vtkSmartPointer<vtkPolyData> > cuts;
+    cutter.Cut(cuts);
+
+    bool matches = true;
+    for (int p = 0; p < NumberOfCheckedPlanes; ++p)
+      {
+      vtkSmartPointer<vtkPlane> plane = vtkSmartPointer<vtkPlane>::New();
+      plane->SetOrigin(&origins[3 * p]);
+      plane->SetNormal(normal);
+
+      vtkSmartPointer<vtkCutter> referenceCutter = vtkSmartPointer<vtkCutter>::New();
+      referenceCutter->SetInputData(surface);
+      referenceCutter->SetCutFunction(plane);
+      referenceCutter->Update();
+      vtkPolyData* reference = referenceCutter->GetOutput();
+
+      double length = ComputeLength(cuts[p]);
+      double referenceLength = ComputeLength(reference);
+      if (cuts[p]->GetNumberOfLines() != reference->GetNumberOfLines() ||
+          std::abs(length - referenceLength) > CutLengthTolerance * referenceLength)
+        {
+        std::cout << "Plane " << p << ": " << cuts[p]->GetNumberOfLines()
+                  << " segments of length " << length << ", vtkCutter "
+                  << reference->GetNumberOfLines() << " segments of length "
+                  << referenceLength << std::endl;
+        matches = false;
+        }
+      }
+
+    return ReportCheck("locator cuts", phantom, matches);
+  }
+
+  /*******************************************************************/
+  /** Time the cross-section loop of ComputeCrossSections on the heat
+   *  flow contours and the airway surface of the phantom, without
+   *  reading or writing files: locate the surface, bucket the contour
+   *  cells and sweep the contours with CrossSectionSweep. Returns
+   *  whether the cuts of the locator match those of vtkCutter. */
+  /*******************************************************************/
+  bool BenchmarkCrossSections(const AirwayPhantom & phantom, vtkPolyData* contours,
+                              const BenchmarkOptions & options,
+                              std::vector<BenchmarkResult> & results)
+  {
+    vtkSmartPointer<vtkPolyData> surface = ExtractSurface(phantom);
+    vtkIdTypeArray* contourIDs = vtkIdTypeArray::SafeDownCast(
+      contours->GetCellData()->GetArray("contour ID"));
+
+    vtkSmartPointer<vtkPlaneCutLocator> surfaceLocator;
+    BenchmarkResult result = StartResult("ComputeCrossSections", "", phantom);
+    for (int repetition = 0; repetition < options.Repetitions; ++repetition)
+      {
+      double start = Profiler::GetTime();
+
+      surfaceLocator = vtkSmartPointer<vtkPlaneCutLocator>::New();
+      surfaceLocator->SetDataSet(surface);
+      surfaceLocator->BuildLocator();
+
+      std::vector<vtkIdType> valueIndices;
+      std::vector< std::vector<vtkIdType> > contourCells;
+      CrossSectionSweep::BucketCellsByContour(contourIDs, options.NumberOfContours,
+                                              valueIndices, contourCells);
+
+      CrossSectionSweep sweep;
+      sweep.SetContours(contours, &contourCells);
+      sweep.SetSurface(surface, surfaceLocator);
+      sweep.SetNumberOfThreads(options.NumberOfThreads);
+      std::vector<CrossSectionSweep::Measures> measures;
+      sweep.Run(measures);
+
+      result.Times.push_back(Profiler::GetTime() - start);
+      result.Work = sweep.GetNumberOfCutTriangles();
+      }
+    FinishResult(result, results);
+
+    return CheckCuts(phantom, surface, surfaceLocator);
+  }
+
+  /*******************************************************************/
+  /** Write the results as CSV, one row per case. */
+  /*******************************************************************/
+  bool WriteResults(const std::string & fileName, const std::vector<BenchmarkResult> & results)
+  {
+    std::ofstream file(fileName.c_str());
+    if (!file)
+      {
+      return false;
+      }
+
+    file.precision(9);
+    file << "benchmark,variant,phantom,spacing,voxels,work,iterations,"
+         << "repetitions,minimum,median,peakResidentSetSize\n";
+    for (size_t i = 0; i < results.size(); ++i)
+      {
+      const BenchmarkResult & result = results[i];
+      file << result.Benchmark << ","
+           << result.Variant << ","
+           << result.Phantom << ","
+           << result.Spacing << ","
+           << result.Voxels << ","
+           << result.Work << ","
+           << result.Iterations << ","
+           << result.Times.size() << ","
+           << result.Times.front() << ","
+           << result.Times[result.Times.size() / 2] << ","
+           << result.PeakResidentSetSize << "\n";
+      }
+    return static_cast<bool>(file);
+  }
+
+} // end anonymous namespace
+
+
+/*******************************************************************/
+/* Main function                                                   */
+/*******************************************************************/
+int main(int argc, char* argv[])
+{
+  BenchmarkOptions options;
+  if (!ParseOptions(argc, argv, options))
+    {
+    PrintUsage(argv[0]);
+    return EXIT_FAILURE;
+    }
+
+  if (options.NumberOfThreads > 0)
+    {
+    itk::MultiThreader::SetGlobalDefaultNumberOfThreads(options.NumberOfThreads);
+    }
+
+  // The cases run from the coarsest to the finest phantom, so the peak
+  // memory after a case is mostly that of the current phantom.
+  std::sort(options.Spacings.rbegin(), options.Spacings.rend());
+
+  std::vector<BenchmarkResult> results;
+  bool matches = true;
+  for (size_t i = 0; i < options.Spacings.size(); ++i)
+    {
+    AirwayPhantom phantom;
+    phantom.SetLength(options.Length);
+    phantom.SetRadius(options.Radius);
+    phantom.SetConstriction(options.Constriction);
+    phantom.SetBifurcation(options.Bifurcation);
+    phantom.SetSpacing(options.Spacings[i]);
+    phantom.Update();
+
+    std::cout << "Phantom " << phantom.GetDescription() << " at " << phantom.GetSpacing()
+              << " mm: " << phantom.GetLabelImage()->GetLargestPossibleRegion().GetSize()
+              << " voxels" << std::endl;
+
+    BenchmarkAutoCrop(phantom, options, results);
+    BenchmarkNoseSphere(phantom, options, results);
+    matches &= BenchmarkLaplaceSolvers(phantom, options, results);
+
+    SolutionImageType::Pointer solution =
+      BenchmarkAirwayLaplaceSolution(phantom, options, results);
+    bool contoursMatch = false;
+    vtkSmartPointer<vtkPolyData> contours =
+      BenchmarkHeatFlowContours(phantom, solution, options, results, contoursMatch);
+    if (!contours)
+      {
+      return EXIT_FAILURE;
+      }
+    matches &= contoursMatch;
+    matches &= BenchmarkCrossSections(phantom, contours, options, results);
+    }
+
+  if (!WriteResults(options.OutputFile, results))
+    {
+    std::cerr << "Could not write '" << options.OutputFile << "'\n";
+    return EXIT_FAILURE;
+    }
+
+  if (!matches)
+    {
+    std::cerr << "Some fast paths differ from their references\n";
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,176 @@
+#include "AirwayPhantom.h"
+
+#include <itkImageRegionIteratorWithIndex.h>
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace
+{
+  // Hounsfield units of the CT image
+  const short AirValue = -1000;
+  const short TissueValue = 40;
+
+  // Margin around the airway and the nose sphere in mm
+  const double Margin = 3.0;
+
+  // Distance of the boundary planes from the ends of the airway in mm
+  const double PlaneOffset = 5.0;
+}
+
+//----------------------------------------------------------------------------
+AirwayPhantom::AirwayPhantom()
+{
+  this->Length = 120.0;
+  this->Radius = 6.0;
+  this->Constriction = 0.5;
+  this->Bifurcation = false;
+  this->Spacing = 1.0;
+}
+
+//----------------------------------------------------------------------------
+AirwayPhantom::~AirwayPhantom()
+{
+}
+
+//----------------------------------------------------------------------------
+void AirwayPhantom::Update()
+{
+  double branchExtent = (this->Bifurcation ? 2.5 : 1.0) * this->Radius;
+  double halfWidth = std::max(branchExtent, this->GetNoseSphereRadius()) + Margin;
+  double top = this->Length + this->GetNoseSphereRadius() + Margin;
+
+  ImageType::PointType origin;
+  origin[0] = -halfWidth;
+  origin[1] = -halfWidth;
+  origin[2] = -Margin;
+
+  ImageType::SpacingType spacing;
+  spacing.Fill(this->Spacing);
+
+  ImageType::SizeType size;
+  size[0] = static_cast<ImageType::SizeValueType>(std::ceil(2.0 * halfWidth / this->Spacing)) + 1;
+  size[1] = size[0];
+  size[2] = static_cast<ImageType::SizeValueType>(std::ceil((top + Margin) / this->Spacing)) + 1;
+
+  ImageType::RegionType region;
+  region.SetSize(size);
+
+  this->LabelImage = ImageType::New();
+  this->LabelImage->SetRegions(region);
+  this->LabelImage->SetOrigin(origin);
+  this->LabelImage->SetSpacing(spacing);
+  this->LabelImage->Allocate();
+
+  this->CTImage = ImageType::New();
+  this->CTImage->CopyInformation(this->LabelImage);
+  this->CTImage->SetRegions(region);
+  this->CTImage->Allocate();
+
+  typedef itk::ImageRegionIteratorWithIndex<ImageType> IteratorType;
+  IteratorType labelIt(this->LabelImage, region);
+  IteratorType ctIt(this->CTImage, region);
+  for (; !labelIt.IsAtEnd(); ++labelIt, ++ctIt)
+    {
+    const ImageType::IndexType & index = labelIt.GetIndex();
+    double x = origin[0] + this->Spacing * index[0];
+    double y = origin[1] + this->Spacing * index[1];
+    double z = origin[2] + this->Spacing * index[2];
+
+    bool inside = this->IsInside(x, y, z);
+    labelIt.Set(inside ? 1 : 0);
+    ctIt.Set(inside || z > this->Length ? AirValue : TissueValue);
+    }
+}
+
+//----------------------------------------------------------------------------
+bool AirwayPhantom::IsInside(double x, double y, double z) const
+{
+  if (z < 0.0 || z > this->Length)
+    {
+    return false;
+    }
+
+  double width = 0.1 * this->Length;
+  double u = (z - 0.5 * this->Length) / width;
+  double radius = this->Radius * (1.0 - this->Constriction * std::exp(-0.5 * u * u));
+
+  double split = 2.0 * this->Length / 3.0;
+  if (!this->Bifurcation || z <= split)
+    {
+    return x * x + y * y <= radius * radius;
+    }
+
+  // Branches diverge linearly from the split to the nose
+  double t = (z - split) / (this->Length - split);
+  double offset = 1.5 * this->Radius * t;
+  radius *= 1.0 - 0.25 * t;
+  double xLeft = x + offset;
+  double xRight = x - offset;
+  return xLeft * xLeft + y * y <= radius * radius ||
+         xRight * xRight + y * y <= radius * radius;
+}
+
+//----------------------------------------------------------------------------
+AirwayPhantom::PointType AirwayPhantom::GetNosePoint() const
+{
+  PointType point;
+  point[0] = 0.0;
+  point[1] = 0.0;
+  point[2] = this->Length - PlaneOffset;
+  return point;
+}
+
+//----------------------------------------------------------------------------
+AirwayPhantom::PointType AirwayPhantom::GetNoseVector() const
+{
+  PointType vector;
+  vector[0] = 0.0;
+  vector[1] = 0.0;
+  vector[2] = -1.0;
+  return vector;
+}
+
+//----------------------------------------------------------------------------
+AirwayPhantom::PointType AirwayPhantom::GetTracheaPoint() const
+{
+  PointType point;
+  point[0] = 0.0;
+  point[1] = 0.0;
+  point[2] = PlaneOffset;
+  return point;
+}
+
+//----------------------------------------------------------------------------
+AirwayPhantom::PointType AirwayPhantom::GetTracheaVector() const
+{
+  PointType vector;
+  vector[0] = 0.0;
+  vector[1] = 0.0;
+  vector[2] = 1.0;
+  return vector;
+}
+
+//----------------------------------------------------------------------------
+AirwayPhantom::PointType AirwayPhantom::GetNoseSphereCenter() const
+{
+  PointType center;
+  center[0] = 0.0;
+  center[1] = 0.0;
+  center[2] = this->Length;
+  return center;
+}
+
+//----------------------------------------------------------------------------
+std::string AirwayPhantom::GetDescription() const
+{
+  std::ostringstream description;
+  description << "L" << this->Length << "-R" << this->Radius
+              << "-C" << this->Constriction;
+  if (this->Bifurcation)
+    {
+    description << "-B";
+    }
+  return description.str();
+}
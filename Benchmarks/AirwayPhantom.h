@@ -0,0 +1,105 @@
+#ifndef AirwayPhantom_h
+#define AirwayPhantom_h
+
+#include <itkImage.h>
+
+#include <string>
+
+// Description:
+// Synthetic airway for benchmarks that run without patient data: a
+// tube along the z axis from the trachea at z = 0 to the nose at
+// z = Length, in LPS coordinates with an identity direction.
+//
+// The radius is Radius at both ends and narrows by the fraction
+// Constriction halfway, with a Gaussian profile a tenth of the length
+// wide. With Bifurcation on, the upper third splits into two
+// branches, like the nasal passages, that diverge to 1.5 Radius on
+// either side of the axis at the nose and thin to 3/4 of the radius.
+// The nose and trachea planes of AirwayLaplaceSolutionFilter cut
+// within 20 mm of their points, so Radius should stay below 8 mm when
+// the airway bifurcates.
+//
+// Two images are generated on a grid of the given isotropic spacing:
+// a label image, 1 in the airway and 0 elsewhere, and a CT image in
+// Hounsfield units, air in the airway and above the nose, outside the
+// face, and soft tissue elsewhere.
+class AirwayPhantom
+{
+public:
+  typedef itk::Image<short, 3> ImageType;
+  typedef ImageType::PointType PointType;
+
+  AirwayPhantom();
+  ~AirwayPhantom();
+
+  // Description:
+  // Set the length and end radius of the airway in mm. Default to 120
+  // and 6.
+  void SetLength(double length) { this->Length = length; }
+  double GetLength() const { return this->Length; }
+  void SetRadius(double radius) { this->Radius = radius; }
+  double GetRadius() const { return this->Radius; }
+
+  // Description:
+  // Set the fraction of the radius removed halfway along the airway,
+  // from 0 to less than 1. Defaults to 0.5.
+  void SetConstriction(double constriction) { this->Constriction = constriction; }
+  double GetConstriction() const { return this->Constriction; }
+
+  // Description:
+  // Set whether the upper third of the airway splits in two. Defaults
+  // to off.
+  void SetBifurcation(bool bifurcation) { this->Bifurcation = bifurcation; }
+  bool GetBifurcation() const { return this->Bifurcation; }
+
+  // Description:
+  // Set the voxel spacing in mm. Defaults to 1.
+  void SetSpacing(double spacing) { this->Spacing = spacing; }
+  double GetSpacing() const { return this->Spacing; }
+
+  // Description:
+  // Generate the images.
+  void Update();
+
+  ImageType* GetLabelImage() const { return this->LabelImage; }
+  ImageType* GetCTImage() const { return this->CTImage; }
+
+  // Description:
+  // Points and normals of the planes that cut the airway 5 mm from
+  // the nose and from the trachea end. The airway on the side the
+  // normal points to is kept, as AirwayLaplaceSolutionFilter expects.
+  PointType GetNosePoint() const;
+  PointType GetNoseVector() const;
+  PointType GetTracheaPoint() const;
+  PointType GetTracheaVector() const;
+
+  // Description:
+  // Center and radius of the ComputeLBMBoundaries nose sphere, where
+  // the airway leaves the face.
+  PointType GetNoseSphereCenter() const;
+  double GetNoseSphereRadius() const { return 2.0 * this->Radius; }
+
+  // Description:
+  // Short description of the shape for benchmark results, e.g.
+  // "L120-R6-C0.5-B" for a bifurcated airway.
+  std::string GetDescription() const;
+
+private:
+  AirwayPhantom(const AirwayPhantom&); // Not implemented
+  void operator=(const AirwayPhantom&); // Not implemented
+
+  // Description:
+  // Whether the point is in the airway.
+  bool IsInside(double x, double y, double z) const;
+
+  double Length;
+  double Radius;
+  double Constriction;
+  bool   Bifurcation;
+  double Spacing;
+
+  ImageType::Pointer LabelImage;
+  ImageType::Pointer CTImage;
+};
+
+#endif // AirwayPhantom_h
@@ -0,0 +1,59 @@
+import csv
+import sys
+
+# Median times that differ by less than this fraction are reported
+# as unchanged
+THRESHOLD = 0.05
+
+#############################################################################
+def ReadResults(path):
+    results = {}
+    with open(path) as csvFile:
+        for row in csv.DictReader(csvFile):
+            key = (row['benchmark'], row['variant'], row['phantom'], float(row['spacing']))
+            results[key] = row
+    return results
+
+#############################################################################
+def main():
+    if len(sys.argv) < 3:
+        sys.stderr.write('Usage: %s <baseline CSV file> <new CSV file>\n' % sys.argv[0])
+        sys.exit(-1)
+
+    baseline = ReadResults(sys.argv[1])
+    current  = ReadResults(sys.argv[2])
+
+    sys.stdout.write('%-34s %-10s %-18s %7s %10s %10s %8s\n' %
+                     ('benchmark', 'variant', 'phantom', 'spacing',
+                      'baseline', 'new', 'speedup'))
+
+    regressions = 0
+    for key in sorted(baseline.keys()):
+        if key not in current:
+            continue
+
+        before = float(baseline[key]['median'])
+        after  = float(current[key]['median'])
+        speedup = before / after if after > 0.0 else float('inf')
+
+        note = ''
+        if speedup < 1.0 - THRESHOLD:
+            note = 'slower'
+            regressions += 1
+        elif speedup > 1.0 + THRESHOLD:
+            note = 'faster'
+        if baseline[key]['work'] != current[key]['work'] or \
+           baseline[key]['iterations'] != current[key]['iterations']:
+            note += ' (work differs)'
+
+        sys.stdout.write('%-34s %-10s %-18s %7s %10.4f %10.4f %7.2fx %s\n' %
+                         (key[0], key[1], key[2], key[3], before, after, speedup, note))
+
+    for key in sorted(set(baseline.keys()) ^ set(current.keys())):
+        sys.stdout.write('%s %s %s %s: only in one file\n' % key)
+
+    sys.exit(1 if regressions > 0 else 0)
+
+#############################################################################
+if __name__ == '__main__':
+    main()
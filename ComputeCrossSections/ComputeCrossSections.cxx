@@ -18,48 +18,32 @@
 
 // Local includes
 #include "ComputeCrossSectionsCLP.h"
+#include "CrossSectionSweep.h"
+#include "CrossSectionWriter.h"
+#include "HeatFlowContours.h"
+#include "Profiler.h"
+#include "vtkPlaneCutLocator.h"
 
 #include <itkImage.h>
 #include <itkImageFileReader.h>
 #include <itkImageToVTKImageFilter.h>
 
-#include <vtkAppendPolyData.h>
-#include <vtkCellArray.h>
 #include <vtkCellData.h>
-#include <vtkCleanPolyData.h>
-#include <vtkConnectivityFilter.h>
-#include <vtkContourCompleter.h>
-#include <vtkContourFilter.h>
-#include <vtkContourTriangulator.h>
-#include <vtkCutter.h>
-#include <vtkDataSetSurfaceFilter.h>
+#include <vtkDataArray.h>
 #include <vtkDelimitedTextWriter.h>
 #include <vtkDoubleArray.h>
-#include <vtkFeatureEdges.h>
 #include <vtkFieldData.h>
-#include <vtkFloatArray.h>
-#include <vtkLine.h>
-#include <vtkMassProperties.h>
-#include <vtkPlane.h>
-#include <vtkPointData.h>
-#include <vtkPoints.h>
+#include <vtkIdTypeArray.h>
 #include <vtkPolyData.h>
 #include <vtkPolyDataReader.h>
-#include <vtkPolyDataConnectivityFilter.h>
-#include <vtkPolyLine.h>
 #include <vtkSmartPointer.h>
-#include <vtkStripper.h>
 #include <vtkTable.h>
 #include <vtkTransform.h>
 #include <vtkTransformFilter.h>
-#include <vtkTriangle.h>
-#include <vtkTriangleFilter.h>
-#include <vtkThreshold.h>
-#include <vtkUnstructuredGrid.h>
 #include <vtkXMLPolyDataReader.h>
-#include <vtkXMLPolyDataWriter.h>
 
-#include <set>
+#include <algorithm>
+#include <vector>
 
 namespace
 {
@@ -79,6 +63,10 @@ namespace
     std::cout << "segmented surface geometry       = " << segmentedSurface << std::endl;
     std::cout << "output cross section geometry    = " << outputCrossSections << std::endl;
     std::cout << "output comma-delimited text file = " << outputCSVFile << std::endl;
+    std::cout << "number of contours               = " << numberOfContours << std::endl;
+    std::cout << "contour spacing                  = " << contourSpacing << std::endl;
+    std::cout << "number of threads                = " << numberOfThreads << std::endl;
+    std::cout << "profile                          = " << profile << std::endl;
 
     return EXIT_SUCCESS;
   }
@@ -102,8 +90,59 @@ namespace
   }
 
   /*******************************************************************/
-  /**  */
+  /** Write the cross sections of each window of contours as the
+   *  sweep completes them. */
   /*******************************************************************/
+  class CrossSectionOutput : public CrossSectionSweep::WindowObserver
+  {
+  public:
+    CrossSectionOutput( CrossSectionWriter & writer,
+                        const std::vector<double> & contourValues )
+      : Writer( writer ), ContourValues( contourValues ) {}
+
+    virtual bool ProcessWindow( vtkIdType windowBegin,
+                                const std::vector<CrossSectionSweep::ContourCrossSections> & crossSections,
+                                const std::vector<CrossSectionSweep::Measures> & measures )
+    {
+      ProfileTimer timer( "write cross sections" );
+      vtkIdType windowEnd = windowBegin + static_cast<vtkIdType>( crossSections.size() );
+      for ( vtkIdType contourID = windowEnd-1; contourID >= windowBegin; --contourID )
+        {
+        std::cout << "Processing contour " << contourID << " - "
+                  << ContourValues[contourID] << std::endl;
+
+        const CrossSectionSweep::ContourCrossSections & sections =
+          crossSections[contourID - windowBegin];
+        const CrossSectionSweep::Measures & measure = measures[contourID];
+        if ( sections.SelectedRegion >= 0 )
+          {
+          std::cout << " - area: " << measure.Area << std::endl << std::flush;
+          }
+
+        bool written =
+          Writer.AddCut( contourID, sections.Candidates[sections.SelectedCandidate].Cut );
+
+        vtkPolyData* pd = sections.Geometry;
+        if ( written && pd )
+          {
+          written = Writer.AddCrossSection( contourID, ContourValues[contourID], pd,
+                                            measure.CenterOfMass, measure.AverageNormal,
+                                            measure.Area, measure.Perimeter );
+          }
+
+        if ( !written )
+          {
+          std::cerr << "Could not write the cross section of contour " << contourID << "\n";
+          return false;
+          }
+        }
+      return true;
+    }
+
+  private:
+    CrossSectionWriter &        Writer;
+    const std::vector<double> & ContourValues;
+  };
 
 } // end anonymous namespace
 
@@ -115,32 +154,74 @@ int main( int argc, char* argv[] )
 {
   PARSE_ARGS;
 
+  ProfileSession profileSession( "ComputeCrossSections", profile );
+  Profiler & profiler = Profiler::GetInstance();
+
   int returnValue = EXIT_SUCCESS;
 
-  vtkSmartPointer<vtkXMLPolyDataReader> contourReader =
-    vtkSmartPointer<vtkXMLPolyDataReader>::New();
-  contourReader->SetFileName( heatFlowContours.c_str() );
-  contourReader->Update();
-  vtkPointData* contourPD = contourReader->GetOutput()->GetPointData();
-  vtkFloatArray* heatArray = vtkFloatArray::SafeDownCast(contourPD->GetArray("scalars"));
-  if (!heatArray)
+  // The contours are either read from the output of
+  // ComputeHeatContours or computed from the heat flow image in memory
+  vtkSmartPointer<vtkPolyData> contours = vtkSmartPointer<vtkPolyData>::New();
+  std::string contourExtension( ".vtp" );
+  if ( std::equal( contourExtension.rbegin(), contourExtension.rend(),
+                   heatFlowContours.rbegin() ) )
     {
-    std::cerr << "'scalars' point data array not available in contours file '"
-              << heatFlowContours << "'\n";
+    vtkSmartPointer<vtkXMLPolyDataReader> contourReader =
+      vtkSmartPointer<vtkXMLPolyDataReader>::New();
+    contourReader->SetFileName( heatFlowContours.c_str() );
+    ProfileTimer timer( "read contours" );
+    contourReader->Update();
+    contours->ShallowCopy( contourReader->GetOutput() );
+    }
+  else
+    {
+    std::cout << "Contouring heat flow image\n";
+    HeatFlowContours contourer;
+    contourer.SetNumberOfContours( numberOfContours );
+    contourer.SetNumberOfThreads( numberOfThreads );
+    if ( !contourer.SetValueSpacing( contourSpacing ) )
+      {
+      std::cerr << "Unknown contour spacing '" << contourSpacing << "'\n";
+      return EXIT_FAILURE;
+      }
+    if ( !contourer.ComputeFromImageFile( heatFlowContours, contours ) )
+      {
+      return EXIT_FAILURE;
+      }
+    }
+
+  vtkIdTypeArray* contourIDs = vtkIdTypeArray::SafeDownCast(
+    contours->GetCellData()->GetArray( "contour ID" ) );
+  vtkDataArray* contourValueTable = contours->GetFieldData()->GetArray( "contour values" );
+  if ( !contourIDs || !contourValueTable )
+    {
+    std::cerr << "'contour ID' cell data array or 'contour values' field data array "
+              << "not available in contours file '" << heatFlowContours
+              << "'. Rerun ComputeHeatContours to write them.\n";
     return EXIT_FAILURE;
     }
 
-  // Create the set of heat values in the contours
-  std::set<float> contourValueSet;
-  for ( vtkIdType id = 0; id < heatArray->GetNumberOfTuples(); ++id )
+  // Sort the contour cells by contour once instead of thresholding
+  // the whole contour data set for each contour
+  std::vector<vtkIdType> valueIndices;
+  std::vector< std::vector<vtkIdType> > contourCells;
+  {
+    ProfileTimer timer( "bucket contour cells" );
+    CrossSectionSweep::BucketCellsByContour( contourIDs, contourValueTable->GetNumberOfTuples(),
+                                             valueIndices, contourCells );
+  }
+  std::vector<double> contourValues( valueIndices.size() );
+  for ( size_t i = 0; i < valueIndices.size(); ++i )
     {
-    float value = heatArray->GetValue( id );
-    contourValueSet.insert( value );
+    contourValues[i] = contourValueTable->GetTuple1( valueIndices[i] );
     }
-  std::vector<float> contourValues( contourValueSet.begin(), contourValueSet.end() );
 
   int numContours = static_cast<int>( contourValues.size() );
   std::cout << "Num contours: " << numContours << std::endl;
+  profiler.SetCounter( "contours", numContours );
+  profiler.SetCounter( "contour triangles", contours->GetNumberOfCells() );
+
+  profiler.BeginStage( "read surface" );
 
   vtkSmartPointer<vtkAlgorithm> reader;
   std::string vtkExtension( ".vtk" );
@@ -181,16 +262,55 @@ int main( int argc, char* argv[] )
   transformedSegmentationSurface->SetTransform( RASToLPSTransform );
   transformedSegmentationSurface->
     SetInputConnection( reader->GetOutputPort() );
+  transformedSegmentationSurface->Update();
+
+  vtkPolyData* surface =
+    vtkPolyData::SafeDownCast( transformedSegmentationSurface->GetOutput() );
+  profiler.EndStage();
+  profiler.SetCounter( "surface cells", surface->GetNumberOfCells() );
+
+  // Index the surface once so that each cut only visits the cells the
+  // cutting plane can intersect
+  vtkSmartPointer<vtkPlaneCutLocator> surfaceLocator =
+    vtkSmartPointer<vtkPlaneCutLocator>::New();
+  {
+    ProfileTimer timer( "build surface locator" );
+    surfaceLocator->SetDataSet( surface );
+    surfaceLocator->BuildLocator();
+  }
 
-  // Point data with heat flow values
-  vtkSmartPointer<vtkDoubleArray> heatValues = vtkSmartPointer<vtkDoubleArray>::New();
-  heatValues->SetName( "heat" );
-  heatValues->SetNumberOfComponents( 1 );
+  // VTK data has no associated transform, so Slicer assumes it is
+  // in the RAS coordinate space. We are operating in LPS space, so we
+  // need to convert to RAS here.
+  vtkSmartPointer<vtkTransform> LPSToRASTransform =
+    vtkSmartPointer<vtkTransform>::New();
+  LPSToRASTransform->Scale( -1.0, -1.0, 1.0 );
 
-  // Cell data with contour ID
-  vtkSmartPointer<vtkIdTypeArray> contourIDs = vtkSmartPointer<vtkIdTypeArray>::New();
-  contourIDs->SetName( "contour ID" );
-  contourIDs->SetNumberOfComponents( 1 );
+  CrossSectionWriter writer;
+  writer.SetFileName( outputCrossSections );
+  writer.SetTransform( LPSToRASTransform );
+  if ( !writer.Start() )
+    {
+    std::cerr << "Could not create the output for '" << outputCrossSections << "'\n";
+    return EXIT_FAILURE;
+    }
+
+  // Cut, select and triangulate the cross sections window by window,
+  // writing each window as soon as it is done
+  CrossSectionOutput output( writer, contourValues );
+  CrossSectionSweep sweep;
+  sweep.SetContours( contours, &contourCells );
+  sweep.SetSurface( surface, surfaceLocator );
+  sweep.SetNumberOfThreads( numberOfThreads );
+  sweep.SetObserver( &output );
+
+  std::vector<CrossSectionSweep::Measures> measures;
+  if ( !sweep.Run( measures ) )
+    {
+    return EXIT_FAILURE;
+    }
+  profiler.SetCounter( "cutting planes", sweep.GetNumberOfCuttingPlanes() );
+  profiler.SetCounter( "triangles cut", sweep.GetNumberOfCutTriangles() );
 
   // Field data containing meta data about the cross sections. One
   // entry for each cross-section is stored for each of the arrays
@@ -215,338 +335,28 @@ int main( int argc, char* argv[] )
   perimeterInfo->SetNumberOfComponents( 1 );
   perimeterInfo->SetNumberOfTuples( numContours );
 
-  vtkSmartPointer<vtkAppendPolyData> appender =
-    vtkSmartPointer<vtkAppendPolyData>::New();
-
-  vtkSmartPointer<vtkAppendPolyData> appendCuts =
-    vtkSmartPointer<vtkAppendPolyData>::New();
-
-  bool firstCrossSection = true;
-  double previousCenterlinePoint[3] = {0.0, 0.0, 0.0};
-
-  for ( vtkIdType contourID = numContours-1; contourID >= 0; --contourID )
-    //for ( vtkIdType contourID = 450; contourID >= 420; --contourID )
+  for ( vtkIdType contourID = 0; contourID < numContours; ++contourID )
     {
-    //double scalar = contourFilter->GetValue( contourID );
-    double scalar = contourValues[contourID];
-
-    std::cout << "Processing contour " << contourID << " - " << scalar <<std::endl;
-
-    // Extract contour for the nearest scalar value
-    vtkSmartPointer<vtkThreshold> scalarThreshold = vtkSmartPointer<vtkThreshold>::New();
-    scalarThreshold->ThresholdBetween( scalar - 1e-5, scalar + 1e-5 );
-    scalarThreshold->AllScalarsOn();
-    scalarThreshold->SetInputConnection( contourReader->GetOutputPort() );
-
-    vtkSmartPointer<vtkDataSetSurfaceFilter> surfaceFilter =
-      vtkSmartPointer<vtkDataSetSurfaceFilter>::New();
-    surfaceFilter->SetInputConnection( scalarThreshold->GetOutputPort() );
-
-    vtkSmartPointer<vtkPolyDataConnectivityFilter> contourConnected =
-      vtkSmartPointer<vtkPolyDataConnectivityFilter>::New();
-    if ( firstCrossSection )
-      {
-      contourConnected->SetExtractionModeToAllRegions();
-      firstCrossSection = false;
-      }
-    else
-      {
-      contourConnected->SetExtractionModeToClosestPointRegion();
-      contourConnected->SetClosestPoint(previousCenterlinePoint);
-      }
-    contourConnected->SetInputConnection(surfaceFilter->GetOutputPort());
-    contourConnected->Update();
-
-    // Center of mass of surface elements is the average of the
-    // centers of the surface triangles weighted by the triangle area.
-    vtkPolyData* pd = contourConnected->GetOutput();
-
-    vtkCellArray* ca = pd->GetPolys();
-
-    ca->InitTraversal();
-    vtkSmartPointer<vtkTriangle> triangle = vtkSmartPointer<vtkTriangle>::New();
-    vtkSmartPointer<vtkIdList> ptList = vtkSmartPointer<vtkIdList>::New();
-    double centerOfMass[3] = { 0.0, 0.0, 0.0 };
-    double averageNormal[3] = { 0.0, 0.0, 0.0 };
-    double totalArea = 0.0;
-    while ( ca->GetNextCell( ptList ) )
-      {
-      double p0[3], p1[3], p2[3];
-      pd->GetPoint( ptList->GetId( 0 ), p0 );
-      pd->GetPoint( ptList->GetId( 1 ), p1 );
-      pd->GetPoint( ptList->GetId( 2 ), p2 );
-      double area = vtkTriangle::TriangleArea( p0, p1, p2 );
-      totalArea += area;
-
-      double center[3], normal[3];
-      vtkTriangle::TriangleCenter( p0, p1, p2, center );
-      vtkTriangle::ComputeNormal( p0, p1, p2, normal );
-
-      for ( int i = 0; i < 3; ++i )
-        {
-        centerOfMass[i]  += area * center[i];
-        averageNormal[i] += area * normal[i];
-        }
-      }
-
-    if ( totalArea > 0.0 )
-      {
-      centerOfMass[0] /= totalArea;
-      centerOfMass[1] /= totalArea;
-      centerOfMass[2] /= totalArea;
-      }
-    else
-      {
-      centerOfMass[0] = centerOfMass[1] = centerOfMass[2] = 0.0;
-      }
-
-    if ( totalArea > 0.0 )
-      {
-      averageNormal[0] /= totalArea;
-      averageNormal[1] /= totalArea;
-      averageNormal[2] /= totalArea;
-      }
-    else
-      {
-      averageNormal[0] = averageNormal[1] = averageNormal[2] = 0.0;
-      }
-
-    // Now cut the polygonal model from the segmentation by the plane
-    // defined by the center of mass and normal
-    vtkSmartPointer<vtkPlane> plane = vtkSmartPointer<vtkPlane>::New();
-    plane->SetOrigin( centerOfMass );
-    plane->SetNormal( averageNormal );
-
-    vtkSmartPointer<vtkCutter> cutter = vtkSmartPointer<vtkCutter>::New();
-    cutter->SetCutFunction( plane );
-    cutter->GenerateCutScalarsOn();
-    cutter->SetNumberOfContours( 0 );
-    cutter->SetValue( 0, 0.0 );
-    cutter->SetInputConnection( transformedSegmentationSurface->GetOutputPort() );
-
-    vtkSmartPointer<vtkContourCompleter> completer =
-      vtkSmartPointer<vtkContourCompleter>::New();
-    completer->SetInputConnection( cutter->GetOutputPort() );
-    completer->Update();
-
-#if 0
-    vtkSmartPointer<vtkXMLPolyDataWriter> writer = vtkSmartPointer<vtkXMLPolyDataWriter>::New();
-    char fileNameBuffer[1024];
-    sprintf(fileNameBuffer, "%s-%04lld.vtp", outputCrossSections.c_str(), contourID);
-    writer->SetFileName( fileNameBuffer );
-    writer->SetInputConnection( completer->GetOutputPort() );
-    writer->Write();
-#endif
-
-    vtkSmartPointer<vtkContourTriangulator> triangulate =
-      vtkSmartPointer<vtkContourTriangulator>::New();
-    triangulate->TriangulationErrorDisplayOn();
-    triangulate->SetInputConnection( completer->GetOutputPort() );
-
-    vtkSmartPointer<vtkPolyDataConnectivityFilter> connected =
-      vtkSmartPointer<vtkPolyDataConnectivityFilter>::New();
-    connected->SetExtractionModeToClosestPointRegion();
-    connected->SetClosestPoint( previousCenterlinePoint );
-    connected->SetInputConnection( triangulate->GetOutputPort() );
-    //connected->SetInputConnection( completer->GetOutputPort() );
-    connected->Update();
-
-    appendCuts->AddInputConnection( completer->GetOutputPort() );
-
-    vtkIdType numCells = connected->GetOutput()->GetNumberOfPolys();
-    if ( numCells == 0 )
-      {
-      double zero = 0.0;
-      areaInfo->SetTypedTuple( contourID, &zero );
-      perimeterInfo->SetTypedTuple( contourID, &zero );
-
-      // Assume contourID + 1 is valid...
-      centerOfMassInfo->GetTypedTuple( contourID + 1, centerOfMass );
-      centerOfMassInfo->SetTypedTuple( contourID, centerOfMass );
-      averageNormalInfo->GetTypedTuple( contourID + 1, averageNormal );
-      averageNormalInfo->SetTypedTuple( contourID, averageNormal );
-
-      continue;
-      }
-
-    appendCuts->AddInputConnection( completer->GetOutputPort() );
-
-    appender->AddInputConnection( connected->GetOutputPort() );
-    connected->Update();
-    pd = connected->GetOutput();
-
-    // Add heat values to point array
-    for ( vtkIdType ptId = 0; ptId < pd->GetNumberOfPoints(); ++ptId )
-      {
-      heatValues->InsertNextTypedTuple( &scalar );
-      }
-
-    // Add contour ID to cell array
-    for ( vtkIdType cellId = 0; cellId < pd->GetNumberOfCells(); ++cellId )
-      {
-      contourIDs->InsertNextTypedTuple( &contourID );
-      }
-
-    // Now measure the surface area of the planar cross section
-    totalArea = 0.0;
-    centerOfMass[0] = centerOfMass[1] = centerOfMass[2] = 0.0;
-    averageNormal[0] = averageNormal[1] = averageNormal[2] = 0.0;
-    ca = pd->GetPolys();
-    ca->InitTraversal();
-    while ( ca->GetNextCell( ptList ) )
-      {
-      double p0[3], p1[3], p2[3];
-      pd->GetPoint( ptList->GetId( 0 ), p0 );
-      pd->GetPoint( ptList->GetId( 1 ), p1 );
-      pd->GetPoint( ptList->GetId( 2 ), p2 );
-      double area = vtkTriangle::TriangleArea( p0, p1, p2 );
-      totalArea += area;
-
-      double center[3], normal[3];
-      vtkTriangle::TriangleCenter( p0, p1, p2, center );
-      vtkTriangle::ComputeNormal( p0, p1, p2, normal );
-
-      for ( int i = 0; i < 3; ++i )
-        {
-        centerOfMass[i]  += area * center[i];
-        averageNormal[i] += area * normal[i];
-        }
-      }
-
-    std::cout << " - area: " << totalArea << std::endl << std::flush;
-
-    if ( totalArea > 0.0 )
-      {
-      centerOfMass[0] /= totalArea;
-      centerOfMass[1] /= totalArea;
-      centerOfMass[2] /= totalArea;
-
-      previousCenterlinePoint[0] = centerOfMass[0];
-      previousCenterlinePoint[1] = centerOfMass[1];
-      previousCenterlinePoint[2] = centerOfMass[2];
-      }
-    else
-      {
-      centerOfMass[0] = centerOfMass[1] = centerOfMass[2] = 0.0;
-      }
-
-    if ( totalArea > 0.0 )
-      {
-      averageNormal[0] /= totalArea;
-      averageNormal[1] /= totalArea;
-      averageNormal[2] /= totalArea;
-      }
-    else
-      {
-      averageNormal[0] = averageNormal[1] = averageNormal[2] = 0.0;
-      }
-
-    vtkSmartPointer<vtkMassProperties> massProperties =
-      vtkSmartPointer<vtkMassProperties>::New();
-    massProperties->SetInputConnection( connected->GetOutputPort() );
-    massProperties->Update();
-    double surfaceArea = massProperties->GetSurfaceArea();
-
-    // Now compute the perimeter of this planar cross section.
-    double perimeter = 0.0;
-    vtkSmartPointer<vtkFeatureEdges> edges = vtkSmartPointer<vtkFeatureEdges>::New();
-    edges->BoundaryEdgesOn();
-    edges->FeatureEdgesOff();
-    edges->NonManifoldEdgesOff();
-    edges->ManifoldEdgesOff();
-    edges->ColoringOff();
-    edges->SetInputConnection( connected->GetOutputPort() );
-    edges->Update();
-
-    vtkPolyData* edgeOutput = edges->GetOutput();
-    for ( vtkIdType cellId = 0; cellId < edgeOutput->GetNumberOfCells(); ++cellId )
-      {
-      vtkCell* cell = edgeOutput->GetCell( cellId );
-      vtkLine* line = vtkLine::SafeDownCast( cell );
-      vtkPolyLine* polyLine = vtkPolyLine::SafeDownCast( cell );
-      if ( line )
-        {
-        vtkIdType ptId0 = line->GetPointId( 0 );
-        vtkIdType ptId1 = line->GetPointId( 1 );
-
-        double pt0[3], pt1[3];
-        edgeOutput->GetPoint( ptId0, pt0 );
-        edgeOutput->GetPoint( ptId1, pt1 );
-
-        perimeter += sqrt( vtkMath::Distance2BetweenPoints( pt0, pt1 ) );
-        }
-
-      if ( polyLine )
-        {
-        vtkIdList* pointIds = polyLine->GetPointIds();
-        int numPolyLinePoints = pointIds->GetNumberOfIds();
-        if ( numPolyLinePoints > 1 )
-          {
-          for (vtkIdType i = 0; i < numPolyLinePoints; ++i)
-            {
-            vtkIdType ptId0 = pointIds->GetId( i );
-            vtkIdType ptId1 = pointIds->GetId( (i + 1) % numPolyLinePoints );
-            double pt0[3], pt1[3];
-            edgeOutput->GetPoints()->GetPoint( ptId0, pt0 );
-            edgeOutput->GetPoints()->GetPoint( ptId1, pt1 );
-
-            perimeter += sqrt( vtkMath::Distance2BetweenPoints( pt0, pt1 ) );
-            }
-          }
-        }
-      }
-
-    areaInfo->SetTypedTuple( contourID, &surfaceArea );
-    perimeterInfo->SetTypedTuple( contourID, &perimeter );
-    centerOfMassInfo->SetTypedTuple( contourID, centerOfMass );
-    averageNormalInfo->SetTypedTuple( contourID, averageNormal );
+    const CrossSectionSweep::Measures & measure = measures[contourID];
+    centerOfMassInfo->SetTypedTuple( contourID, measure.CenterOfMass );
+    averageNormalInfo->SetTypedTuple( contourID, measure.AverageNormal );
+    areaInfo->SetTypedTuple( contourID, &measure.Area );
+    perimeterInfo->SetTypedTuple( contourID, &measure.Perimeter );
     }
 
-  // VTK data has no associated transform, so Slicer assumes it is
-  // in the RAS coordinate space. We are operating in LPS space, so we
-  // need to convert to RAS here.
-  vtkSmartPointer<vtkTransform> LPSToRASTransform =
-    vtkSmartPointer<vtkTransform>::New();
-  LPSToRASTransform->Scale( -1.0, -1.0, 1.0 );
-
-  vtkSmartPointer<vtkTransformFilter> transformFilter =
-    vtkSmartPointer<vtkTransformFilter>::New();
-  transformFilter->SetTransform( LPSToRASTransform );
-  transformFilter->SetInputConnection( appender->GetOutputPort() );
-  transformFilter->Update();
+  ProfileTimer writeTimer( "write measurements" );
 
-  vtkSmartPointer<vtkPointSet> outputCopy;
-  outputCopy.TakeReference( transformFilter->GetOutput()->NewInstance() );
-  outputCopy->ShallowCopy( transformFilter->GetOutput() );
-
-  // Add the point data to the output
-  vtkPointData* pointData = outputCopy->GetPointData();
-  pointData->SetScalars( heatValues );
-
-  // Add the cell data to the output
-  vtkCellData* cellData = outputCopy->GetCellData();
-  cellData->SetScalars( contourIDs );
-
-  // Add the field data to the output
-  vtkFieldData* fieldData = outputCopy->GetFieldData();
+  vtkSmartPointer<vtkFieldData> fieldData = vtkSmartPointer<vtkFieldData>::New();
   fieldData->AddArray( centerOfMassInfo );
   fieldData->AddArray( averageNormalInfo );
   fieldData->AddArray( areaInfo );
   fieldData->AddArray( perimeterInfo );
 
-  // Write contours
-  vtkSmartPointer<vtkXMLPolyDataWriter> pdWriter =
-    vtkSmartPointer<vtkXMLPolyDataWriter>::New();
-  pdWriter->SetFileName( outputCrossSections.c_str() );
-  pdWriter->SetInputData( outputCopy );
-  pdWriter->Write();
-
-  transformFilter->SetInputConnection( appendCuts->GetOutputPort() );
-  transformFilter->Update();
-
-  pdWriter->SetFileName( (outputCrossSections + "-cuts.vtp").c_str() );
-  pdWriter->SetInputConnection( transformFilter->GetOutputPort() );
-  pdWriter->Write();
+  if ( !writer.Finish( fieldData ) )
+    {
+    std::cerr << "Could not write '" << outputCrossSections << "'\n";
+    return EXIT_FAILURE;
+    }
 
   // Write CSV file
   vtkSmartPointer<vtkTable> table = vtkSmartPointer<vtkTable>::New();
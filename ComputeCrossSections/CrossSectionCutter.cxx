@@ -0,0 +1,289 @@
+#include "CrossSectionCutter.h"
+
+#include <vtkCellArray.h>
+#include <vtkCellType.h>
+#include <vtkPoints.h>
+
+#include <algorithm>
+
+namespace
+{
+  // Edges of a triangle, and the two edges crossed by the contour for
+  // each case of points at or above the contour value, as in
+  // vtkTriangle
+  const int TriangleEdges[3][2] = { {0,1}, {1,2}, {2,0} };
+  const int TriangleLineCases[8][2] = { {-1,-1}, {0,2}, {1,0}, {1,2},
+                                        {2,1}, {0,1}, {2,0}, {-1,-1} };
+
+  // Orders cut points by key, then by index
+  class PointKeyLess
+  {
+  public:
+    PointKeyLess(const std::vector<vtkIdType> & keys) : Keys(keys) {}
+
+    bool operator()(size_t a, size_t b) const
+    {
+      if (this->Keys[2*a] != this->Keys[2*b])
+        {
+        return this->Keys[2*a] < this->Keys[2*b];
+        }
+      if (this->Keys[2*a + 1] != this->Keys[2*b + 1])
+        {
+        return this->Keys[2*a + 1] < this->Keys[2*b + 1];
+        }
+      return a < b;
+    }
+
+  private:
+    const std::vector<vtkIdType> & Keys;
+  };
+}
+
+//----------------------------------------------------------------------------
+CrossSectionCutter::CrossSectionCutter()
+{
+  this->Surface = NULL;
+  this->Locator = NULL;
+}
+
+//----------------------------------------------------------------------------
+CrossSectionCutter::~CrossSectionCutter()
+{
+}
+
+//----------------------------------------------------------------------------
+void CrossSectionCutter::SetSurface(vtkPolyData* surface,
+                                    const vtkPlaneCutLocator* locator)
+{
+  this->Surface = surface;
+  this->Locator = locator;
+}
+
+//----------------------------------------------------------------------------
+void CrossSectionCutter::AddPlane(const double origin[3], const double normal[3])
+{
+  this->Origins.insert(this->Origins.end(), origin, origin + 3);
+  this->Normals.insert(this->Normals.end(), normal, normal + 3);
+}
+
+//----------------------------------------------------------------------------
+void CrossSectionCutter::RemoveAllPlanes()
+{
+  this->Origins.clear();
+  this->Normals.clear();
+}
+
+//----------------------------------------------------------------------------
+void CrossSectionCutter::Cut(std::vector< vtkSmartPointer<vtkPolyData> > & cuts)
+{
+  size_t numberOfPlanes = this->GetNumberOfPlanes();
+
+  // Segment lists are kept between calls to reuse their memory
+  if (this->Segments.size() < numberOfPlanes)
+    {
+    this->Segments.resize(numberOfPlanes);
+    }
+  for (size_t plane = 0; plane < numberOfPlanes; ++plane)
+    {
+    this->Segments[plane].Keys.clear();
+    this->Segments[plane].Points.clear();
+    }
+
+  this->CellPlanes.clear();
+  if (this->Surface && this->Locator && numberOfPlanes > 0)
+    {
+    this->Locator->FindCellsAlongPlanes(numberOfPlanes, &this->Origins[0],
+                                        &this->Normals[0], this->CellPlanes);
+    }
+
+  for (size_t begin = 0; begin < this->CellPlanes.size(); )
+    {
+    vtkIdType cellId = this->CellPlanes[begin].first;
+    size_t end = begin + 1;
+    while (end < this->CellPlanes.size() && this->CellPlanes[end].first == cellId)
+      {
+      ++end;
+      }
+    this->CutCell(cellId, begin, end);
+    begin = end;
+    }
+
+  cuts.resize(numberOfPlanes);
+  for (size_t plane = 0; plane < numberOfPlanes; ++plane)
+    {
+    if (!cuts[plane])
+      {
+      cuts[plane] = vtkSmartPointer<vtkPolyData>::New();
+      }
+    this->BuildCut(static_cast<vtkIdType>(plane), cuts[plane]);
+    }
+}
+
+//----------------------------------------------------------------------------
+void CrossSectionCutter::CutCell(vtkIdType cellId, size_t begin, size_t end)
+{
+  int cellType = this->Surface->GetCellType(cellId);
+  if (cellType != VTK_TRIANGLE && cellType != VTK_QUAD && cellType != VTK_POLYGON)
+    {
+    return;
+    }
+
+  vtkIdType numberOfPoints;
+  vtkIdType* pts;
+  this->Surface->GetCellPoints(cellId, numberOfPoints, pts);
+  if (numberOfPoints < 3)
+    {
+    return;
+    }
+
+  this->CellPoints.resize(3*numberOfPoints);
+  for (vtkIdType i = 0; i < numberOfPoints; ++i)
+    {
+    this->Surface->GetPoint(pts[i], &this->CellPoints[3*i]);
+    }
+
+  // Signed distances of the cell points to each plane near the cell,
+  // computed as vtkPlane does
+  size_t numberOfPlanes = end - begin;
+  this->CellDistances.resize(numberOfPlanes * numberOfPoints);
+  for (size_t j = 0; j < numberOfPlanes; ++j)
+    {
+    const double* origin = &this->Origins[3*this->CellPlanes[begin + j].second];
+    const double* normal = &this->Normals[3*this->CellPlanes[begin + j].second];
+    double* distances = &this->CellDistances[j * numberOfPoints];
+    const double* x = &this->CellPoints[0];
+    for (vtkIdType i = 0; i < numberOfPoints; ++i, x += 3)
+      {
+      distances[i] = normal[0] * (x[0] - origin[0]) +
+                     normal[1] * (x[1] - origin[1]) +
+                     normal[2] * (x[2] - origin[2]);
+      }
+    }
+
+  for (size_t j = 0; j < numberOfPlanes; ++j)
+    {
+    const double* distances = &this->CellDistances[j * numberOfPoints];
+    for (int i = 1; i + 1 < numberOfPoints; ++i)
+      {
+      this->CutTriangle(this->CellPlanes[begin + j].second, pts, distances, 0, i, i + 1);
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+void CrossSectionCutter::CutTriangle(vtkIdType plane, const vtkIdType* pts,
+                                     const double* distances, int a, int b, int c)
+{
+  const int corners[3] = { a, b, c };
+  int lineCase = 0;
+  for (int i = 0; i < 3; ++i)
+    {
+    if (distances[corners[i]] >= 0.0)
+      {
+      lineCase |= 1 << i;
+      }
+    }
+  if (TriangleLineCases[lineCase][0] < 0)
+    {
+    return;
+    }
+
+  vtkIdType keys[4];
+  double points[6];
+  for (int i = 0; i < 2; ++i)
+    {
+    const int* edge = TriangleEdges[TriangleLineCases[lineCase][i]];
+    int e0 = corners[edge[0]];
+    int e1 = corners[edge[1]];
+
+    // Interpolate from the lower distance to the higher one
+    int low = distances[e1] - distances[e0] > 0.0 ? e0 : e1;
+    int high = low == e0 ? e1 : e0;
+    const double* x0 = &this->CellPoints[3*low];
+    const double* x1 = &this->CellPoints[3*high];
+    if (distances[high] == 0.0)
+      {
+      keys[2*i] = keys[2*i + 1] = pts[high];
+      std::copy(x1, x1 + 3, points + 3*i);
+      }
+    else
+      {
+      keys[2*i] = std::min(pts[e0], pts[e1]);
+      keys[2*i + 1] = std::max(pts[e0], pts[e1]);
+      double t = -distances[low] / (distances[high] - distances[low]);
+      for (int j = 0; j < 3; ++j)
+        {
+        points[3*i + j] = x0[j] + t * (x1[j] - x0[j]);
+        }
+      }
+    }
+
+  if (keys[0] == keys[2] && keys[1] == keys[3])
+    {
+    return;
+    }
+
+  PlaneSegments & segments = this->Segments[plane];
+  segments.Keys.insert(segments.Keys.end(), keys, keys + 4);
+  segments.Points.insert(segments.Points.end(), points, points + 6);
+}
+
+//----------------------------------------------------------------------------
+void CrossSectionCutter::BuildCut(vtkIdType plane, vtkPolyData* cut)
+{
+  const PlaneSegments & segments = this->Segments[plane];
+  size_t numberOfCutPoints = segments.Keys.size() / 2;
+
+  // Find the first occurrence of each key, then number the merged
+  // points in the order they first appear
+  this->Order.resize(numberOfCutPoints);
+  for (size_t i = 0; i < numberOfCutPoints; ++i)
+    {
+    this->Order[i] = i;
+    }
+  std::sort(this->Order.begin(), this->Order.end(), PointKeyLess(segments.Keys));
+
+  this->FirstOccurrence.resize(numberOfCutPoints);
+  for (size_t i = 0; i < numberOfCutPoints; ++i)
+    {
+    size_t current = this->Order[i];
+    size_t previous = i > 0 ? this->Order[i - 1] : current;
+    if (i > 0 &&
+        segments.Keys[2*current] == segments.Keys[2*previous] &&
+        segments.Keys[2*current + 1] == segments.Keys[2*previous + 1])
+      {
+      this->FirstOccurrence[current] = this->FirstOccurrence[previous];
+      }
+    else
+      {
+      this->FirstOccurrence[current] = current;
+      }
+    }
+
+  vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+  points->SetDataType(this->Surface->GetPoints()->GetDataType());
+  this->PointIds.resize(numberOfCutPoints);
+  for (size_t i = 0; i < numberOfCutPoints; ++i)
+    {
+    size_t first = this->FirstOccurrence[i];
+    if (first == i)
+      {
+      this->PointIds[i] = points->InsertNextPoint(&segments.Points[3*i]);
+      }
+    else
+      {
+      this->PointIds[i] = this->PointIds[first];
+      }
+    }
+
+  vtkSmartPointer<vtkCellArray> lines = vtkSmartPointer<vtkCellArray>::New();
+  lines->Allocate(3 * (numberOfCutPoints / 2));
+  for (size_t i = 0; i + 1 < numberOfCutPoints; i += 2)
+    {
+    lines->InsertNextCell(2, &this->PointIds[i]);
+    }
+
+  cut->Initialize();
+  cut->SetPoints(points);
+  cut->SetLines(lines);
+}
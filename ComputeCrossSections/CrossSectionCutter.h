@@ -0,0 +1,97 @@
+#ifndef CrossSectionCutter_h
+#define CrossSectionCutter_h
+
+#include "vtkPlaneCutLocator.h"
+
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+#include <vector>
+
+// Description:
+// Cuts a surface by a batch of planes at once. The cells each plane
+// may intersect are found for all planes in one traversal of a
+// vtkPlaneCutLocator. The cells are then visited once, in increasing
+// order. The points of each cell are loaded once, and the cell is cut
+// by all the planes near it.
+//
+// Each cut holds the line segments of one plane. The segments and
+// points are the ones vtkCutter gives on the same cells: a segment per
+// triangle crossed by the plane, points interpolated from the lower
+// to the higher signed distance, crossings shared by neighboring
+// cells merged, and degenerate segments dropped. Quads and polygons
+// are cut as fans of triangles. Other cells are ignored.
+class CrossSectionCutter
+{
+public:
+  CrossSectionCutter();
+  ~CrossSectionCutter();
+
+  // Description:
+  // Set the surface to cut and a locator built on it. BuildCells()
+  // must have been called on the surface.
+  void SetSurface(vtkPolyData* surface, const vtkPlaneCutLocator* locator);
+
+  // Description:
+  // Add a plane through origin with the given normal to the batch.
+  // The normal does not need to have unit length.
+  void AddPlane(const double origin[3], const double normal[3]);
+
+  // Description:
+  // Remove all planes from the batch.
+  void RemoveAllPlanes();
+
+  size_t GetNumberOfPlanes() const { return this->Origins.size() / 3; }
+
+  // Description:
+  // Cut the surface by the planes of the batch. cuts is resized to one
+  // poly data per plane, and existing poly data are reused.
+  void Cut(std::vector< vtkSmartPointer<vtkPolyData> > & cuts);
+
+private:
+  CrossSectionCutter(const CrossSectionCutter&); // Not implemented
+  void operator=(const CrossSectionCutter&); // Not implemented
+
+  // Description:
+  // Segments of the cut by one plane, in the order of the cells. Each
+  // segment has two points, and each point is keyed by the end points
+  // of the crossed edge, lower id first, or by the surface point twice
+  // if the crossing is on it.
+  struct PlaneSegments
+  {
+    std::vector<vtkIdType> Keys;
+    std::vector<double>    Points;
+  };
+
+  // Description:
+  // Cut one cell by the planes of entries [begin, end) of CellPlanes.
+  void CutCell(vtkIdType cellId, size_t begin, size_t end);
+
+  // Description:
+  // Add the segment of triangle (a, b, c) of the current cell, given
+  // by indices into the cell points, crossed by plane.
+  void CutTriangle(vtkIdType plane, const vtkIdType* pts, const double* distances,
+                   int a, int b, int c);
+
+  // Description:
+  // Merge the points of the segments of plane and write them to cut.
+  void BuildCut(vtkIdType plane, vtkPolyData* cut);
+
+  vtkPolyData*                 Surface;
+  const vtkPlaneCutLocator*    Locator;
+
+  std::vector<double>          Origins;
+  std::vector<double>          Normals;
+
+  std::vector<vtkPlaneCutLocator::CellPlane> CellPlanes;
+  std::vector<PlaneSegments>   Segments;
+
+  // Scratch space for the current cell and cut
+  std::vector<double>          CellPoints;
+  std::vector<double>          CellDistances;
+  std::vector<size_t>          Order;
+  std::vector<size_t>          FirstOccurrence;
+  std::vector<vtkIdType>       PointIds;
+};
+
+#endif // CrossSectionCutter_h
@@ -0,0 +1,223 @@
+// Compares CrossSectionCutter with vtkPlaneCutLocator against
+// vtkCutter on the surface of a synthetic airway whose upper third is
+// split in two, so that some planes cut two loops. For each plane
+// both cuts must have the same number of segments and loops, the same
+// length and the same area enclosed by the loops.
+
+// Local includes
+#include "AirwayPhantom.h"
+#include "CrossSectionCutter.h"
+#include "CrossSectionMetrics.h"
+#include "vtkPlaneCutLocator.h"
+
+#include <itkImageToVTKImageFilter.h>
+
+#include <vtkCellArray.h>
+#include <vtkCutter.h>
+#include <vtkDiscreteMarchingCubes.h>
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkPlane.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+  typedef AirwayPhantom::ImageType                       LabelImageType;
+  typedef itk::ImageToVTKImageFilter<LabelImageType>     ConnectorType;
+
+  const int NumberOfPlanes = 20;
+
+  // Largest relative difference allowed between the measures of two
+  // cuts, which only differ by rounding
+  const double MeasureTolerance = 1e-9;
+
+  /*******************************************************************/
+  /** Number of segments and closed loops of a cut, the total length
+   *  of the segments and the sum of the absolute areas of the loops. */
+  /*******************************************************************/
+  struct CutMeasures
+  {
+    vtkIdType Segments;
+    vtkIdType Loops;
+    double    Area;
+    double    Perimeter;
+  };
+
+  /*******************************************************************/
+  /** Measure a cut. The loops are found by following the segments
+   *  from point to point; chains that reach a point that does not end
+   *  exactly two segments, e.g. at a crack of the surface, are not
+   *  loops. */
+  /*******************************************************************/
+  void MeasureCut(vtkPolyData* cut, const double normal[3], CutMeasures & measures)
+  {
+    measures.Segments = cut->GetNumberOfLines();
+    measures.Loops = 0;
+    measures.Area = 0.0;
+    measures.Perimeter = 0.0;
+
+    vtkIdType numberOfPoints = cut->GetNumberOfPoints();
+    std::vector< std::vector<vtkIdType> > neighbors(numberOfPoints);
+    vtkCellArray* lines = cut->GetLines();
+    vtkIdType npts;
+    vtkIdType* pts;
+    for (lines->InitTraversal(); lines->GetNextCell(npts, pts); )
+      {
+      for (vtkIdType i = 0; i + 1 < npts; ++i)
+        {
+        double a[3], b[3];
+        cut->GetPoint(pts[i], a);
+        cut->GetPoint(pts[i + 1], b);
+        measures.Perimeter += std::sqrt(vtkMath::Distance2BetweenPoints(a, b));
+
+        neighbors[pts[i]].push_back(pts[i + 1]);
+        neighbors[pts[i + 1]].push_back(pts[i]);
+        }
+      }
+
+    std::vector<bool> visited(numberOfPoints, false);
+    std::vector<double> loop;
+    for (vtkIdType start = 0; start < numberOfPoints; ++start)
+      {
+      if (visited[start] || neighbors[start].size() != 2)
+        {
+        continue;
+        }
+
+      loop.clear();
+      bool closed = true;
+      vtkIdType previous = -1;
+      vtkIdType current = start;
+      do
+        {
+        double point[3];
+        cut->GetPoint(current, point);
+        loop.insert(loop.end(), point, point + 3);
+        visited[current] = true;
+
+        vtkIdType next = neighbors[current][0] != previous ?
+          neighbors[current][0] : neighbors[current][1];
+        previous = current;
+        current = next;
+        if (neighbors[current].size() != 2)
+          {
+          closed = false;
+          break;
+          }
+        }
+      while (current != start);
+
+      if (closed)
+        {
+        CrossSectionMetrics::LoopMeasures loopMeasures;
+        CrossSectionMetrics::ComputeLoop(&loop[0], loop.size() / 3, normal, loopMeasures);
+        ++measures.Loops;
+        measures.Area += std::abs(loopMeasures.Area);
+        }
+      }
+  }
+
+  /*******************************************************************/
+  /** Whether two measures differ by more than rounding. */
+  /*******************************************************************/
+  bool Differ(double a, double reference)
+  {
+    return std::abs(a - reference) > MeasureTolerance * std::abs(reference);
+  }
+}
+
+int main(int, char*[])
+{
+  AirwayPhantom phantom;
+  phantom.SetBifurcation(true);
+  phantom.Update();
+
+  ConnectorType::Pointer connector = ConnectorType::New();
+  connector->SetInput(phantom.GetLabelImage());
+  connector->Update();
+
+  vtkSmartPointer<vtkDiscreteMarchingCubes> marchingCubes =
+    vtkSmartPointer<vtkDiscreteMarchingCubes>::New();
+  marchingCubes->SetInputData(connector->GetOutput());
+  marchingCubes->SetValue(0, 1);
+  marchingCubes->Update();
+  vtkPolyData* surface = marchingCubes->GetOutput();
+  surface->BuildCells();
+
+  vtkSmartPointer<vtkPlaneCutLocator> locator = vtkSmartPointer<vtkPlaneCutLocator>::New();
+  locator->SetDataSet(surface);
+  locator->BuildLocator();
+
+  // Tilted planes along the airway, so that the cuts do not pass
+  // through the surface points of the marching cubes
+  double bounds[6];
+  surface->GetBounds(bounds);
+  const double normal[3] = { 0.1, 0.2, 1.0 };
+  std::vector<double> origins(3 * NumberOfPlanes);
+  CrossSectionCutter cutter;
+  cutter.SetSurface(surface, locator);
+  for (int p = 0; p < NumberOfPlanes; ++p)
+    {
+    double* origin = &origins[3 * p];
+    origin[0] = 0.5 * (bounds[0] + bounds[1]);
+    origin[1] = 0.5 * (bounds[2] + bounds[3]);
+    origin[2] = bounds[4] + (p + 0.5) * (bounds[5] - bounds[4]) / NumberOfPlanes;
+    cutter.AddPlane(origin, normal);
+    }
+  std::vector< vtkSmartPointer<vtkPolyData> > cuts;
+  cutter.Cut(cuts);
+
+  int status = EXIT_SUCCESS;
+  vtkIdType numberOfSplitCuts = 0;
+  for (int p = 0; p < NumberOfPlanes; ++p)
+    {
+    vtkSmartPointer<vtkPlane> plane = vtkSmartPointer<vtkPlane>::New();
+    plane->SetOrigin(&origins[3 * p]);
+    plane->SetNormal(normal[0], normal[1], normal[2]);
+
+    vtkSmartPointer<vtkCutter> referenceCutter = vtkSmartPointer<vtkCutter>::New();
+    referenceCutter->SetInputData(surface);
+    referenceCutter->SetCutFunction(plane);
+    referenceCutter->Update();
+
+    CutMeasures measures, referenceMeasures;
+    MeasureCut(cuts[p], normal, measures);
+    MeasureCut(referenceCutter->GetOutput(), normal, referenceMeasures);
+
+    std::cout << "Plane " << p << ": "
+              << measures.Segments << " segments, " << measures.Loops << " loops, area "
+              << measures.Area << ", perimeter " << measures.Perimeter << "; vtkCutter "
+              << referenceMeasures.Segments << " segments, " << referenceMeasures.Loops
+              << " loops, area " << referenceMeasures.Area << ", perimeter "
+              << referenceMeasures.Perimeter << std::endl;
+
+    if (measures.Loops == 0 ||
+        measures.Segments != referenceMeasures.Segments ||
+        measures.Loops != referenceMeasures.Loops ||
+        Differ(measures.Area, referenceMeasures.Area) ||
+        Differ(measures.Perimeter, referenceMeasures.Perimeter))
+      {
+      std::cerr << "The cut by plane " << p << " differs from that of vtkCutter" << std::endl;
+      status = EXIT_FAILURE;
+      }
+    if (measures.Loops > 1)
+      {
+      ++numberOfSplitCuts;
+      }
+    }
+
+  // The planes through the branches must have been checked too
+  if (numberOfSplitCuts == 0)
+    {
+    std::cerr << "No plane cut both branches of the airway" << std::endl;
+    status = EXIT_FAILURE;
+    }
+
+  return status;
+}
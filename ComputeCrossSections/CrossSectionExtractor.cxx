@@ -0,0 +1,553 @@
+#include "CrossSectionExtractor.h"
+
+#include "vtkContourCompleter.h"
+#include "vtkPlaneCutLocator.h"
+
+#include <vtkCellArray.h>
+#include <vtkContourTriangulator.h>
+#include <vtkIdList.h>
+#include <vtkMath.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+#include <cmath>
+
+namespace
+{
+  // Root of a point in the union-find forest of the connected regions
+  vtkIdType FindRegionRoot(std::vector<vtkIdType> & parent, vtkIdType ptId)
+  {
+    while ( parent[ptId] != ptId )
+      {
+      parent[ptId] = parent[parent[ptId]];
+      ptId = parent[ptId];
+      }
+    return ptId;
+  }
+
+  // Triangles gathered per call to CrossSectionMetrics::AddTriangleMoments()
+  const size_t TriangleBlockSize = 256;
+
+  // Copy the corners of the cells of a legacy connectivity array, from
+  // the cell at offset on, into corners in structure-of-arrays form
+  // until TriangleBlockSize triangles are copied. Cells with more than
+  // three points count as the triangle of their first three points.
+  // Returns the number of triangles copied and advances offset.
+  template <class TPoint>
+  size_t GatherTriangles( const TPoint* points, const vtkIdType* cells,
+                          vtkIdType numberOfEntries, vtkIdType & offset,
+                          double* corners )
+  {
+    size_t numberOfTriangles = 0;
+    while ( offset < numberOfEntries && numberOfTriangles < TriangleBlockSize )
+      {
+      vtkIdType numberOfIds = cells[offset];
+      const vtkIdType* ids = cells + offset + 1;
+      offset += numberOfIds + 1;
+      if ( numberOfIds < 3 )
+        {
+        continue;
+        }
+
+      for ( int k = 0; k < 3; ++k )
+        {
+        const TPoint* x = points + 3*ids[k];
+        for ( int c = 0; c < 3; ++c )
+          {
+          corners[( 3*k + c ) * TriangleBlockSize + numberOfTriangles] = x[c];
+          }
+        }
+      ++numberOfTriangles;
+      }
+    return numberOfTriangles;
+  }
+}
+
+//----------------------------------------------------------------------------
+CrossSectionExtractor::CrossSectionExtractor()
+{
+  this->Contours = NULL;
+  this->NumberOfRegions = 0;
+
+  this->Completer = vtkSmartPointer<vtkContourCompleter>::New();
+
+  this->Loops = vtkSmartPointer<vtkPolyData>::New();
+  this->Triangulator = vtkSmartPointer<vtkContourTriangulator>::New();
+  this->Triangulator->TriangulationErrorDisplayOn();
+  this->Triangulator->SetInputData( this->Loops );
+
+  this->ContourRegion = vtkSmartPointer<vtkPolyData>::New();
+  this->PointIds = vtkSmartPointer<vtkIdList>::New();
+  this->NewPointIds = vtkSmartPointer<vtkIdList>::New();
+}
+
+//----------------------------------------------------------------------------
+CrossSectionExtractor::~CrossSectionExtractor()
+{
+}
+
+//----------------------------------------------------------------------------
+void CrossSectionExtractor::SetContours(vtkPolyData* contours)
+{
+  this->Contours = contours;
+  this->ContourPointMap.assign( contours->GetNumberOfPoints(), -1 );
+}
+
+//----------------------------------------------------------------------------
+void CrossSectionExtractor::SetSurface(vtkPolyData* surface,
+                                       const vtkPlaneCutLocator* locator)
+{
+  this->Cutter.SetSurface( surface, locator );
+}
+
+//----------------------------------------------------------------------------
+void CrossSectionExtractor::ComputeCandidatePlanes(const std::vector<vtkIdType> & contourCells,
+                                                   bool separateRegions,
+                                                   ContourCrossSections & sections)
+{
+  sections.SelectedCandidate = -1;
+  sections.SelectedRegion = -1;
+  sections.Geometry = NULL;
+
+  // Extract contour for the nearest scalar value
+  sections.Contour = vtkSmartPointer<vtkPolyData>::New();
+  this->ExtractCells( this->Contours, contourCells, this->ContourPointMap,
+                      sections.Contour );
+
+  this->NumberOfRegions = 0;
+  sections.PointRegion.clear();
+  if ( separateRegions )
+    {
+    this->LabelConnectedRegions( sections.Contour, sections.PointRegion );
+    }
+
+  if ( this->NumberOfRegions <= 1 )
+    {
+    // The surface is cut by the plane through the center of mass of
+    // the contour with its average normal
+    sections.Candidates.resize( 1 );
+    Candidate & candidate = sections.Candidates[0];
+    this->ComputeMoments( sections.Contour, candidate.Origin, candidate.Normal );
+    return;
+    }
+
+  sections.Candidates.resize( this->NumberOfRegions );
+  this->RegionPointMap.assign( sections.Contour->GetNumberOfPoints(), -1 );
+  for ( size_t r = 0; r < this->NumberOfRegions; ++r )
+    {
+    this->ExtractCells( sections.Contour, this->RegionCells[r], this->RegionPointMap,
+                        this->ContourRegion );
+    Candidate & candidate = sections.Candidates[r];
+    this->ComputeMoments( this->ContourRegion, candidate.Origin, candidate.Normal );
+    }
+}
+
+//----------------------------------------------------------------------------
+void CrossSectionExtractor::CutCandidates(ContourCrossSections* sections,
+                                          size_t numberOfContours)
+{
+  this->Cutter.RemoveAllPlanes();
+  for ( size_t i = 0; i < numberOfContours; ++i )
+    {
+    for ( size_t c = 0; c < sections[i].Candidates.size(); ++c )
+      {
+      const Candidate & candidate = sections[i].Candidates[c];
+      this->Cutter.AddPlane( candidate.Origin, candidate.Normal );
+      }
+    }
+  this->Cutter.Cut( this->Cuts );
+
+  size_t plane = 0;
+  for ( size_t i = 0; i < numberOfContours; ++i )
+    {
+    for ( size_t c = 0; c < sections[i].Candidates.size(); ++c, ++plane )
+      {
+      Candidate & candidate = sections[i].Candidates[c];
+      candidate.NumberOfCutTriangles = this->Cuts[plane]->GetNumberOfCells();
+      this->Completer->SetInputData( this->Cuts[plane] );
+      this->Completer->Update();
+
+      // Keep the result, not the pipeline
+      candidate.Cut = vtkSmartPointer<vtkPolyData>::New();
+      candidate.Cut->DeepCopy( this->Completer->GetOutput() );
+
+      this->ComputeRegions( candidate.Normal, candidate );
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+void CrossSectionExtractor::ComputeGeometry(ContourCrossSections & sections)
+{
+  sections.Geometry = NULL;
+  if ( sections.SelectedRegion < 0 )
+    {
+    return;
+    }
+
+  const Candidate & candidate = sections.Candidates[sections.SelectedCandidate];
+  const Region & region = candidate.Regions[sections.SelectedRegion];
+
+  this->CutPointMap.assign( candidate.Cut->GetNumberOfPoints(), -1 );
+  this->ExtractCells( candidate.Cut, region.Loops, this->CutPointMap, this->Loops );
+  this->Triangulator->Update();
+
+  // The triangulation shares the points of Loops, which are reused
+  sections.Geometry = vtkSmartPointer<vtkPolyData>::New();
+  sections.Geometry->DeepCopy( this->Triangulator->GetOutput() );
+}
+
+//----------------------------------------------------------------------------
+vtkIdType CrossSectionExtractor::FindClosestPoint(vtkPolyData* pd, const double x[3])
+{
+  vtkIdType closestId = -1;
+  double minDist2 = VTK_DOUBLE_MAX;
+  for ( vtkIdType ptId = 0; ptId < pd->GetNumberOfPoints(); ++ptId )
+    {
+    double p[3];
+    pd->GetPoint( ptId, p );
+    double dist2 = vtkMath::Distance2BetweenPoints( p, x );
+    if ( closestId < 0 || dist2 < minDist2 )
+      {
+      closestId = ptId;
+      minDist2 = dist2;
+      }
+    }
+  return closestId;
+}
+
+//----------------------------------------------------------------------------
+void CrossSectionExtractor::ExtractCells(vtkPolyData* input,
+                                         const std::vector<vtkIdType> & cellIds,
+                                         std::vector<vtkIdType> & pointMap,
+                                         vtkPolyData* output)
+{
+  vtkPoints* points = output->GetPoints();
+  if ( points )
+    {
+    // Keeps the memory of the points and cell arrays
+    output->Reset();
+    }
+  else
+    {
+    vtkSmartPointer<vtkPoints> newPoints = vtkSmartPointer<vtkPoints>::New();
+    newPoints->SetDataType( input->GetPoints()->GetDataType() );
+    output->Initialize();
+    output->SetPoints( newPoints );
+    output->Allocate( static_cast<vtkIdType>( cellIds.size() ) );
+    points = newPoints;
+    }
+
+  vtkIdList* ptIds = this->PointIds;
+  vtkIdList* newPtIds = this->NewPointIds;
+  this->UsedPoints.clear();
+  for ( size_t i = 0; i < cellIds.size(); ++i )
+    {
+    input->GetCellPoints( cellIds[i], ptIds );
+    newPtIds->SetNumberOfIds( ptIds->GetNumberOfIds() );
+    for ( vtkIdType j = 0; j < ptIds->GetNumberOfIds(); ++j )
+      {
+      vtkIdType ptId = ptIds->GetId( j );
+      if ( pointMap[ptId] < 0 )
+        {
+        double x[3];
+        input->GetPoint( ptId, x );
+        pointMap[ptId] = points->InsertNextPoint( x );
+        this->UsedPoints.push_back( ptId );
+        }
+      newPtIds->SetId( j, pointMap[ptId] );
+      }
+    output->InsertNextCell( input->GetCellType( cellIds[i] ), newPtIds );
+    }
+
+  for ( size_t i = 0; i < this->UsedPoints.size(); ++i )
+    {
+    pointMap[this->UsedPoints[i]] = -1;
+    }
+
+  output->Modified();
+}
+
+//----------------------------------------------------------------------------
+void CrossSectionExtractor::LabelConnectedRegions(vtkPolyData* pd,
+                                                  std::vector<vtkIdType> & pointRegion)
+{
+  vtkIdType numPts = pd->GetNumberOfPoints();
+  std::vector<vtkIdType> & parent = this->Parent;
+  parent.resize( numPts );
+  for ( vtkIdType ptId = 0; ptId < numPts; ++ptId )
+    {
+    parent[ptId] = ptId;
+    }
+
+  vtkIdList* ptIds = this->PointIds;
+  for ( vtkIdType cellId = 0; cellId < pd->GetNumberOfCells(); ++cellId )
+    {
+    pd->GetCellPoints( cellId, ptIds );
+    for ( vtkIdType i = 1; i < ptIds->GetNumberOfIds(); ++i )
+      {
+      vtkIdType root0 = FindRegionRoot( parent, ptIds->GetId( 0 ) );
+      vtkIdType root1 = FindRegionRoot( parent, ptIds->GetId( i ) );
+      parent[root1] = root0;
+      }
+    }
+
+  pointRegion.assign( numPts, -1 );
+  this->RootRegion.assign( numPts, -1 );
+  this->NumberOfRegions = 0;
+  for ( vtkIdType cellId = 0; cellId < pd->GetNumberOfCells(); ++cellId )
+    {
+    pd->GetCellPoints( cellId, ptIds );
+    if ( ptIds->GetNumberOfIds() == 0 )
+      {
+      continue;
+      }
+
+    vtkIdType root = FindRegionRoot( parent, ptIds->GetId( 0 ) );
+    if ( this->RootRegion[root] < 0 )
+      {
+      // Region cell lists are kept between calls to reuse their memory
+      this->RootRegion[root] = static_cast<vtkIdType>( this->NumberOfRegions++ );
+      if ( this->RegionCells.size() < this->NumberOfRegions )
+        {
+        this->RegionCells.resize( this->NumberOfRegions );
+        }
+      this->RegionCells[this->NumberOfRegions - 1].clear();
+      }
+    vtkIdType region = this->RootRegion[root];
+    this->RegionCells[region].push_back( cellId );
+    for ( vtkIdType i = 0; i < ptIds->GetNumberOfIds(); ++i )
+      {
+      pointRegion[ptIds->GetId( i )] = region;
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+double CrossSectionExtractor::ComputeMoments(vtkPolyData* pd, double centerOfMass[3],
+                                             double averageNormal[3])
+{
+  CrossSectionMetrics::TriangleMoments moments;
+  moments.Area = 0.0;
+  for ( int i = 0; i < 3; ++i )
+    {
+    moments.Center[i] = moments.Normal[i] = 0.0;
+    }
+
+  // Read the connectivity and the coordinates directly, a block of
+  // triangles at a time
+  vtkCellArray* ca = pd->GetPolys();
+  vtkPoints* points = pd->GetPoints();
+  if ( ca && points )
+    {
+    const vtkIdType* cells = ca->GetPointer();
+    vtkIdType numberOfEntries = ca->GetNumberOfConnectivityEntries();
+
+    const float* floatPoints = NULL;
+    const double* doublePoints = NULL;
+    if ( points->GetDataType() == VTK_FLOAT )
+      {
+      floatPoints = static_cast<const float*>( points->GetVoidPointer( 0 ) );
+      }
+    else if ( points->GetDataType() == VTK_DOUBLE )
+      {
+      doublePoints = static_cast<const double*>( points->GetVoidPointer( 0 ) );
+      }
+    else
+      {
+      this->PointCoordinates.resize( 3 * points->GetNumberOfPoints() );
+      for ( vtkIdType ptId = 0; ptId < points->GetNumberOfPoints(); ++ptId )
+        {
+        points->GetPoint( ptId, &this->PointCoordinates[3*ptId] );
+        }
+      doublePoints = this->PointCoordinates.empty() ? NULL : &this->PointCoordinates[0];
+      }
+
+    this->TriangleCorners.resize( 9 * TriangleBlockSize );
+    const double* corners[9];
+    for ( int j = 0; j < 9; ++j )
+      {
+      corners[j] = &this->TriangleCorners[j * TriangleBlockSize];
+      }
+
+    vtkIdType offset = 0;
+    while ( offset < numberOfEntries )
+      {
+      size_t numberOfTriangles = floatPoints ?
+        GatherTriangles( floatPoints, cells, numberOfEntries, offset,
+                         &this->TriangleCorners[0] ) :
+        GatherTriangles( doublePoints, cells, numberOfEntries, offset,
+                         &this->TriangleCorners[0] );
+      CrossSectionMetrics::AddTriangleMoments( corners, numberOfTriangles, moments );
+      }
+    }
+
+  double totalArea = moments.Area;
+  for ( int i = 0; i < 3; ++i )
+    {
+    centerOfMass[i]  = totalArea > 0.0 ? moments.Center[i] / totalArea : 0.0;
+    averageNormal[i] = totalArea > 0.0 ? moments.Normal[i] / totalArea : 0.0;
+    }
+
+  return totalArea;
+}
+
+//----------------------------------------------------------------------------
+void CrossSectionExtractor::ComputeRegions(const double normal[3], Candidate & candidate)
+{
+  vtkPolyData* cut = candidate.Cut;
+  candidate.PointRegion.assign( cut->GetNumberOfPoints(), -1 );
+  candidate.Regions.clear();
+
+  // Gather the points of the loops
+  this->LoopCells.clear();
+  this->LoopOffsets.assign( 1, 0 );
+  this->LoopPointIds.clear();
+  this->LoopPoints.clear();
+  double loopNormal[3] = { 0.0, 0.0, 0.0 };
+  vtkIdList* ptIds = this->PointIds;
+  for ( vtkIdType cellId = 0; cellId < cut->GetNumberOfCells(); ++cellId )
+    {
+    cut->GetCellPoints( cellId, ptIds );
+    vtkIdType numIds = ptIds->GetNumberOfIds();
+    if ( numIds > 1 && ptIds->GetId( 0 ) == ptIds->GetId( numIds - 1 ) )
+      {
+      --numIds;
+      }
+    if ( numIds < 3 )
+      {
+      continue;
+      }
+
+    size_t first = this->LoopPointIds.size();
+    this->LoopCells.push_back( cellId );
+    this->LoopPointIds.resize( first + numIds );
+    this->LoopPoints.resize( 3 * ( first + numIds ) );
+    for ( vtkIdType i = 0; i < numIds; ++i )
+      {
+      this->LoopPointIds[first + i] = ptIds->GetId( i );
+      cut->GetPoint( ptIds->GetId( i ), &this->LoopPoints[3 * ( first + i )] );
+      }
+    this->LoopOffsets.push_back( first + numIds );
+
+    double newellNormal[3];
+    CrossSectionMetrics::ComputeNewellNormal( &this->LoopPoints[3 * first], numIds,
+                                              newellNormal );
+    vtkMath::Add( loopNormal, newellNormal, loopNormal );
+    }
+
+  // Measure the loops in the cutting plane
+  double planeNormal[3] = { normal[0], normal[1], normal[2] };
+  if ( vtkMath::Normalize( planeNormal ) == 0.0 )
+    {
+    // Degenerate plane, use the orientation of the loops instead
+    planeNormal[0] = loopNormal[0];
+    planeNormal[1] = loopNormal[1];
+    planeNormal[2] = loopNormal[2];
+    if ( vtkMath::Normalize( planeNormal ) == 0.0 )
+      {
+      return;
+      }
+    }
+
+  size_t numLoops = this->LoopCells.size();
+  const std::vector<size_t> & offsets = this->LoopOffsets;
+  std::vector<CrossSectionMetrics::LoopMeasures> & measures = this->LoopMeasures;
+  std::vector<double> & loopArea = this->LoopArea;
+  measures.resize( numLoops );
+  loopArea.resize( numLoops );
+  for ( size_t i = 0; i < numLoops; ++i )
+    {
+    CrossSectionMetrics::ComputeLoop( &this->LoopPoints[3 * offsets[i]],
+                                      offsets[i + 1] - offsets[i],
+                                      planeNormal, measures[i] );
+    loopArea[i] = fabs( measures[i].Area );
+    }
+
+  // A loop is a hole if it lies inside an odd number of larger loops.
+  // It belongs to the smallest of them.
+  std::vector<int> & depth = this->LoopDepth;
+  std::vector<int> & parent = this->LoopParent;
+  depth.assign( numLoops, 0 );
+  parent.assign( numLoops, -1 );
+  for ( size_t j = 0; j < numLoops; ++j )
+    {
+    if ( loopArea[j] == 0.0 )
+      {
+      continue;
+      }
+    for ( size_t i = 0; i < numLoops; ++i )
+      {
+      if ( loopArea[i] > loopArea[j] &&
+           CrossSectionMetrics::Contains( &this->LoopPoints[3 * offsets[i]],
+                                          offsets[i + 1] - offsets[i], planeNormal,
+                                          &this->LoopPoints[3 * offsets[j]] ) )
+        {
+        ++depth[j];
+        if ( parent[j] < 0 || loopArea[i] < loopArea[parent[j]] )
+          {
+          parent[j] = static_cast<int>( i );
+          }
+        }
+      }
+    }
+
+  std::vector<vtkIdType> & loopRegion = this->LoopRegion;
+  loopRegion.assign( numLoops, -1 );
+  for ( int hole = 0; hole < 2; ++hole )
+    {
+    for ( size_t i = 0; i < numLoops; ++i )
+      {
+      if ( loopArea[i] == 0.0 || depth[i] % 2 != hole )
+        {
+        continue;
+        }
+
+      double sign = 1.0;
+      if ( hole )
+        {
+        // Only intersecting loops have holes in holes, skip them
+        if ( loopRegion[parent[i]] < 0 )
+          {
+          continue;
+          }
+        loopRegion[i] = loopRegion[parent[i]];
+        sign = -1.0;
+        }
+      else
+        {
+        loopRegion[i] = static_cast<vtkIdType>( candidate.Regions.size() );
+        candidate.Regions.push_back( Region() );
+        Region & region = candidate.Regions.back();
+        region.Area = 0.0;
+        region.Perimeter = 0.0;
+        region.CenterOfMass[0] = region.CenterOfMass[1] = region.CenterOfMass[2] = 0.0;
+        region.AverageNormal[0] = planeNormal[0];
+        region.AverageNormal[1] = planeNormal[1];
+        region.AverageNormal[2] = planeNormal[2];
+        }
+
+      Region & region = candidate.Regions[loopRegion[i]];
+      region.Loops.push_back( this->LoopCells[i] );
+      region.Area += sign * loopArea[i];
+      region.Perimeter += measures[i].Perimeter;
+      for ( int k = 0; k < 3; ++k )
+        {
+        region.CenterOfMass[k] += sign * loopArea[i] * measures[i].Centroid[k];
+        }
+      for ( size_t k = offsets[i]; k < offsets[i + 1]; ++k )
+        {
+        candidate.PointRegion[this->LoopPointIds[k]] = loopRegion[i];
+        }
+      }
+    }
+
+  for ( size_t r = 0; r < candidate.Regions.size(); ++r )
+    {
+    Region & region = candidate.Regions[r];
+    for ( int k = 0; k < 3; ++k )
+      {
+      region.CenterOfMass[k] = region.Area > 0.0 ? region.CenterOfMass[k] / region.Area : 0.0;
+      }
+    }
+}
@@ -0,0 +1,196 @@
+#ifndef CrossSectionExtractor_h
+#define CrossSectionExtractor_h
+
+#include "CrossSectionCutter.h"
+#include "CrossSectionMetrics.h"
+
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+#include <vector>
+
+class vtkContourCompleter;
+class vtkContourTriangulator;
+class vtkIdList;
+class vtkPlaneCutLocator;
+
+// Description:
+// Computes the cross sections of a surface by the planes through the
+// connected regions of heat flow contours.
+//
+// An extractor owns its filters and scratch buffers and reuses them
+// from one contour to the next, so the only allocations per contour
+// are for the results. Extractors only read the contours and the
+// surface; threads can share those but each thread needs its own
+// extractor. BuildCells() must have been called on the shared poly
+// data beforehand.
+class CrossSectionExtractor
+{
+public:
+  // Description:
+  // One connected region of a planar cross section: an outer loop of
+  // the cut and the loops directly inside it, which are holes.
+  struct Region
+  {
+    // Cells of the cut with the loops of the region
+    std::vector<vtkIdType> Loops;
+
+    double Area;
+    double CenterOfMass[3];
+    double AverageNormal[3];
+    double Perimeter;
+  };
+
+  // Description:
+  // The cross section of the surface by the plane through one
+  // connected region of a heat flow contour.
+  struct Candidate
+  {
+    // Cutting plane: the center of mass and average normal of the
+    // contour region
+    double Origin[3];
+    double Normal[3];
+
+    // Completed cut of the surface, and the number of surface
+    // triangles the plane crossed to make it
+    vtkSmartPointer<vtkPolyData> Cut;
+    vtkIdType                    NumberOfCutTriangles;
+
+    // Region of each point of the cut, -1 for points of no region
+    std::vector<vtkIdType> PointRegion;
+    std::vector<Region>    Regions;
+  };
+
+  // Description:
+  // The cross-section candidates of one heat flow contour. There is
+  // one candidate per connected region of the contour, or a single
+  // one for the whole contour.
+  struct ContourCrossSections
+  {
+    vtkSmartPointer<vtkPolyData> Contour;
+    std::vector<vtkIdType>       PointRegion;
+    std::vector<Candidate>       Candidates;
+
+    // The region chosen to continue the centerline, if any, and its
+    // triangulation
+    int                          SelectedCandidate;
+    int                          SelectedRegion;
+    vtkSmartPointer<vtkPolyData> Geometry;
+  };
+
+  CrossSectionExtractor();
+  ~CrossSectionExtractor();
+
+  // Description:
+  // Set the heat flow contours the contour cells refer to.
+  void SetContours(vtkPolyData* contours);
+
+  // Description:
+  // Set the surface to cut and a locator built on it.
+  void SetSurface(vtkPolyData* surface, const vtkPlaneCutLocator* locator);
+
+  // Description:
+  // Compute the cutting planes of the cross-section candidates of the
+  // contour made of the given contour cells. If separateRegions is
+  // false the whole contour gives a single candidate.
+  void ComputeCandidatePlanes(const std::vector<vtkIdType> & contourCells,
+                              bool separateRegions, ContourCrossSections & sections);
+
+  // Description:
+  // Cut the surface by the planes of all candidates of
+  // numberOfContours contours at once and measure the regions of each
+  // cut. The planes must have been computed with
+  // ComputeCandidatePlanes().
+  void CutCandidates(ContourCrossSections* sections, size_t numberOfContours);
+
+  // Description:
+  // Triangulate the selected region of a contour into its Geometry.
+  void ComputeGeometry(ContourCrossSections & sections);
+
+  // Description:
+  // Get the first point of pd closest to x, or -1 if pd has no
+  // points. This is the seed point vtkPolyDataConnectivityFilter uses
+  // in closest point region mode.
+  static vtkIdType FindClosestPoint(vtkPolyData* pd, const double x[3]);
+
+private:
+  CrossSectionExtractor(const CrossSectionExtractor&); // Not implemented
+  void operator=(const CrossSectionExtractor&); // Not implemented
+
+  // Description:
+  // Copy the given cells and the points they use into output, reusing
+  // the memory of output. pointMap must have one entry per input
+  // point, all -1, and is left that way.
+  void ExtractCells(vtkPolyData* input, const std::vector<vtkIdType> & cellIds,
+                    std::vector<vtkIdType> & pointMap, vtkPolyData* output);
+
+  // Description:
+  // Label the connected regions of pd. As in
+  // vtkPolyDataConnectivityFilter, cells are connected if they share
+  // a point. Regions are numbered in the order of their first cell
+  // and points not used by any cell are labeled -1.
+  void LabelConnectedRegions(vtkPolyData* pd, std::vector<vtkIdType> & pointRegion);
+
+  // Description:
+  // Center of mass and average normal of the triangles of pd, i.e.,
+  // the averages of the triangle centers and normals weighted by the
+  // triangle areas. Returns the total area. The center and normal are
+  // zero if the total area is zero. The points and connectivity are
+  // read directly and measured with
+  // CrossSectionMetrics::AddTriangleMoments().
+  double ComputeMoments(vtkPolyData* pd, double centerOfMass[3], double averageNormal[3]);
+
+  // Description:
+  // Split the closed loops of a cut into regions and measure them.
+  // normal orients the plane of the cut. Loops without area are
+  // ignored, like the triangulation would.
+  void ComputeRegions(const double normal[3], Candidate & candidate);
+
+  vtkPolyData*               Contours;
+
+  // Batch of cuts, each completed in turn
+  CrossSectionCutter                      Cutter;
+  std::vector< vtkSmartPointer<vtkPolyData> > Cuts;
+  vtkSmartPointer<vtkContourCompleter>    Completer;
+
+  // Triangulation pipeline, fed by Loops
+  vtkSmartPointer<vtkPolyData>            Loops;
+  vtkSmartPointer<vtkContourTriangulator> Triangulator;
+
+  vtkSmartPointer<vtkPolyData>            ContourRegion;
+  vtkSmartPointer<vtkIdList>              PointIds;
+  vtkSmartPointer<vtkIdList>              NewPointIds;
+
+  // Point maps of ExtractCells() for each input
+  std::vector<vtkIdType>                  ContourPointMap;
+  std::vector<vtkIdType>                  RegionPointMap;
+  std::vector<vtkIdType>                  CutPointMap;
+  std::vector<vtkIdType>                  UsedPoints;
+
+  // Triangle corners of ComputeMoments() in structure-of-arrays form,
+  // and point coordinates of other types than float and double
+  std::vector<double>                     TriangleCorners;
+  std::vector<double>                     PointCoordinates;
+
+  // Connected regions: union-find forest over the points and the
+  // cells of each region
+  std::vector<vtkIdType>                  Parent;
+  std::vector<vtkIdType>                  RootRegion;
+  std::vector< std::vector<vtkIdType> >   RegionCells;
+  size_t                                  NumberOfRegions;
+
+  // Loops of a cut. The points of loop i are entries
+  // [LoopOffsets[i], LoopOffsets[i+1]) of LoopPointIds, with their
+  // coordinates in LoopPoints.
+  std::vector<vtkIdType>                  LoopCells;
+  std::vector<size_t>                     LoopOffsets;
+  std::vector<vtkIdType>                  LoopPointIds;
+  std::vector<double>                     LoopPoints;
+  std::vector<CrossSectionMetrics::LoopMeasures> LoopMeasures;
+  std::vector<double>                     LoopArea;
+  std::vector<int>                        LoopDepth;
+  std::vector<int>                        LoopParent;
+  std::vector<vtkIdType>                  LoopRegion;
+};
+
+#endif // CrossSectionExtractor_h
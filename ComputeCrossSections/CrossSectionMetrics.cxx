@@ -0,0 +1,174 @@
+#include "CrossSectionMetrics.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  // Triangles measured per block of AddTriangleMoments()
+  const size_t MomentBlockSize = 64;
+}
+
+//----------------------------------------------------------------------------
+void CrossSectionMetrics::ComputeLoop(const double* points, size_t numberOfPoints,
+                                      const double normal[3], LoopMeasures& measures)
+{
+  measures.Area = 0.0;
+  measures.Perimeter = 0.0;
+  measures.Centroid[0] = measures.Centroid[1] = measures.Centroid[2] = 0.0;
+  if (numberOfPoints == 0)
+    {
+    return;
+    }
+
+  double length = sqrt(normal[0]*normal[0] + normal[1]*normal[1] + normal[2]*normal[2]);
+  double n[3] = { normal[0] / length, normal[1] / length, normal[2] / length };
+
+  for (size_t i = 0; i < numberOfPoints; ++i)
+    {
+    const double* a = points + 3*i;
+    const double* b = points + 3*((i + 1) % numberOfPoints);
+    double d[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+    measures.Perimeter += sqrt(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+    }
+
+  // Fan of triangles from the first point. Coordinates are taken
+  // relative to it to limit round-off.
+  const double* p0 = points;
+  double area = 0.0;
+  double moment[3] = { 0.0, 0.0, 0.0 };
+  for (size_t i = 1; i + 1 < numberOfPoints; ++i)
+    {
+    const double* p1 = points + 3*i;
+    const double* p2 = points + 3*(i + 1);
+    double d1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+    double d2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+    double cross[3] = { d1[1]*d2[2] - d1[2]*d2[1],
+                        d1[2]*d2[0] - d1[0]*d2[2],
+                        d1[0]*d2[1] - d1[1]*d2[0] };
+    double triangleArea = 0.5 * (n[0]*cross[0] + n[1]*cross[1] + n[2]*cross[2]);
+    area += triangleArea;
+    for (int j = 0; j < 3; ++j)
+      {
+      moment[j] += triangleArea * (d1[j] + d2[j]) / 3.0;
+      }
+    }
+
+  measures.Area = area;
+  for (int j = 0; j < 3; ++j)
+    {
+    measures.Centroid[j] = p0[j] + (area != 0.0 ? moment[j] / area : 0.0);
+    }
+}
+
+//----------------------------------------------------------------------------
+void CrossSectionMetrics::ComputeNewellNormal(const double* points, size_t numberOfPoints,
+                                              double normal[3])
+{
+  normal[0] = normal[1] = normal[2] = 0.0;
+  for (size_t i = 0; i < numberOfPoints; ++i)
+    {
+    const double* a = points + 3*i;
+    const double* b = points + 3*((i + 1) % numberOfPoints);
+    normal[0] += (a[1] - b[1]) * (a[2] + b[2]);
+    normal[1] += (a[2] - b[2]) * (a[0] + b[0]);
+    normal[2] += (a[0] - b[0]) * (a[1] + b[1]);
+    }
+}
+
+//----------------------------------------------------------------------------
+bool CrossSectionMetrics::Contains(const double* points, size_t numberOfPoints,
+                                   const double normal[3], const double x[3])
+{
+  // Project along the dominant axis of the normal
+  int axis = 0;
+  if (fabs(normal[1]) > fabs(normal[axis]))
+    {
+    axis = 1;
+    }
+  if (fabs(normal[2]) > fabs(normal[axis]))
+    {
+    axis = 2;
+    }
+  int u = (axis + 1) % 3;
+  int v = (axis + 2) % 3;
+
+  // Count the crossings of a ray from x along u
+  bool inside = false;
+  for (size_t i = 0, j = numberOfPoints - 1; i < numberOfPoints; j = i++)
+    {
+    const double* a = points + 3*i;
+    const double* b = points + 3*j;
+    if ((a[v] > x[v]) != (b[v] > x[v]) &&
+        x[u] < a[u] + (b[u] - a[u]) * (x[v] - a[v]) / (b[v] - a[v]))
+      {
+      inside = !inside;
+      }
+    }
+
+  return inside;
+}
+
+//----------------------------------------------------------------------------
+void CrossSectionMetrics::AddTriangleMoments(const double* const corners[9],
+                                             size_t numberOfTriangles,
+                                             TriangleMoments& moments)
+{
+  const double* x0 = corners[0];
+  const double* y0 = corners[1];
+  const double* z0 = corners[2];
+  const double* x1 = corners[3];
+  const double* y1 = corners[4];
+  const double* z1 = corners[5];
+  const double* x2 = corners[6];
+  const double* y2 = corners[7];
+  const double* z2 = corners[8];
+
+  // Twice the area and three times the area-weighted center of each
+  // triangle of a block. The area-weighted unit normal is half the
+  // cross product, so the normal needs no square root.
+  double area[MomentBlockSize];
+  double center[3][MomentBlockSize];
+  double normal[3][MomentBlockSize];
+  for (size_t begin = 0; begin < numberOfTriangles; begin += MomentBlockSize)
+    {
+    size_t count = std::min(MomentBlockSize, numberOfTriangles - begin);
+    for (size_t j = 0; j < count; ++j)
+      {
+      size_t i = begin + j;
+      double ux = x1[i] - x0[i], uy = y1[i] - y0[i], uz = z1[i] - z0[i];
+      double vx = x2[i] - x0[i], vy = y2[i] - y0[i], vz = z2[i] - z0[i];
+      double nx = uy*vz - uz*vy;
+      double ny = uz*vx - ux*vz;
+      double nz = ux*vy - uy*vx;
+      double a = sqrt(nx*nx + ny*ny + nz*nz);
+      area[j] = a;
+      center[0][j] = a * (x0[i] + x1[i] + x2[i]);
+      center[1][j] = a * (y0[i] + y1[i] + y2[i]);
+      center[2][j] = a * (z0[i] + z1[i] + z2[i]);
+      normal[0][j] = nx;
+      normal[1][j] = ny;
+      normal[2][j] = nz;
+      }
+
+    double blockArea = 0.0;
+    double blockCenter[3] = { 0.0, 0.0, 0.0 };
+    double blockNormal[3] = { 0.0, 0.0, 0.0 };
+    for (size_t j = 0; j < count; ++j)
+      {
+      blockArea += area[j];
+      for (int c = 0; c < 3; ++c)
+        {
+        blockCenter[c] += center[c][j];
+        blockNormal[c] += normal[c][j];
+        }
+      }
+
+    moments.Area += 0.5 * blockArea;
+    for (int c = 0; c < 3; ++c)
+      {
+      moments.Center[c] += blockCenter[c] / 6.0;
+      moments.Normal[c] += 0.5 * blockNormal[c];
+      }
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef CrossSectionMetrics_h
+#define CrossSectionMetrics_h
+
+#include <cstddef>
+
+// Description:
+// Measures of planar cross sections bounded by closed loops, computed
+// directly from the loop points without triangulating the loops.
+// Points are passed as consecutive xyz triples.
+class CrossSectionMetrics
+{
+public:
+  // Description:
+  // Area, centroid and perimeter of a closed loop. The area is
+  // positive if the loop runs counterclockwise about the normal used
+  // to measure it.
+  struct LoopMeasures
+  {
+    double Area;
+    double Centroid[3];
+    double Perimeter;
+  };
+
+  // Description:
+  // Sums over a set of triangles of the area, the area-weighted
+  // center and the area-weighted unit normal.
+  struct TriangleMoments
+  {
+    double Area;
+    double Center[3];
+    double Normal[3];
+  };
+
+  // Description:
+  // Measure the loop through numberOfPoints points. The last point
+  // is connected to the first. The normal does not need to have unit
+  // length but must not be zero.
+  static void ComputeLoop(const double* points, size_t numberOfPoints,
+                          const double normal[3], LoopMeasures& measures);
+
+  // Description:
+  // Compute the Newell normal of the loop, i.e., its unit normal
+  // scaled by twice its area.
+  static void ComputeNewellNormal(const double* points, size_t numberOfPoints,
+                                  double normal[3]);
+
+  // Description:
+  // Return whether x is inside the loop when both are projected onto
+  // the plane with the given normal.
+  static bool Contains(const double* points, size_t numberOfPoints,
+                       const double normal[3], const double x[3]);
+
+  // Description:
+  // Add the moments of numberOfTriangles triangles to moments. The
+  // triangles are in structure-of-arrays form: corners[3*k + c][i] is
+  // coordinate c of corner k of triangle i. The triangles are measured
+  // in blocks without dependencies between iterations, so the compiler
+  // can vectorize the loop.
+  static void AddTriangleMoments(const double* const corners[9],
+                                 size_t numberOfTriangles,
+                                 TriangleMoments& moments);
+};
+
+#endif // CrossSectionMetrics_h
@@ -0,0 +1,283 @@
+#include "CrossSectionSweep.h"
+
+#include "Profiler.h"
+#include "itkThreadedRange.h"
+
+#include <itkMultiThreader.h>
+
+#include <vtkIdTypeArray.h>
+#include <vtkPolyData.h>
+
+#include <algorithm>
+
+namespace
+{
+  typedef CrossSectionSweep::ContourCrossSections ContourCrossSections;
+
+  // Compute the cross-section candidates of a range of contours with
+  // one extractor per thread. Entry i of CrossSections is for contour
+  // ContourOffset + i.
+  struct CrossSectionCandidatesFunctor
+  {
+    vtkPolyData*                                  Contours;
+    const std::vector< std::vector<vtkIdType> > * ContourCells;
+    vtkPolyData*                                  Surface;
+    const vtkPlaneCutLocator*                     SurfaceLocator;
+    std::vector<ContourCrossSections> *           CrossSections;
+
+    // The contour whose regions are not separated
+    vtkIdType                                     FirstContour;
+
+    // The contour of the first entry of CrossSections
+    vtkIdType                                     ContourOffset;
+
+    void operator()(itk::SizeValueType, itk::SizeValueType begin, itk::SizeValueType end)
+    {
+      CrossSectionExtractor extractor;
+      extractor.SetContours(Contours);
+      extractor.SetSurface(Surface, SurfaceLocator);
+
+      for (itk::SizeValueType i = begin; i < end; ++i)
+        {
+        vtkIdType contourID = ContourOffset + static_cast<vtkIdType>(i);
+        extractor.ComputeCandidatePlanes((*ContourCells)[contourID],
+                                         contourID != FirstContour,
+                                         (*CrossSections)[i]);
+        }
+
+      // All planes of the range are known, cut them in one batch
+      if (begin < end)
+        {
+        extractor.CutCandidates(&(*CrossSections)[begin], end - begin);
+        }
+    }
+  };
+
+  // Triangulate the selected cross-section regions of a range of
+  // contours for the output geometry.
+  struct CrossSectionGeometryFunctor
+  {
+    std::vector<ContourCrossSections> * CrossSections;
+
+    void operator()(itk::SizeValueType, itk::SizeValueType begin, itk::SizeValueType end)
+    {
+      CrossSectionExtractor extractor;
+      for (itk::SizeValueType i = begin; i < end; ++i)
+        {
+        extractor.ComputeGeometry((*CrossSections)[i]);
+        }
+    }
+  };
+}
+
+//----------------------------------------------------------------------------
+CrossSectionSweep::CrossSectionSweep()
+{
+  this->Contours = NULL;
+  this->ContourCells = NULL;
+  this->Surface = NULL;
+  this->SurfaceLocator = NULL;
+  this->NumberOfThreads = 0;
+  this->Observer = NULL;
+  this->CenterlinePoint[0] = this->CenterlinePoint[1] = this->CenterlinePoint[2] = 0.0;
+  this->NumberOfCuttingPlanes = 0;
+  this->NumberOfCutTriangles = 0;
+}
+
+//----------------------------------------------------------------------------
+CrossSectionSweep::~CrossSectionSweep()
+{
+}
+
+//----------------------------------------------------------------------------
+void CrossSectionSweep::BucketCellsByContour(vtkIdTypeArray* contourIDs,
+                                             vtkIdType numberOfValues,
+                                             std::vector<vtkIdType> & valueIndices,
+                                             std::vector< std::vector<vtkIdType> > & contourCells)
+{
+  std::vector< std::vector<vtkIdType> > cells(numberOfValues);
+  for (vtkIdType cellId = 0; cellId < contourIDs->GetNumberOfTuples(); ++cellId)
+    {
+    vtkIdType contour = contourIDs->GetValue(cellId);
+    if (contour >= 0 && contour < numberOfValues)
+      {
+      cells[contour].push_back(cellId);
+      }
+    }
+
+  valueIndices.clear();
+  contourCells.clear();
+  for (vtkIdType contour = 0; contour < numberOfValues; ++contour)
+    {
+    if (!cells[contour].empty())
+      {
+      valueIndices.push_back(contour);
+      contourCells.push_back(std::vector<vtkIdType>());
+      contourCells.back().swap(cells[contour]);
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+void CrossSectionSweep::SetContours(vtkPolyData* contours,
+                                    const std::vector< std::vector<vtkIdType> > * contourCells)
+{
+  this->Contours = contours;
+  this->ContourCells = contourCells;
+}
+
+//----------------------------------------------------------------------------
+void CrossSectionSweep::SetSurface(vtkPolyData* surface, const vtkPlaneCutLocator* locator)
+{
+  this->Surface = surface;
+  this->SurfaceLocator = locator;
+}
+
+//----------------------------------------------------------------------------
+void CrossSectionSweep::SetNumberOfThreads(int numberOfThreads)
+{
+  this->NumberOfThreads = numberOfThreads;
+}
+
+//----------------------------------------------------------------------------
+void CrossSectionSweep::SetObserver(WindowObserver* observer)
+{
+  this->Observer = observer;
+}
+
+//----------------------------------------------------------------------------
+bool CrossSectionSweep::Run(std::vector<Measures> & measures)
+{
+  vtkIdType numContours = static_cast<vtkIdType>(this->ContourCells->size());
+  measures.resize(numContours);
+  this->CenterlinePoint[0] = this->CenterlinePoint[1] = this->CenterlinePoint[2] = 0.0;
+  this->NumberOfCuttingPlanes = 0;
+  this->NumberOfCutTriangles = 0;
+
+  // The threads only read the shared data sets once their cells are
+  // built
+  this->Contours->BuildCells();
+  this->Surface->BuildCells();
+
+  itk::ThreadIdType threads = this->NumberOfThreads > 0 ?
+    static_cast<itk::ThreadIdType>(this->NumberOfThreads) :
+    itk::MultiThreader::GetGlobalDefaultNumberOfThreads();
+
+  vtkIdType windowSize = 4 * static_cast<vtkIdType>(threads);
+  std::vector<ContourCrossSections> crossSections;
+
+  CrossSectionCandidatesFunctor candidatesFunctor;
+  candidatesFunctor.Contours = this->Contours;
+  candidatesFunctor.ContourCells = this->ContourCells;
+  candidatesFunctor.Surface = this->Surface;
+  candidatesFunctor.SurfaceLocator = this->SurfaceLocator;
+  candidatesFunctor.CrossSections = &crossSections;
+  candidatesFunctor.FirstContour = numContours - 1;
+
+  CrossSectionGeometryFunctor geometryFunctor;
+  geometryFunctor.CrossSections = &crossSections;
+
+  for (vtkIdType windowEnd = numContours; windowEnd > 0; )
+    {
+    vtkIdType windowBegin = std::max(windowEnd - windowSize, static_cast<vtkIdType>(0));
+    itk::SizeValueType windowContours = static_cast<itk::SizeValueType>(windowEnd - windowBegin);
+
+    crossSections.assign(windowContours, ContourCrossSections());
+    candidatesFunctor.ContourOffset = windowBegin;
+    {
+      ProfileTimer timer("cut candidates");
+      itk::ThreadedRange::Execute(threads,
+        itk::ThreadedRange::GetNumberOfChunks(threads, windowContours),
+        windowContours, candidatesFunctor);
+    }
+
+    {
+      ProfileTimer timer("select regions");
+      this->SelectRegions(windowBegin, windowEnd, crossSections, measures);
+    }
+
+    // The measures come from the loops of the cuts; only the selected
+    // cross sections are triangulated for the output geometry.
+    {
+      ProfileTimer timer("triangulate cross sections");
+      itk::ThreadedRange::Execute(threads,
+        itk::ThreadedRange::GetNumberOfChunks(threads, windowContours),
+        windowContours, geometryFunctor);
+    }
+
+    if (this->Observer &&
+        !this->Observer->ProcessWindow(windowBegin, crossSections, measures))
+      {
+      return false;
+      }
+
+    windowEnd = windowBegin;
+    }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void CrossSectionSweep::SelectRegions(vtkIdType windowBegin, vtkIdType windowEnd,
+                                      std::vector<ContourCrossSections> & crossSections,
+                                      std::vector<Measures> & measures)
+{
+  vtkIdType numContours = static_cast<vtkIdType>(measures.size());
+  for (vtkIdType contourID = windowEnd-1; contourID >= windowBegin; --contourID)
+    {
+    ContourCrossSections & sections = crossSections[contourID - windowBegin];
+    this->NumberOfCuttingPlanes += static_cast<vtkIdType>(sections.Candidates.size());
+    for (size_t c = 0; c < sections.Candidates.size(); ++c)
+      {
+      this->NumberOfCutTriangles += sections.Candidates[c].NumberOfCutTriangles;
+      }
+
+    // Pick the region of the contour closest to the centerline
+    size_t candidateID = 0;
+    if (sections.Candidates.size() > 1)
+      {
+      vtkIdType ptId = CrossSectionExtractor::FindClosestPoint(sections.Contour, this->CenterlinePoint);
+      if (ptId >= 0 && sections.PointRegion[ptId] >= 0)
+        {
+        candidateID = static_cast<size_t>(sections.PointRegion[ptId]);
+        }
+      }
+    const CrossSectionExtractor::Candidate & candidate = sections.Candidates[candidateID];
+
+    // and the region of its cross section closest to the centerline
+    sections.SelectedCandidate = static_cast<int>(candidateID);
+    sections.SelectedRegion = -1;
+    vtkIdType closestId = CrossSectionExtractor::FindClosestPoint(candidate.Cut, this->CenterlinePoint);
+    if (closestId >= 0 && candidate.PointRegion[closestId] >= 0)
+      {
+      sections.SelectedRegion = static_cast<int>(candidate.PointRegion[closestId]);
+      }
+
+    Measures & measure = measures[contourID];
+    if (sections.SelectedRegion < 0)
+      {
+      // Carry the centerline over from the next contour, if any
+      measure.Area = 0.0;
+      measure.Perimeter = 0.0;
+      for (int i = 0; i < 3; ++i)
+        {
+        measure.CenterOfMass[i] =
+          contourID + 1 < numContours ? measures[contourID + 1].CenterOfMass[i] : 0.0;
+        measure.AverageNormal[i] =
+          contourID + 1 < numContours ? measures[contourID + 1].AverageNormal[i] : 0.0;
+        }
+      continue;
+      }
+
+    const CrossSectionExtractor::Region & region = candidate.Regions[sections.SelectedRegion];
+    if (region.Area > 0.0)
+      {
+      std::copy(region.CenterOfMass, region.CenterOfMass + 3, this->CenterlinePoint);
+      }
+
+    measure.Area = region.Area;
+    measure.Perimeter = region.Perimeter;
+    std::copy(region.CenterOfMass, region.CenterOfMass + 3, measure.CenterOfMass);
+    std::copy(region.AverageNormal, region.AverageNormal + 3, measure.AverageNormal);
+    }
+}
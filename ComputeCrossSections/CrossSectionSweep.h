@@ -0,0 +1,128 @@
+#ifndef CrossSectionSweep_h
+#define CrossSectionSweep_h
+
+#include "CrossSectionExtractor.h"
+
+#include <vtkType.h>
+
+#include <vector>
+
+class vtkIdTypeArray;
+class vtkPlaneCutLocator;
+class vtkPolyData;
+
+// Description:
+// Computes the cross sections of a surface along a sequence of heat
+// flow contours, from the last contour to the first, following the
+// centerline: the cross section of each contour is the region closest
+// to the center of mass of the previous one.
+//
+// The cross section of a contour depends on the previous centerline
+// point only through the choice of a connected region, so the
+// candidates of a window of contours are cut concurrently and the
+// regions are selected afterwards. The candidates and cuts of a window
+// are kept until an observer has consumed them. A few contours per
+// thread keep the threads busy without holding the cuts of all
+// contours at once.
+class CrossSectionSweep
+{
+public:
+  typedef CrossSectionExtractor::ContourCrossSections ContourCrossSections;
+
+  // Description:
+  // Measures of the cross section selected for a contour. A contour
+  // without cross section has a zero area and perimeter and the
+  // center of mass and normal of the next contour.
+  struct Measures
+  {
+    double Area;
+    double Perimeter;
+    double CenterOfMass[3];
+    double AverageNormal[3];
+  };
+
+  // Description:
+  // Receives the cross sections of each window of contours once they
+  // are selected and triangulated.
+  class WindowObserver
+  {
+  public:
+    virtual ~WindowObserver() {}
+
+    // Description:
+    // Entry i of sections is for contour windowBegin + i, and measures
+    // holds the measures of all contours from windowBegin on. Returns
+    // false to stop the sweep.
+    virtual bool ProcessWindow(vtkIdType windowBegin,
+                               const std::vector<ContourCrossSections> & sections,
+                               const std::vector<Measures> & measures) = 0;
+  };
+
+  CrossSectionSweep();
+  ~CrossSectionSweep();
+
+  // Description:
+  // Group the cells of the contours by the "contour ID" cell array of
+  // the contourers, for numberOfValues contour values, in a single
+  // pass. Contours without cells are dropped: contourCells holds the
+  // cells of the remaining ones and valueIndices their index in the
+  // contour values.
+  static void BucketCellsByContour(vtkIdTypeArray* contourIDs, vtkIdType numberOfValues,
+                                   std::vector<vtkIdType> & valueIndices,
+                                   std::vector< std::vector<vtkIdType> > & contourCells);
+
+  // Description:
+  // Set the contours and their cells grouped by contour. The cells
+  // must outlive the sweep.
+  void SetContours(vtkPolyData* contours,
+                   const std::vector< std::vector<vtkIdType> > * contourCells);
+
+  // Description:
+  // Set the surface to cut and a locator built on it.
+  void SetSurface(vtkPolyData* surface, const vtkPlaneCutLocator* locator);
+
+  // Description:
+  // Set the number of threads. 0, the default, uses the ITK default
+  // number of threads.
+  void SetNumberOfThreads(int numberOfThreads);
+
+  // Description:
+  // Set the observer of the windows, if any.
+  void SetObserver(WindowObserver* observer);
+
+  // Description:
+  // Compute the cross sections of all contours and return their
+  // measures, one entry per contour. Returns false if the observer
+  // stopped the sweep.
+  bool Run(std::vector<Measures> & measures);
+
+  // Description:
+  // Number of cutting planes and of surface triangles they crossed
+  // in the last run.
+  vtkIdType GetNumberOfCuttingPlanes() const { return this->NumberOfCuttingPlanes; }
+  vtkIdType GetNumberOfCutTriangles() const { return this->NumberOfCutTriangles; }
+
+private:
+  CrossSectionSweep(const CrossSectionSweep&); // Not implemented
+  void operator=(const CrossSectionSweep&); // Not implemented
+
+  // Description:
+  // Select the cross section of each contour of a window, from the
+  // last to the first, and record its measures.
+  void SelectRegions(vtkIdType windowBegin, vtkIdType windowEnd,
+                     std::vector<ContourCrossSections> & sections,
+                     std::vector<Measures> & measures);
+
+  vtkPolyData*                                  Contours;
+  const std::vector< std::vector<vtkIdType> > * ContourCells;
+  vtkPolyData*                                  Surface;
+  const vtkPlaneCutLocator*                     SurfaceLocator;
+  int                                           NumberOfThreads;
+  WindowObserver*                               Observer;
+
+  double                                        CenterlinePoint[3];
+  vtkIdType                                     NumberOfCuttingPlanes;
+  vtkIdType                                     NumberOfCutTriangles;
+};
+
+#endif // CrossSectionSweep_h
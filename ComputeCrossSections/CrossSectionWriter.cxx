@@ -0,0 +1,391 @@
+#include "CrossSectionWriter.h"
+
+#include <vtkAbstractTransform.h>
+#include <vtkCellData.h>
+#include <vtkDoubleArray.h>
+#include <vtkFieldData.h>
+#include <vtkIdTypeArray.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+#include <vtkTransformFilter.h>
+#include <vtkXMLPolyDataWriter.h>
+
+#include <vtksys/SystemTools.hxx>
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+//----------------------------------------------------------------------------
+CrossSectionWriter::CrossSectionWriter()
+{
+  this->Streaming = false;
+
+  this->TransformFilter = vtkSmartPointer<vtkTransformFilter>::New();
+  this->Writer = vtkSmartPointer<vtkXMLPolyDataWriter>::New();
+
+  // Pieces of the combined files, with the data inline so each piece
+  // is self-contained
+  this->StringWriter = vtkSmartPointer<vtkXMLPolyDataWriter>::New();
+  this->StringWriter->SetDataModeToBinary();
+  this->StringWriter->WriteToOutputStringOn();
+}
+
+//----------------------------------------------------------------------------
+CrossSectionWriter::~CrossSectionWriter()
+{
+}
+
+//----------------------------------------------------------------------------
+void CrossSectionWriter::SetFileName(const std::string & fileName)
+{
+  this->FileName = fileName;
+  this->Streaming =
+    vtksys::SystemTools::GetFilenameLastExtension(fileName) == ".vtm";
+}
+
+//----------------------------------------------------------------------------
+void CrossSectionWriter::SetTransform(vtkAbstractTransform* transform)
+{
+  this->TransformFilter->SetTransform(transform);
+}
+
+//----------------------------------------------------------------------------
+bool CrossSectionWriter::Start()
+{
+  if (!this->Streaming)
+    {
+    return this->StartPieceFile(this->FileName, this->CrossSectionFile) &&
+           this->StartPieceFile(this->FileName + "-cuts.vtp", this->CutFile);
+    }
+
+  std::string path = vtksys::SystemTools::GetFilenamePath(this->FileName);
+  if (!path.empty())
+    {
+    path += "/";
+    }
+  std::string name = vtksys::SystemTools::GetFilenameWithoutLastExtension(this->FileName);
+
+  this->InitializePieceList(this->FileName, this->CrossSectionPieces);
+  this->InitializePieceList(path + name + "-cuts.vtm", this->CutPieces);
+
+  return vtksys::SystemTools::MakeDirectory(this->CrossSectionPieces.Directory.c_str()) &&
+         vtksys::SystemTools::MakeDirectory(this->CutPieces.Directory.c_str()) &&
+         this->WriteIndex(this->CrossSectionPieces) &&
+         this->WriteIndex(this->CutPieces);
+}
+
+//----------------------------------------------------------------------------
+bool CrossSectionWriter::AddCut(vtkIdType contourID, vtkPolyData* cut)
+{
+  vtkSmartPointer<vtkPolyData> piece = this->Transform(cut);
+  if (!this->Streaming)
+    {
+    return this->AppendPiece(this->CutFile, piece);
+    }
+
+  return this->WritePiece(this->CutPieces, contourID, piece);
+}
+
+//----------------------------------------------------------------------------
+bool CrossSectionWriter::AddCrossSection(vtkIdType contourID, double heat,
+                                         vtkPolyData* geometry,
+                                         const double centerOfMass[3],
+                                         const double normal[3],
+                                         double area, double perimeter)
+{
+  vtkSmartPointer<vtkPolyData> piece =
+    this->CreateCrossSectionPiece(contourID, heat, geometry);
+  if (!this->Streaming)
+    {
+    return this->AppendPiece(this->CrossSectionFile, piece);
+    }
+
+  // The row of the cross section in the combined field data
+  vtkSmartPointer<vtkIdTypeArray> contourIDInfo = vtkSmartPointer<vtkIdTypeArray>::New();
+  contourIDInfo->SetName("contour ID");
+  contourIDInfo->InsertNextTypedTuple(&contourID);
+
+  vtkSmartPointer<vtkDoubleArray> heatInfo = vtkSmartPointer<vtkDoubleArray>::New();
+  heatInfo->SetName("heat");
+  heatInfo->InsertNextTypedTuple(&heat);
+
+  vtkSmartPointer<vtkDoubleArray> centerOfMassInfo = vtkSmartPointer<vtkDoubleArray>::New();
+  centerOfMassInfo->SetName("center of mass");
+  centerOfMassInfo->SetNumberOfComponents(3);
+  centerOfMassInfo->InsertNextTypedTuple(centerOfMass);
+
+  vtkSmartPointer<vtkDoubleArray> averageNormalInfo = vtkSmartPointer<vtkDoubleArray>::New();
+  averageNormalInfo->SetName("normal");
+  averageNormalInfo->SetNumberOfComponents(3);
+  averageNormalInfo->InsertNextTypedTuple(normal);
+
+  vtkSmartPointer<vtkDoubleArray> areaInfo = vtkSmartPointer<vtkDoubleArray>::New();
+  areaInfo->SetName("area");
+  areaInfo->InsertNextTypedTuple(&area);
+
+  vtkSmartPointer<vtkDoubleArray> perimeterInfo = vtkSmartPointer<vtkDoubleArray>::New();
+  perimeterInfo->SetName("perimeter");
+  perimeterInfo->InsertNextTypedTuple(&perimeter);
+
+  vtkFieldData* fieldData = piece->GetFieldData();
+  fieldData->AddArray(contourIDInfo);
+  fieldData->AddArray(heatInfo);
+  fieldData->AddArray(centerOfMassInfo);
+  fieldData->AddArray(averageNormalInfo);
+  fieldData->AddArray(areaInfo);
+  fieldData->AddArray(perimeterInfo);
+
+  return this->WritePiece(this->CrossSectionPieces, contourID, piece);
+}
+
+//----------------------------------------------------------------------------
+bool CrossSectionWriter::Finish(vtkFieldData* fieldData)
+{
+  if (this->Streaming)
+    {
+    // The pieces and indices are complete already
+    return true;
+    }
+
+  if (!this->FinishPieceFile(this->CrossSectionFile, fieldData))
+    {
+    return false;
+    }
+
+  return this->FinishPieceFile(this->CutFile, NULL);
+}
+
+//----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData>
+CrossSectionWriter::CreateCrossSectionPiece(vtkIdType contourID, double heat,
+                                            vtkPolyData* geometry)
+{
+  vtkSmartPointer<vtkPolyData> piece = this->Transform(geometry);
+
+  vtkSmartPointer<vtkDoubleArray> heatValues = vtkSmartPointer<vtkDoubleArray>::New();
+  heatValues->SetName("heat");
+  heatValues->SetNumberOfComponents(1);
+  heatValues->SetNumberOfTuples(piece->GetNumberOfPoints());
+  heatValues->FillComponent(0, heat);
+  piece->GetPointData()->SetScalars(heatValues);
+
+  vtkSmartPointer<vtkIdTypeArray> contourIDs = vtkSmartPointer<vtkIdTypeArray>::New();
+  contourIDs->SetName("contour ID");
+  contourIDs->SetNumberOfComponents(1);
+  contourIDs->SetNumberOfTuples(piece->GetNumberOfCells());
+  for (vtkIdType cellId = 0; cellId < piece->GetNumberOfCells(); ++cellId)
+    {
+    contourIDs->SetValue(cellId, contourID);
+    }
+  piece->GetCellData()->SetScalars(contourIDs);
+
+  return piece;
+}
+
+//----------------------------------------------------------------------------
+void CrossSectionWriter::InitializePieceList(const std::string & indexFileName,
+                                             PieceList & pieces)
+{
+  std::string path = vtksys::SystemTools::GetFilenamePath(indexFileName);
+  if (!path.empty())
+    {
+    path += "/";
+    }
+
+  pieces.IndexFileName = indexFileName;
+  pieces.Directory = path +
+    vtksys::SystemTools::GetFilenameWithoutLastExtension(indexFileName);
+  pieces.Names.clear();
+  pieces.Files.clear();
+}
+
+//----------------------------------------------------------------------------
+bool CrossSectionWriter::WritePiece(PieceList & pieces, vtkIdType contourID,
+                                    vtkPolyData* pd)
+{
+  std::string name = vtksys::SystemTools::GetFilenameName(pieces.Directory);
+
+  std::ostringstream file;
+  file << name << "/" << name << "_" << std::setw(4) << std::setfill('0')
+       << contourID << ".vtp";
+
+  std::string path = vtksys::SystemTools::GetFilenamePath(pieces.IndexFileName);
+  if (!path.empty())
+    {
+    path += "/";
+    }
+
+  if (!this->WritePolyData(pd, path + file.str()))
+    {
+    return false;
+    }
+
+  std::ostringstream blockName;
+  blockName << "contour " << contourID;
+  pieces.Names.push_back(blockName.str());
+  pieces.Files.push_back(file.str());
+
+  return this->WriteIndex(pieces);
+}
+
+//----------------------------------------------------------------------------
+bool CrossSectionWriter::WriteIndex(const PieceList & pieces)
+{
+  // Write the index next to the old one and move it into place, so a
+  // reader never sees an index that is partly written
+  std::string temporaryFileName = pieces.IndexFileName + ".tmp";
+  std::ofstream index(temporaryFileName.c_str());
+  if (!index)
+    {
+    return false;
+    }
+
+  index << "<?xml version=\"1.0\"?>\n"
+        << "<VTKFile type=\"vtkMultiBlockDataSet\" version=\"1.0\">\n"
+        << "  <vtkMultiBlockDataSet>\n";
+  for (size_t i = 0; i < pieces.Files.size(); ++i)
+    {
+    index << "    <DataSet index=\"" << i << "\" name=\"" << pieces.Names[i]
+          << "\" file=\"" << pieces.Files[i] << "\"/>\n";
+    }
+  index << "  </vtkMultiBlockDataSet>\n"
+        << "</VTKFile>\n";
+  index.close();
+  if (!index)
+    {
+    return false;
+    }
+
+#ifdef _WIN32
+  // rename() does not replace existing files on Windows
+  vtksys::SystemTools::RemoveFile(pieces.IndexFileName.c_str());
+#endif
+  return std::rename(temporaryFileName.c_str(), pieces.IndexFileName.c_str()) == 0;
+}
+
+//----------------------------------------------------------------------------
+bool CrossSectionWriter::StartPieceFile(const std::string & fileName, PieceFile & file)
+{
+  file.FileName = fileName;
+  file.TemporaryFileName = fileName + ".tmp";
+  file.Trailer.clear();
+  file.Stream.open(file.TemporaryFileName.c_str());
+
+  return file.Stream.is_open();
+}
+
+//----------------------------------------------------------------------------
+bool CrossSectionWriter::AppendPiece(PieceFile & file, vtkPolyData* pd)
+{
+  std::string xml = this->WritePolyDataToString(pd);
+
+  // The whole lines from <Piece> to </Piece>
+  std::string::size_type begin = xml.find("<Piece");
+  std::string::size_type end = xml.rfind("</Piece>");
+  if (begin == std::string::npos || end == std::string::npos)
+    {
+    return false;
+    }
+  begin = xml.rfind('\n', begin) + 1;
+  end = xml.find('\n', end);
+  if (end == std::string::npos)
+    {
+    return false;
+    }
+  ++end;
+
+  if (file.Trailer.empty())
+    {
+    // Everything up to the first piece opens the file, everything
+    // after it closes the file in FinishPieceFile
+    file.Stream << xml.substr(0, begin);
+    file.Trailer = xml.substr(end);
+    }
+  file.Stream << xml.substr(begin, end - begin);
+
+  return !file.Stream.fail();
+}
+
+//----------------------------------------------------------------------------
+bool CrossSectionWriter::FinishPieceFile(PieceFile & file, vtkFieldData* fieldData)
+{
+  // A file without pieces gets an empty one, which also gives the
+  // header and trailer
+  if (file.Trailer.empty() &&
+      !this->AppendPiece(file, vtkSmartPointer<vtkPolyData>::New()))
+    {
+    return false;
+    }
+
+  // The reader finds the field data after the pieces as well
+  if (fieldData && fieldData->GetNumberOfArrays() > 0)
+    {
+    vtkSmartPointer<vtkPolyData> pd = vtkSmartPointer<vtkPolyData>::New();
+    pd->SetFieldData(fieldData);
+    std::string xml = this->WritePolyDataToString(pd);
+
+    std::string::size_type begin = xml.find("<FieldData");
+    std::string::size_type end = xml.find("</FieldData>");
+    if (begin == std::string::npos || end == std::string::npos)
+      {
+      return false;
+      }
+    begin = xml.rfind('\n', begin) + 1;
+    end = xml.find('\n', end);
+    if (end == std::string::npos)
+      {
+      return false;
+      }
+    file.Stream << xml.substr(begin, end + 1 - begin);
+    }
+
+  file.Stream << file.Trailer;
+  file.Stream.close();
+  if (file.Stream.fail())
+    {
+    return false;
+    }
+
+#ifdef _WIN32
+  // rename() does not replace existing files on Windows
+  vtksys::SystemTools::RemoveFile(file.FileName.c_str());
+#endif
+  return std::rename(file.TemporaryFileName.c_str(), file.FileName.c_str()) == 0;
+}
+
+//----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> CrossSectionWriter::Transform(vtkPolyData* pd)
+{
+  this->TransformFilter->SetInputData(pd);
+  this->TransformFilter->Update();
+
+  vtkSmartPointer<vtkPolyData> output = vtkSmartPointer<vtkPolyData>::New();
+  output->ShallowCopy(this->TransformFilter->GetOutput());
+
+  this->TransformFilter->SetInputData(NULL);
+
+  return output;
+}
+
+//----------------------------------------------------------------------------
+bool CrossSectionWriter::WritePolyData(vtkPolyData* pd, const std::string & fileName)
+{
+  this->Writer->SetFileName(fileName.c_str());
+  this->Writer->SetInputData(pd);
+  int success = this->Writer->Write();
+  this->Writer->SetInputData(NULL);
+
+  return success != 0;
+}
+
+//----------------------------------------------------------------------------
+std::string CrossSectionWriter::WritePolyDataToString(vtkPolyData* pd)
+{
+  this->StringWriter->SetInputData(pd);
+  int success = this->StringWriter->Write();
+  this->StringWriter->SetInputData(NULL);
+
+  return success ? this->StringWriter->GetOutputStdString() : std::string();
+}
@@ -0,0 +1,137 @@
+#ifndef CrossSectionWriter_h
+#define CrossSectionWriter_h
+
+#include <vtkSmartPointer.h>
+#include <vtkType.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+class vtkAbstractTransform;
+class vtkFieldData;
+class vtkPolyData;
+class vtkTransformFilter;
+class vtkXMLPolyDataWriter;
+
+// Description:
+// Writes the cross sections and the cuts they come from.
+//
+// If the file name ends in .vtm, the output is streamed. Each cross
+// section is written to its own .vtp piece as soon as it is added,
+// together with its row of measures as field data. The multiblock
+// index is rewritten after each piece, so the finished cross sections
+// of an interrupted run can still be read. The pieces go into a
+// directory named after the file without the extension. The cuts go
+// into a second multiblock data set with "-cuts" appended to that name.
+//
+// Otherwise all cross sections go into one poly data file with the
+// measures of all of them as field data, and the cuts into the file
+// name followed by "-cuts.vtp". Each cross section and cut is still
+// appended to its file as soon as it is added, as one piece of the
+// file, so neither is kept in memory. The files are written next to
+// their final names and moved into place by Finish.
+class CrossSectionWriter
+{
+public:
+  CrossSectionWriter();
+  ~CrossSectionWriter();
+
+  // Description:
+  // Set the name of the cross-section file.
+  void SetFileName(const std::string & fileName);
+
+  // Description:
+  // Set the transform applied to all geometry before it is written.
+  void SetTransform(vtkAbstractTransform* transform);
+
+  // Description:
+  // Return whether each cross section is written as soon as it is
+  // added.
+  bool GetStreaming() const { return this->Streaming; }
+
+  // Description:
+  // Prepare the output. Returns false if the directories for the
+  // pieces or the files cannot be created.
+  bool Start();
+
+  // Description:
+  // Add the cut of a contour.
+  bool AddCut(vtkIdType contourID, vtkPolyData* cut);
+
+  // Description:
+  // Add the cross section of a contour with its heat value and
+  // measures.
+  bool AddCrossSection(vtkIdType contourID, double heat, vtkPolyData* geometry,
+                       const double centerOfMass[3], const double normal[3],
+                       double area, double perimeter);
+
+  // Description:
+  // Write what has not been written yet. fieldData holds the measures
+  // of all cross sections for the combined cross-section file.
+  bool Finish(vtkFieldData* fieldData);
+
+private:
+  CrossSectionWriter(const CrossSectionWriter&); // Not implemented
+  void operator=(const CrossSectionWriter&); // Not implemented
+
+  // Description:
+  // Pieces of a multiblock data set and its index file.
+  struct PieceList
+  {
+    std::string              IndexFileName;
+    std::string              Directory;
+    std::vector<std::string> Names;
+    std::vector<std::string> Files;
+  };
+
+  void InitializePieceList(const std::string & indexFileName, PieceList & pieces);
+  bool WritePiece(PieceList & pieces, vtkIdType contourID, vtkPolyData* pd);
+  bool WriteIndex(const PieceList & pieces);
+
+  // Description:
+  // A poly data file written one piece at a time. The XML of each
+  // piece comes from the writer and is appended to the temporary file,
+  // framed by the header and trailer the writer gave the first piece.
+  struct PieceFile
+  {
+    std::string   FileName;
+    std::string   TemporaryFileName;
+    std::ofstream Stream;
+    std::string   Trailer;
+  };
+
+  bool StartPieceFile(const std::string & fileName, PieceFile & file);
+  bool AppendPiece(PieceFile & file, vtkPolyData* pd);
+  bool FinishPieceFile(PieceFile & file, vtkFieldData* fieldData);
+
+  // Description:
+  // Return the piece with the heat values as point scalars and the
+  // contour ID as cell scalars.
+  vtkSmartPointer<vtkPolyData> CreateCrossSectionPiece(vtkIdType contourID, double heat,
+                                                       vtkPolyData* geometry);
+
+  // Description:
+  // Return a transformed copy of pd.
+  vtkSmartPointer<vtkPolyData> Transform(vtkPolyData* pd);
+
+  bool WritePolyData(vtkPolyData* pd, const std::string & fileName);
+  std::string WritePolyDataToString(vtkPolyData* pd);
+
+  std::string                           FileName;
+  bool                                  Streaming;
+
+  vtkSmartPointer<vtkTransformFilter>   TransformFilter;
+  vtkSmartPointer<vtkXMLPolyDataWriter> Writer;
+  vtkSmartPointer<vtkXMLPolyDataWriter> StringWriter;
+
+  // Streamed output
+  PieceList                             CrossSectionPieces;
+  PieceList                             CutPieces;
+
+  // Combined output
+  PieceFile                             CrossSectionFile;
+  PieceFile                             CutFile;
+};
+
+#endif // CrossSectionWriter_h
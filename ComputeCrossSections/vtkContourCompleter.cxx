@@ -1,16 +1,27 @@
 #include "vtkContourCompleter.h"
 
-#include <vtkAppendPolyData.h>
 #include <vtkCellArray.h>
-#include <vtkDataSetSurfaceFilter.h>
-#include <vtkIdList.h>
 #include <vtkInformation.h>
 #include <vtkInformationVector.h>
 #include <vtkObjectFactory.h>
-#include <vtkPolyDataConnectivityFilter.h>
+#include <vtkPoints.h>
 #include <vtkSmartPointer.h>
-#include <vtkStripper.h>
-#include <vtkThreshold.h>
+
+#include <vector>
+
+namespace
+{
+  // Root of a point in the union-find forest of the connected regions
+  vtkIdType FindRegionRoot(std::vector<vtkIdType> & parent, vtkIdType ptId)
+  {
+    while ( parent[ptId] != ptId )
+      {
+      parent[ptId] = parent[parent[ptId]];
+      ptId = parent[ptId];
+      }
+    return ptId;
+  }
+}
 
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkContourCompleter);
@@ -19,7 +30,6 @@ vtkStandardNewMacro(vtkContourCompleter);
 vtkContourCompleter::vtkContourCompleter()
 {
   this->SetNumberOfInputPorts(1);
-  this->SetNumberOfInputPorts(1);
 }
 
 //----------------------------------------------------------------------------
@@ -41,65 +51,147 @@ int vtkContourCompleter::RequestData(vtkInformation*        vtkNotUsed(request),
   vtkPolyData* outputPD = vtkPolyData::SafeDownCast(
     outInfo->Get(vtkDataObject::DATA_OBJECT()));
 
-  // Find the connected components
-  vtkSmartPointer<vtkPolyDataConnectivityFilter> connectivity =
-    vtkSmartPointer<vtkPolyDataConnectivityFilter>::New();
-  connectivity->SetExtractionModeToAllRegions();
-  connectivity->ColorRegionsOn();
-  connectivity->SetInputData( inputPD );
-  connectivity->Update();
+  outputPD->Initialize();
 
-  int numberOfRegions = connectivity->GetNumberOfExtractedRegions();
+  vtkPoints* inputPoints = inputPD->GetPoints();
+  vtkIdType numberOfPoints = inputPD->GetNumberOfPoints();
+  if (!inputPoints || numberOfPoints == 0)
+    {
+    return 1;
+    }
 
-  vtkSmartPointer<vtkAppendPolyData> appender = vtkSmartPointer<vtkAppendPolyData>::New();
+  // Break the lines into segments and join the regions they connect
+  std::vector<vtkIdType> segments;
+  std::vector<vtkIdType> regionParent(numberOfPoints);
+  for (vtkIdType ptId = 0; ptId < numberOfPoints; ++ptId)
+    {
+    regionParent[ptId] = ptId;
+    }
 
-  // Iterate over the connected components, complete the contours if needed,
-  // then append it all back together
-  for (vtkIdType regionId = 0; regionId < numberOfRegions; ++regionId)
+  vtkCellArray* lines = inputPD->GetLines();
+  vtkIdType numberOfIds;
+  vtkIdType* ids;
+  for (lines->InitTraversal(); lines->GetNextCell(numberOfIds, ids); )
     {
-    vtkSmartPointer<vtkThreshold> scalarThreshold = vtkSmartPointer<vtkThreshold>::New();
-    scalarThreshold->ThresholdBetween( regionId, regionId );
-    scalarThreshold->SetInputArrayToProcess(0, 0, 0,
-                                            vtkDataObject::FIELD_ASSOCIATION_POINTS,
-                                            "RegionId");
-    scalarThreshold->SetInputConnection( connectivity->GetOutputPort() );
-
-    vtkSmartPointer<vtkDataSetSurfaceFilter> surfaceFilter =
-      vtkSmartPointer<vtkDataSetSurfaceFilter>::New();
-    surfaceFilter->SetInputConnection( scalarThreshold->GetOutputPort() );
-
-    vtkSmartPointer<vtkStripper> stripper = vtkSmartPointer<vtkStripper>::New();
-    stripper->JoinContiguousSegmentsOn();
-    stripper->SetInputConnection( surfaceFilter->GetOutputPort() );
-    stripper->Update();
-
-    vtkSmartPointer<vtkPoints> newPoints = vtkSmartPointer<vtkPoints>::New();
-    newPoints->DeepCopy( stripper->GetOutput()->GetPoints() );
-
-    vtkSmartPointer<vtkPolyData> completedPD = vtkSmartPointer<vtkPolyData>::New();
-    completedPD->SetPoints( newPoints );
-    vtkSmartPointer<vtkCellArray> cellArray = vtkSmartPointer<vtkCellArray>::New();
-    completedPD->SetLines( cellArray );
-
-    vtkSmartPointer<vtkIdList> pts = vtkSmartPointer<vtkIdList>::New();
-    stripper->GetOutput()->GetCellPoints(0, pts);
-
-    vtkIdType firstPt = pts->GetId(0);
-    vtkIdType lastPt = pts->GetId( pts->GetNumberOfIds()-1 );
-    if (firstPt != lastPt)
+    for (vtkIdType i = 0; i + 1 < numberOfIds; ++i)
       {
-      // Insert the first point as the last to complete the contour
-      pts->InsertNextId(firstPt);
+      if (ids[i] == ids[i + 1])
+        {
+        continue;
+        }
+      segments.push_back(ids[i]);
+      segments.push_back(ids[i + 1]);
+
+      vtkIdType root0 = FindRegionRoot(regionParent, ids[i]);
+      vtkIdType root1 = FindRegionRoot(regionParent, ids[i + 1]);
+      if (root0 != root1)
+        {
+        regionParent[root1] = root0;
+        }
+      }
+    }
+  vtkIdType numberOfSegments = static_cast<vtkIdType>(segments.size() / 2);
+
+  // Segments around each point
+  std::vector<vtkIdType> pointOffsets(numberOfPoints + 1, 0);
+  for (size_t i = 0; i < segments.size(); ++i)
+    {
+    ++pointOffsets[segments[i] + 1];
+    }
+  for (vtkIdType ptId = 0; ptId < numberOfPoints; ++ptId)
+    {
+    pointOffsets[ptId + 1] += pointOffsets[ptId];
+    }
+  std::vector<vtkIdType> pointSegments(segments.size());
+  std::vector<vtkIdType> fill(pointOffsets.begin(), pointOffsets.end() - 1);
+  for (vtkIdType segmentId = 0; segmentId < numberOfSegments; ++segmentId)
+    {
+    pointSegments[fill[segments[2*segmentId]]++] = segmentId;
+    pointSegments[fill[segments[2*segmentId + 1]]++] = segmentId;
+    }
+
+  // Number the regions by their first segment. Each region is walked
+  // from a dangling end if it has one, so an open contour comes out
+  // whole, and from the start of its first segment otherwise.
+  std::vector<vtkIdType> regionOfRoot(numberOfPoints, -1);
+  std::vector<vtkIdType> regionStart;
+  std::vector<bool> regionHasEnd;
+  for (size_t i = 0; i < segments.size(); ++i)
+    {
+    vtkIdType ptId = segments[i];
+    vtkIdType root = FindRegionRoot(regionParent, ptId);
+    if (regionOfRoot[root] < 0)
+      {
+      regionOfRoot[root] = static_cast<vtkIdType>(regionStart.size());
+      regionStart.push_back(ptId);
+      regionHasEnd.push_back(false);
       }
 
-    completedPD->InsertNextCell( VTK_POLY_LINE, pts->GetNumberOfIds(), pts->GetPointer(0) );
-    
-    appender->AddInputData( completedPD );
+    vtkIdType region = regionOfRoot[root];
+    if (!regionHasEnd[region] && pointOffsets[ptId + 1] - pointOffsets[ptId] == 1)
+      {
+      regionStart[region] = ptId;
+      regionHasEnd[region] = true;
+      }
     }
 
-  appender->Update();
+  // Walk one loop through each region, then close it if needed
+  vtkSmartPointer<vtkPoints> newPoints = vtkSmartPointer<vtkPoints>::New();
+  newPoints->SetDataType(inputPoints->GetDataType());
+  vtkSmartPointer<vtkCellArray> newLines = vtkSmartPointer<vtkCellArray>::New();
+
+  std::vector<vtkIdType> pointMap(numberOfPoints, -1);
+  std::vector<bool> segmentUsed(numberOfSegments, false);
+  std::vector<vtkIdType> loop;
+  double x[3];
+  for (size_t region = 0; region < regionStart.size(); ++region)
+    {
+    loop.clear();
+    vtkIdType ptId = regionStart[region];
+    loop.push_back(ptId);
+    for (;;)
+      {
+      vtkIdType next = -1;
+      for (vtkIdType i = pointOffsets[ptId]; i < pointOffsets[ptId + 1]; ++i)
+        {
+        vtkIdType segmentId = pointSegments[i];
+        if (!segmentUsed[segmentId])
+          {
+          segmentUsed[segmentId] = true;
+          next = segments[2*segmentId] == ptId ?
+            segments[2*segmentId + 1] : segments[2*segmentId];
+          break;
+          }
+        }
+      if (next < 0)
+        {
+        break;
+        }
+      loop.push_back(next);
+      ptId = next;
+      }
+
+    if (loop.front() != loop.back())
+      {
+      // Insert the first point as the last to complete the contour
+      loop.push_back(loop.front());
+      }
+
+    newLines->InsertNextCell(static_cast<vtkIdType>(loop.size()));
+    for (size_t i = 0; i < loop.size(); ++i)
+      {
+      vtkIdType & newId = pointMap[loop[i]];
+      if (newId < 0)
+        {
+        inputPoints->GetPoint(loop[i], x);
+        newId = newPoints->InsertNextPoint(x);
+        }
+      newLines->InsertCellPoint(newId);
+      }
+    }
 
-  outputPD->DeepCopy(appender->GetOutput());
+  outputPD->SetPoints(newPoints);
+  outputPD->SetLines(newLines);
 
   return 1;
 }
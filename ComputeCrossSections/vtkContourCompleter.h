@@ -8,6 +8,10 @@
 // the contour is connected, nothing happens. Only a single line
 // segment will be added, so contours with more than one missing line
 // segment will continue to be incomplete.
+//
+// The line segments are walked once: each connected region becomes
+// one poly line, closed by repeating its first point, through the
+// points of the region only. Point and cell data are not passed.
 class vtkContourCompleter : public vtkPolyDataAlgorithm
 {
 public:
@@ -0,0 +1,153 @@
+// Tests of vtkContourCompleter on unit squares given as line segments
+// in scrambled order: an open polyline must be closed, and a cut with
+// two regions, one open and one closed, must give one closed poly line
+// per region through the points of that region only.
+
+#include "vtkContourCompleter.h"
+
+#include <vtkCellArray.h>
+#include <vtkMath.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+  /*******************************************************************/
+  /** Add the corners of the unit square with lower corner (x, 0, 0)
+   *  to points, counterclockwise. */
+  /*******************************************************************/
+  void AddSquare(vtkPoints* points, double x)
+  {
+    points->InsertNextPoint(x,       0.0, 0.0);
+    points->InsertNextPoint(x + 1.0, 0.0, 0.0);
+    points->InsertNextPoint(x + 1.0, 1.0, 0.0);
+    points->InsertNextPoint(x,       1.0, 0.0);
+  }
+
+  /*******************************************************************/
+  /** Add the segment from point a to point b. */
+  /*******************************************************************/
+  void AddSegment(vtkCellArray* lines, vtkIdType a, vtkIdType b)
+  {
+    vtkIdType ids[2] = { a, b };
+    lines->InsertNextCell(2, ids);
+  }
+
+  /*******************************************************************/
+  /** Complete the segments and check that the output has one closed
+   *  poly line per square: five ids from one square, each a unit
+   *  step from the previous one. */
+  /*******************************************************************/
+  bool CheckCompletedSquares(vtkPoints* points, vtkCellArray* lines,
+                             vtkIdType numberOfSquares)
+  {
+    vtkSmartPointer<vtkPolyData> input = vtkSmartPointer<vtkPolyData>::New();
+    input->SetPoints(points);
+    input->SetLines(lines);
+
+    vtkSmartPointer<vtkContourCompleter> completer =
+      vtkSmartPointer<vtkContourCompleter>::New();
+    completer->SetInputData(input);
+    completer->Update();
+    vtkPolyData* output = completer->GetOutput();
+
+    if (output->GetNumberOfLines() != numberOfSquares ||
+        output->GetNumberOfPoints() != 4 * numberOfSquares)
+      {
+      std::cerr << "Expected " << numberOfSquares << " lines through "
+                << 4 * numberOfSquares << " points, got "
+                << output->GetNumberOfLines() << " lines through "
+                << output->GetNumberOfPoints() << " points" << std::endl;
+      return false;
+      }
+
+    vtkCellArray* outputLines = output->GetLines();
+    vtkIdType npts;
+    vtkIdType* pts;
+    for (outputLines->InitTraversal(); outputLines->GetNextCell(npts, pts); )
+      {
+      if (npts != 5 || pts[0] != pts[4])
+        {
+        std::cerr << "A line is not a closed loop of four points" << std::endl;
+        return false;
+        }
+
+      double first[3];
+      output->GetPoint(pts[0], first);
+      double square = std::floor(first[0] / 2.0);
+      for (vtkIdType i = 1; i < npts; ++i)
+        {
+        double previous[3], current[3];
+        output->GetPoint(pts[i - 1], previous);
+        output->GetPoint(pts[i], current);
+        if (std::floor(current[0] / 2.0) != square ||
+            vtkMath::Distance2BetweenPoints(previous, current) != 1.0)
+          {
+          std::cerr << "A line does not follow the sides of one square" << std::endl;
+          return false;
+          }
+        }
+      }
+
+    return true;
+  }
+
+  /*******************************************************************/
+  /** A square missing one side, as three segments out of order. */
+  /*******************************************************************/
+  bool TestOpenPolyLine()
+  {
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    AddSquare(points, 0.0);
+
+    vtkSmartPointer<vtkCellArray> lines = vtkSmartPointer<vtkCellArray>::New();
+    AddSegment(lines, 2, 3);
+    AddSegment(lines, 0, 1);
+    AddSegment(lines, 1, 2);
+
+    return CheckCompletedSquares(points, lines, 1);
+  }
+
+  /*******************************************************************/
+  /** Two squares two units apart, with their segments interleaved:
+   *  the first misses a side, the second is closed. */
+  /*******************************************************************/
+  bool TestTwoRegions()
+  {
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    AddSquare(points, 0.0);
+    AddSquare(points, 2.0);
+
+    vtkSmartPointer<vtkCellArray> lines = vtkSmartPointer<vtkCellArray>::New();
+    AddSegment(lines, 6, 7);
+    AddSegment(lines, 1, 2);
+    AddSegment(lines, 4, 5);
+    AddSegment(lines, 3, 0);
+    AddSegment(lines, 7, 4);
+    AddSegment(lines, 0, 1);
+    AddSegment(lines, 5, 6);
+
+    return CheckCompletedSquares(points, lines, 2);
+  }
+}
+
+int main(int, char*[])
+{
+  int status = EXIT_SUCCESS;
+  if (!TestOpenPolyLine())
+    {
+    std::cerr << "Open poly line test failed" << std::endl;
+    status = EXIT_FAILURE;
+    }
+  if (!TestTwoRegions())
+    {
+    std::cerr << "Two region test failed" << std::endl;
+    status = EXIT_FAILURE;
+    }
+  return status;
+}
@@ -0,0 +1,260 @@
+#include "vtkPlaneCutLocator.h"
+
+#include <vtkObjectFactory.h>
+#include <vtkPolyData.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  // Orders cells by the center of their bounds along one axis.
+  class CellCenterLess
+  {
+  public:
+    CellCenterLess(const std::vector<double> & bounds, int axis)
+      : Bounds(bounds), Axis(axis) {}
+
+    bool operator()(vtkIdType a, vtkIdType b) const
+    {
+      return ( this->Bounds[6*a + 2*this->Axis] + this->Bounds[6*a + 2*this->Axis + 1] ) <
+             ( this->Bounds[6*b + 2*this->Axis] + this->Bounds[6*b + 2*this->Axis + 1] );
+    }
+
+  private:
+    const std::vector<double> & Bounds;
+    int                         Axis;
+  };
+
+  // A node to visit and the range of the planes touching its parent
+  struct PlanesStackEntry
+  {
+    vtkIdType Node;
+    size_t    Begin;
+    size_t    End;
+  };
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkPlaneCutLocator);
+
+//----------------------------------------------------------------------------
+vtkPlaneCutLocator::vtkPlaneCutLocator()
+{
+  this->DataSet = NULL;
+  this->NumberOfCellsPerLeaf = 8;
+  this->Tolerance = 0.0;
+}
+
+//----------------------------------------------------------------------------
+vtkPlaneCutLocator::~vtkPlaneCutLocator()
+{
+  this->SetDataSet(NULL);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlaneCutLocator::SetDataSet(vtkPolyData* dataSet)
+{
+  if (this->DataSet == dataSet)
+    {
+    return;
+    }
+  if (this->DataSet)
+    {
+    this->DataSet->UnRegister(this);
+    }
+  this->DataSet = dataSet;
+  if (this->DataSet)
+    {
+    this->DataSet->Register(this);
+    }
+  this->Nodes.clear();
+  this->CellIds.clear();
+  this->CellBounds.clear();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlaneCutLocator::BuildLocator()
+{
+  this->Nodes.clear();
+  this->CellIds.clear();
+  this->CellBounds.clear();
+
+  if (!this->DataSet || this->DataSet->GetNumberOfCells() == 0)
+    {
+    return;
+    }
+
+  vtkIdType numberOfCells = this->DataSet->GetNumberOfCells();
+  this->CellBounds.resize(6*numberOfCells);
+  this->CellIds.resize(numberOfCells);
+  for (vtkIdType cellId = 0; cellId < numberOfCells; ++cellId)
+    {
+    this->DataSet->GetCellBounds(cellId, &this->CellBounds[6*cellId]);
+    this->CellIds[cellId] = cellId;
+    }
+
+  // Boxes that merely touch the plane are reported, up to a tolerance
+  // relative to the size of the data set.
+  double bounds[6];
+  this->DataSet->GetBounds(bounds);
+  double diagonal = sqrt( (bounds[1] - bounds[0])*(bounds[1] - bounds[0]) +
+                          (bounds[3] - bounds[2])*(bounds[3] - bounds[2]) +
+                          (bounds[5] - bounds[4])*(bounds[5] - bounds[4]) );
+  this->Tolerance = 1e-6 * diagonal;
+
+  this->Nodes.reserve(4 * (numberOfCells / this->NumberOfCellsPerLeaf + 1));
+  this->BuildNode(0, numberOfCells);
+
+  // Cell bounds are only needed during the build
+  std::vector<double>().swap(this->CellBounds);
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkPlaneCutLocator::BuildNode(vtkIdType begin, vtkIdType end)
+{
+  vtkIdType nodeId = static_cast<vtkIdType>(this->Nodes.size());
+  this->Nodes.push_back(Node());
+
+  double bounds[6] = { VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX,
+                       VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX,
+                       VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX };
+  for (vtkIdType i = begin; i < end; ++i)
+    {
+    const double* cellBounds = &this->CellBounds[6*this->CellIds[i]];
+    for (int j = 0; j < 3; ++j)
+      {
+      bounds[2*j]   = std::min(bounds[2*j],   cellBounds[2*j]);
+      bounds[2*j+1] = std::max(bounds[2*j+1], cellBounds[2*j+1]);
+      }
+    }
+
+  Node & node = this->Nodes[nodeId];
+  for (int j = 0; j < 3; ++j)
+    {
+    node.Center[j]   = 0.5 * (bounds[2*j] + bounds[2*j+1]);
+    node.HalfSize[j] = 0.5 * (bounds[2*j+1] - bounds[2*j]);
+    }
+  node.Begin = begin;
+  node.End = end;
+  node.Left = -1;
+  node.Right = -1;
+
+  if (end - begin <= this->NumberOfCellsPerLeaf)
+    {
+    return nodeId;
+    }
+
+  // Split at the median cell along the longest axis
+  int axis = 0;
+  for (int j = 1; j < 3; ++j)
+    {
+    if (node.HalfSize[j] > node.HalfSize[axis])
+      {
+      axis = j;
+      }
+    }
+
+  vtkIdType middle = begin + (end - begin) / 2;
+  std::nth_element(this->CellIds.begin() + begin,
+                   this->CellIds.begin() + middle,
+                   this->CellIds.begin() + end,
+                   CellCenterLess(this->CellBounds, axis));
+
+  // The recursion may reallocate the nodes, so node is not used below
+  vtkIdType left = this->BuildNode(begin, middle);
+  vtkIdType right = this->BuildNode(middle, end);
+  this->Nodes[nodeId].Left = left;
+  this->Nodes[nodeId].Right = right;
+
+  return nodeId;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlaneCutLocator::FindCellsAlongPlanes(size_t numberOfPlanes,
+                                              const double* origins,
+                                              const double* normals,
+                                              std::vector<CellPlane> & cellPlanes) const
+{
+  cellPlanes.clear();
+  if (this->Nodes.empty() || numberOfPlanes == 0)
+    {
+    return;
+    }
+
+  // The planes touching each node on the stack are the entries
+  // [Begin, End) of planeIds. Both children share the range of their
+  // parent, and everything past the range of a node belongs to
+  // subtrees already visited when it is popped.
+  std::vector<vtkIdType> planeIds(numberOfPlanes);
+  for (size_t i = 0; i < numberOfPlanes; ++i)
+    {
+    planeIds[i] = static_cast<vtkIdType>(i);
+    }
+
+  std::vector<PlanesStackEntry> stack;
+  PlanesStackEntry root = { 0, 0, numberOfPlanes };
+  stack.push_back(root);
+  while (!stack.empty())
+    {
+    PlanesStackEntry entry = stack.back();
+    stack.pop_back();
+    planeIds.resize(entry.End);
+
+    const Node & node = this->Nodes[entry.Node];
+    size_t begin = planeIds.size();
+    for (size_t i = entry.Begin; i < entry.End; ++i)
+      {
+      vtkIdType planeId = planeIds[i];
+      const double* origin = origins + 3*planeId;
+      const double* normal = normals + 3*planeId;
+      double distance = 0.0;
+      double radius = 0.0;
+      for (int j = 0; j < 3; ++j)
+        {
+        distance += normal[j] * (node.Center[j] - origin[j]);
+        radius   += fabs(normal[j]) * node.HalfSize[j];
+        }
+      if (fabs(distance) <= radius + this->Tolerance)
+        {
+        planeIds.push_back(planeId);
+        }
+      }
+    size_t end = planeIds.size();
+    if (begin == end)
+      {
+      continue;
+      }
+
+    if (node.Left < 0)
+      {
+      for (vtkIdType i = node.Begin; i < node.End; ++i)
+        {
+        for (size_t j = begin; j < end; ++j)
+          {
+          cellPlanes.push_back(CellPlane(this->CellIds[i], planeIds[j]));
+          }
+        }
+      }
+    else
+      {
+      PlanesStackEntry right = { node.Right, begin, end };
+      PlanesStackEntry left = { node.Left, begin, end };
+      stack.push_back(right);
+      stack.push_back(left);
+      }
+    }
+
+  std::sort(cellPlanes.begin(), cellPlanes.end());
+}
+
+//----------------------------------------------------------------------------
+void vtkPlaneCutLocator::PrintSelf(ostream &os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "DataSet: " << this->DataSet << "\n";
+  os << indent << "NumberOfCellsPerLeaf: " << this->NumberOfCellsPerLeaf << "\n";
+  os << indent << "NumberOfNodes: " << this->Nodes.size() << "\n";
+}
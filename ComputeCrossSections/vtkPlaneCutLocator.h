@@ -0,0 +1,84 @@
+#ifndef vtkPlaneCutLocator_h
+#define vtkPlaneCutLocator_h
+
+#include <vtkObject.h>
+
+#include <utility>
+#include <vector>
+
+class vtkPolyData;
+
+// Description:
+// Bounding volume hierarchy over the cells of a poly data for finding
+// the cells a plane may intersect. The hierarchy is built once per
+// surface, after which each query visits only the nodes whose boxes
+// the plane passes through, so cutting a surface with many planes
+// costs about the size of each cut instead of the size of the surface.
+//
+// The query is conservative: every cell whose bounding box touches
+// the plane is returned, so cutting just those cells gives the same
+// result as cutting the whole surface.
+class vtkPlaneCutLocator : public vtkObject
+{
+public:
+  static vtkPlaneCutLocator *New();
+  vtkTypeMacro(vtkPlaneCutLocator, vtkObject);
+  virtual void PrintSelf(ostream &os, vtkIndent indent);
+
+  // Description:
+  // Set/get the poly data whose cells are indexed.
+  void SetDataSet(vtkPolyData* dataSet);
+  vtkGetObjectMacro(DataSet, vtkPolyData);
+
+  // Description:
+  // Set/get the maximum number of cells in a leaf. Defaults to 8.
+  vtkSetClampMacro(NumberOfCellsPerLeaf, int, 1, VTK_INT_MAX);
+  vtkGetMacro(NumberOfCellsPerLeaf, int);
+
+  // Description:
+  // Build the hierarchy. Must be called again after the data set
+  // changes.
+  void BuildLocator();
+
+  // Description:
+  // Find the cells whose bounding boxes touch any of several planes
+  // in one traversal of the hierarchy. Each node is tested against
+  // the planes that touch its parent only. origins and normals hold
+  // numberOfPlanes xyz triples. The result holds a (cell id, plane
+  // index) pair for each cell whose bounding box touches a plane,
+  // ordered by cell id then plane index. A single plane is a batch of
+  // one.
+  typedef std::pair<vtkIdType, vtkIdType> CellPlane;
+  void FindCellsAlongPlanes(size_t numberOfPlanes, const double* origins,
+                            const double* normals,
+                            std::vector<CellPlane> & cellPlanes) const;
+
+protected:
+  vtkPlaneCutLocator();
+  ~vtkPlaneCutLocator();
+
+private:
+  vtkPlaneCutLocator(const vtkPlaneCutLocator&); // Not implemented
+  void operator=(const vtkPlaneCutLocator&); // Not implemented
+
+  struct Node
+  {
+    double    Center[3];
+    double    HalfSize[3];
+    vtkIdType Begin;
+    vtkIdType End;
+    vtkIdType Left;  // -1 for a leaf
+    vtkIdType Right;
+  };
+
+  vtkIdType BuildNode(vtkIdType begin, vtkIdType end);
+
+  vtkPolyData*           DataSet;
+  int                    NumberOfCellsPerLeaf;
+  double                 Tolerance;
+  std::vector<Node>      Nodes;
+  std::vector<vtkIdType> CellIds;
+  std::vector<double>    CellBounds;
+};
+
+#endif // vtkPlaneCutLocator_h
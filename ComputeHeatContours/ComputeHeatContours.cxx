@@ -17,31 +17,68 @@
 =============================================================================*/
 
 #include "ComputeHeatContoursCLP.h"
+#include "HeatFlowContours.h"
+#include "Profiler.h"
 
-#include <vtkContourFilter.h>
+#include <vtkPolyData.h>
 #include <vtkSmartPointer.h>
+#include <vtkUnstructuredGrid.h>
 #include <vtkXMLPolyDataWriter.h>
 #include <vtkXMLUnstructuredGridReader.h>
 
+#include <algorithm>
+#include <iostream>
+#include <string>
+
 /*******************************************************************/
-// Compute heat contours from the thresholded heat image
+// Compute heat contours from the thresholded heat image, or from the
+// heat image itself
 int main( int argc, char* argv[])
 {
   PARSE_ARGS;
 
-  vtkSmartPointer<vtkXMLUnstructuredGridReader> reader =
-    vtkSmartPointer<vtkXMLUnstructuredGridReader>::New();
-  reader->SetFileName(input.c_str());
+  ProfileSession profileSession( "ComputeHeatContours", profile );
+
+  HeatFlowContours heatFlowContours;
+  heatFlowContours.SetNumberOfContours( numberOfContours );
+  heatFlowContours.SetNumberOfThreads( numberOfThreads );
+  if ( !heatFlowContours.SetValueSpacing( contourSpacing ) )
+    {
+    std::cerr << "Unknown contour spacing '" << contourSpacing << "'\n";
+    return EXIT_FAILURE;
+    }
+
+  vtkSmartPointer<vtkPolyData> contours = vtkSmartPointer<vtkPolyData>::New();
+
+  std::string vtuExtension( ".vtu" );
+  if ( std::equal( vtuExtension.rbegin(), vtuExtension.rend(), input.rbegin() ) )
+    {
+    vtkSmartPointer<vtkXMLUnstructuredGridReader> reader =
+      vtkSmartPointer<vtkXMLUnstructuredGridReader>::New();
+    reader->SetFileName(input.c_str());
+    {
+      ProfileTimer timer( "read heat flow grid" );
+      reader->Update();
+    }
+    Profiler::GetInstance().SetCounter( "heat flow cells",
+                                        reader->GetOutput()->GetNumberOfCells() );
+
+    heatFlowContours.Compute( reader->GetOutput(), contours );
+    }
+  else if ( !heatFlowContours.ComputeFromImageFile( input, contours ) )
+    {
+    return EXIT_FAILURE;
+    }
 
-  vtkIdType numContours = 100;
-  vtkSmartPointer<vtkContourFilter> contourFilter =
-    vtkSmartPointer<vtkContourFilter>::New();
-  contourFilter->GenerateValues( numContours, 0.0, 1.0 );
-  contourFilter->SetInputConnection( reader->GetOutputPort() );
+  Profiler & profiler = Profiler::GetInstance();
+  profiler.SetCounter( "contours", heatFlowContours.GetValues().size() );
+  profiler.SetCounter( "contour triangles", contours->GetNumberOfCells() );
+  profiler.SetCounter( "contour points", contours->GetNumberOfPoints() );
 
+  ProfileTimer timer( "write contours" );
   vtkSmartPointer<vtkXMLPolyDataWriter> writer =
     vtkSmartPointer<vtkXMLPolyDataWriter>::New();
-  writer->SetInputConnection(contourFilter->GetOutputPort());
+  writer->SetInputData(contours);
   writer->SetFileName(output.c_str());
   writer->Write();
 
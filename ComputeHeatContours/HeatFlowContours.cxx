@@ -0,0 +1,367 @@
+#include "HeatFlowContours.h"
+#include "HeatFlowImageContourer.h"
+#include "Profiler.h"
+
+#include <itkImage.h>
+#include <itkImageFileReader.h>
+#include <itkImageToVTKImageFilter.h>
+
+#include <vtkCellData.h>
+#include <vtkContourFilter.h>
+#include <vtkDataArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkFieldData.h>
+#include <vtkIdList.h>
+#include <vtkIdTypeArray.h>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  // Index of the value closest to x in sorted values
+  size_t FindClosestValue(const std::vector<double> & values, double x)
+  {
+    size_t i = std::lower_bound(values.begin(), values.end(), x) - values.begin();
+    if (i == values.size() || (i > 0 && x - values[i - 1] < values[i] - x))
+      {
+      --i;
+      }
+    return i;
+  }
+}
+
+//----------------------------------------------------------------------------
+HeatFlowContours::HeatFlowContours()
+{
+  this->NumberOfContours = 100;
+  this->NumberOfPilotContours = 64;
+  this->ValueSpacing = UniformSpacing;
+  this->NumberOfThreads = 0;
+  this->DataSet = NULL;
+  this->ImageContourer = NULL;
+}
+
+//----------------------------------------------------------------------------
+HeatFlowContours::~HeatFlowContours()
+{
+}
+
+//----------------------------------------------------------------------------
+void HeatFlowContours::SetNumberOfContours(int numberOfContours)
+{
+  this->NumberOfContours = std::max(numberOfContours, 1);
+}
+
+//----------------------------------------------------------------------------
+void HeatFlowContours::SetNumberOfPilotContours(int numberOfPilotContours)
+{
+  this->NumberOfPilotContours = std::max(numberOfPilotContours, 2);
+}
+
+//----------------------------------------------------------------------------
+void HeatFlowContours::SetValueSpacing(ValueSpacingType spacing)
+{
+  this->ValueSpacing = spacing;
+}
+
+//----------------------------------------------------------------------------
+bool HeatFlowContours::SetValueSpacing(const std::string & name)
+{
+  if (name == "uniform")
+    {
+    this->ValueSpacing = UniformSpacing;
+    }
+  else if (name == "arclength")
+    {
+    this->ValueSpacing = ArcLengthSpacing;
+    }
+  else if (name == "areachange")
+    {
+    this->ValueSpacing = AreaChangeSpacing;
+    }
+  else
+    {
+    return false;
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void HeatFlowContours::SetNumberOfThreads(int numberOfThreads)
+{
+  this->NumberOfThreads = numberOfThreads;
+}
+
+//----------------------------------------------------------------------------
+void HeatFlowContours::Compute(vtkDataSet* heatFlow, vtkPolyData* output)
+{
+  this->DataSet = heatFlow;
+  this->ImageContourer = NULL;
+
+  this->ComputeValues();
+  {
+    ProfileTimer timer("contour");
+    this->Contour(this->Values, output);
+  }
+
+  this->DataSet = NULL;
+}
+
+//----------------------------------------------------------------------------
+bool HeatFlowContours::ComputeFromImageFile(const std::string & fileName,
+                                            vtkPolyData* output)
+{
+  typedef itk::Image<float, 3> HeatFlowImageType;
+  typedef itk::ImageFileReader<HeatFlowImageType> HeatFlowReaderType;
+  HeatFlowReaderType::Pointer heatFlowReader = HeatFlowReaderType::New();
+  heatFlowReader->SetFileName(fileName.c_str());
+  try
+    {
+    ProfileTimer timer("read heat flow image");
+    heatFlowReader->Update();
+    }
+  catch (itk::ExceptionObject & except)
+    {
+    std::cerr << "Could not read heat flow image '" << fileName << "'\n";
+    std::cerr << except << std::endl;
+    return false;
+    }
+
+  HeatFlowImageType::Pointer heatFlowImage = heatFlowReader->GetOutput();
+  Profiler::GetInstance().SetCounter("voxels",
+    heatFlowImage->GetLargestPossibleRegion().GetNumberOfPixels());
+
+  // The contours must be in LPS like the segmented surface
+  HeatFlowImageType::DirectionType direction = heatFlowImage->GetDirection();
+  for (int i = 0; i < 3; ++i)
+    {
+    for (int j = 0; j < 3; ++j)
+      {
+      if (fabs(direction[i][j] - (i == j ? 1.0 : 0.0)) > 1e-6)
+        {
+        std::cerr << "Heat flow image is not in LPS coordinate system.\n";
+        return false;
+        }
+      }
+    }
+
+  typedef itk::ImageToVTKImageFilter<HeatFlowImageType> ITK2VTKFilterType;
+  ITK2VTKFilterType::Pointer itk2vtkFilter = ITK2VTKFilterType::New();
+  itk2vtkFilter->SetInput(heatFlowImage);
+  itk2vtkFilter->Update();
+
+  HeatFlowImageContourer contourer;
+  contourer.SetNumberOfThreads(this->NumberOfThreads);
+  if (!contourer.SetInput(itk2vtkFilter->GetOutput()))
+    {
+    std::cerr << "Heat flow image has no scalars to contour.\n";
+    return false;
+    }
+
+  this->DataSet = NULL;
+  this->ImageContourer = &contourer;
+
+  this->ComputeValues();
+  {
+    ProfileTimer timer("contour");
+    this->Contour(this->Values, output);
+  }
+
+  this->ImageContourer = NULL;
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void HeatFlowContours::Contour(const std::vector<double> & values, vtkPolyData* output)
+{
+  if (this->ImageContourer)
+    {
+    this->ImageContourer->Contour(values, output);
+    }
+  else
+    {
+    vtkSmartPointer<vtkContourFilter> contourFilter =
+      vtkSmartPointer<vtkContourFilter>::New();
+    contourFilter->SetNumberOfContours(static_cast<int>(values.size()));
+    for (size_t i = 0; i < values.size(); ++i)
+      {
+      contourFilter->SetValue(static_cast<int>(i), values[i]);
+      }
+    contourFilter->SetInputData(this->DataSet);
+    contourFilter->Update();
+
+    output->ShallowCopy(contourFilter->GetOutput());
+
+    // The contour filter does not keep track of the value of each
+    // cell. Points are interpolated at the contour value, so the value
+    // closest to that of the first point is the one of the cell.
+    vtkSmartPointer<vtkIdTypeArray> contourIDs =
+      vtkSmartPointer<vtkIdTypeArray>::New();
+    contourIDs->SetName("contour ID");
+    contourIDs->SetNumberOfTuples(output->GetNumberOfCells());
+
+    vtkDataArray* scalars = output->GetPointData()->GetScalars();
+    vtkSmartPointer<vtkIdList> ptIds = vtkSmartPointer<vtkIdList>::New();
+    for (vtkIdType cellId = 0; cellId < output->GetNumberOfCells(); ++cellId)
+      {
+      output->GetCellPoints(cellId, ptIds);
+      vtkIdType contour = 0;
+      if (scalars && ptIds->GetNumberOfIds() > 0)
+        {
+        contour = static_cast<vtkIdType>(
+          FindClosestValue(values, scalars->GetTuple1(ptIds->GetId(0))));
+        }
+      contourIDs->SetValue(cellId, contour);
+      }
+    output->GetCellData()->AddArray(contourIDs);
+    }
+
+  vtkSmartPointer<vtkDoubleArray> contourValues =
+    vtkSmartPointer<vtkDoubleArray>::New();
+  contourValues->SetName("contour values");
+  contourValues->SetNumberOfTuples(static_cast<vtkIdType>(values.size()));
+  std::copy(values.begin(), values.end(), contourValues->GetPointer(0));
+  output->GetFieldData()->AddArray(contourValues);
+}
+
+//----------------------------------------------------------------------------
+void HeatFlowContours::ComputeValues()
+{
+  int numberOfContours = this->NumberOfContours;
+  GenerateUniformValues(numberOfContours, this->Values);
+  if (this->ValueSpacing == UniformSpacing || numberOfContours < 3)
+    {
+    return;
+    }
+
+  ProfileTimer timer("space contour values");
+
+  // Measure the area and centroid of each pilot contour
+  std::vector<double> pilotValues;
+  GenerateUniformValues(this->NumberOfPilotContours, pilotValues);
+  size_t numberOfPilots = pilotValues.size();
+
+  vtkSmartPointer<vtkPolyData> pilots = vtkSmartPointer<vtkPolyData>::New();
+  this->Contour(pilotValues, pilots);
+
+  std::vector<double> area(numberOfPilots, 0.0);
+  std::vector<double> centroid(3 * numberOfPilots, 0.0);
+  vtkIdTypeArray* contourIDs =
+    vtkIdTypeArray::SafeDownCast(pilots->GetCellData()->GetArray("contour ID"));
+  vtkSmartPointer<vtkIdList> ptIds = vtkSmartPointer<vtkIdList>::New();
+  for (vtkIdType cellId = 0; cellId < pilots->GetNumberOfCells(); ++cellId)
+    {
+    pilots->GetCellPoints(cellId, ptIds);
+    if (ptIds->GetNumberOfIds() < 3)
+      {
+      continue;
+      }
+    size_t pilot = static_cast<size_t>(contourIDs->GetValue(cellId));
+
+    double p0[3], p1[3], p2[3];
+    pilots->GetPoint(ptIds->GetId(0), p0);
+    for (vtkIdType i = 1; i + 1 < ptIds->GetNumberOfIds(); ++i)
+      {
+      pilots->GetPoint(ptIds->GetId(i), p1);
+      pilots->GetPoint(ptIds->GetId(i + 1), p2);
+      double u[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+      double v[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+      double n[3] = { u[1]*v[2] - u[2]*v[1], u[2]*v[0] - u[0]*v[2], u[0]*v[1] - u[1]*v[0] };
+      double a = 0.5 * sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+      area[pilot] += a;
+      for (int c = 0; c < 3; ++c)
+        {
+        centroid[3*pilot + c] += a * (p0[c] + p1[c] + p2[c]) / 3.0;
+        }
+      }
+    }
+
+  // Arc length and log area change between successive non-empty
+  // pilot contours, spread over the value intervals between them
+  std::vector<double> length(numberOfPilots - 1, 0.0);
+  std::vector<double> change(numberOfPilots - 1, 0.0);
+  double totalLength = 0.0;
+  double totalChange = 0.0;
+  int previous = -1;
+  for (size_t i = 0; i < numberOfPilots; ++i)
+    {
+    if (area[i] <= 0.0)
+      {
+      continue;
+      }
+    for (int c = 0; c < 3; ++c)
+      {
+      centroid[3*i + c] /= area[i];
+      }
+    if (previous >= 0)
+      {
+      double d2 = 0.0;
+      for (int c = 0; c < 3; ++c)
+        {
+        double d = centroid[3*i + c] - centroid[3*previous + c];
+        d2 += d*d;
+        }
+      double d = sqrt(d2);
+      double dA = fabs(log(area[i] / area[previous]));
+      double width = pilotValues[i] - pilotValues[previous];
+      for (size_t k = previous; k < i; ++k)
+        {
+        double fraction = (pilotValues[k + 1] - pilotValues[k]) / width;
+        length[k] += fraction * d;
+        change[k] += fraction * dA;
+        }
+      totalLength += d;
+      totalChange += dA;
+      }
+    previous = static_cast<int>(i);
+    }
+
+  if (totalLength <= 0.0)
+    {
+    // Too few pilot contours to follow the airway
+    return;
+    }
+
+  std::vector<double> cost(numberOfPilots, 0.0);
+  for (size_t k = 0; k + 1 < numberOfPilots; ++k)
+    {
+    double intervalCost = length[k] / totalLength;
+    if (this->ValueSpacing == AreaChangeSpacing && totalChange > 0.0)
+      {
+      intervalCost = 0.5 * intervalCost + 0.5 * change[k] / totalChange;
+      }
+    cost[k + 1] = cost[k] + intervalCost;
+    }
+
+  // Place the values at equal steps of the cumulative cost. The cost
+  // increases strictly across the interval each step falls in, so the
+  // values are distinct.
+  double totalCost = cost[numberOfPilots - 1];
+  size_t k = 0;
+  for (int i = 1; i + 1 < numberOfContours; ++i)
+    {
+    double target = totalCost * i / (numberOfContours - 1);
+    while (k + 2 < numberOfPilots && cost[k + 1] < target)
+      {
+      ++k;
+      }
+    double t = cost[k + 1] > cost[k] ? (target - cost[k]) / (cost[k + 1] - cost[k]) : 1.0;
+    this->Values[i] = pilotValues[k] + t * (pilotValues[k + 1] - pilotValues[k]);
+    }
+}
+
+//----------------------------------------------------------------------------
+void HeatFlowContours::GenerateUniformValues(int count, std::vector<double> & values)
+{
+  values.resize(count);
+  for (int i = 0; i < count; ++i)
+    {
+    values[i] = count > 1 ? static_cast<double>(i) / (count - 1) : 0.0;
+    }
+}
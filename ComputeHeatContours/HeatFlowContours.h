@@ -0,0 +1,106 @@
+#ifndef HeatFlowContours_h
+#define HeatFlowContours_h
+
+#include <string>
+#include <vector>
+
+class HeatFlowImageContourer;
+class vtkDataSet;
+class vtkPolyData;
+
+// Description:
+// Contours of the heat flow field, the solution of the Laplace
+// equation through the airway, at values from 0 to 1. The heat flow is
+// taken from the point scalars of the input.
+//
+// The values are evenly spaced by default. They can also be placed
+// adaptively from a first pass of pilot contours: at equal arc length
+// along the curve through the pilot contour centroids, which follows
+// the airway, or with half of them by arc length and half by the rate
+// of change of the pilot contour areas, which puts more contours where
+// the airway narrows or widens.
+//
+// The contours carry the index of their value in the "contour ID" cell
+// array and the values in the "contour values" field data array.
+class HeatFlowContours
+{
+public:
+  enum ValueSpacingType
+  {
+    UniformSpacing,
+    ArcLengthSpacing,
+    AreaChangeSpacing
+  };
+
+  HeatFlowContours();
+  ~HeatFlowContours();
+
+  // Description:
+  // Set the number of contours. Defaults to 100.
+  void SetNumberOfContours(int numberOfContours);
+
+  // Description:
+  // Set the number of pilot contours measured to place adaptive
+  // values. Defaults to 64.
+  void SetNumberOfPilotContours(int numberOfPilotContours);
+
+  // Description:
+  // Set how the contour values are spaced. The name is one of
+  // "uniform", "arclength" or "areachange"; returns false for others.
+  void SetValueSpacing(ValueSpacingType spacing);
+  bool SetValueSpacing(const std::string & name);
+
+  // Description:
+  // Set the number of threads used to contour images. 0, the default,
+  // uses the ITK default number of threads.
+  void SetNumberOfThreads(int numberOfThreads);
+
+  // Description:
+  // Contour a heat flow data set, e.g. the grid written by
+  // ThresholdLaplaceSolution, into output.
+  void Compute(vtkDataSet* heatFlow, vtkPolyData* output);
+
+  // Description:
+  // Read a heat flow image and contour it on its grid with
+  // HeatFlowImageContourer. Voxels with a NaN corner, outside the
+  // airway, are not contoured. Returns false, after printing why, if
+  // the image cannot be read or is not in LPS orientation.
+  bool ComputeFromImageFile(const std::string & fileName, vtkPolyData* output);
+
+  // Description:
+  // Get the contour values of the last computation, in increasing
+  // order.
+  const std::vector<double> & GetValues() const { return this->Values; }
+
+private:
+  HeatFlowContours(const HeatFlowContours&); // Not implemented
+  void operator=(const HeatFlowContours&); // Not implemented
+
+  // Description:
+  // Contour the data set or the image at the given values and add the
+  // contour IDs and values.
+  void Contour(const std::vector<double> & values, vtkPolyData* output);
+
+  // Description:
+  // Compute the contour values, contouring the pilot values first for
+  // adaptive spacing.
+  void ComputeValues();
+
+  // Description:
+  // Fill values with count evenly spaced values from 0 to 1, as
+  // vtkContourFilter::GenerateValues() does.
+  static void GenerateUniformValues(int count, std::vector<double> & values);
+
+  int                     NumberOfContours;
+  int                     NumberOfPilotContours;
+  ValueSpacingType        ValueSpacing;
+  int                     NumberOfThreads;
+
+  // Input of the current computation
+  vtkDataSet*             DataSet;
+  HeatFlowImageContourer* ImageContourer;
+
+  std::vector<double>     Values;
+};
+
+#endif // HeatFlowContours_h
@@ -0,0 +1,613 @@
+#include "HeatFlowImageContourer.h"
+
+#include "itkThreadedRange.h"
+
+#include <itkMultiThreader.h>
+
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkFloatArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkImageData.h>
+#include <vtkMarchingCubesTriangleCases.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+#include <algorithm>
+#include <cfloat>
+
+namespace
+{
+  // Corners of a voxel are numbered with x varying fastest, then y,
+  // then z. The edges of a voxel go from their lower corner to their
+  // upper one and are numbered as in vtkVoxel, which matches the
+  // marching cubes cases.
+  const int VoxelEdges[12][2] = { {0,1}, {1,3}, {2,3}, {0,2},
+                                  {4,5}, {5,7}, {6,7}, {4,6},
+                                  {0,4}, {1,5}, {2,6}, {3,7} };
+
+  // Voxel corner of each hexahedron corner of the marching cubes cases
+  const int HexahedronToVoxel[8] = { 0, 1, 3, 2, 4, 5, 7, 6 };
+
+  // False for NaN and infinite values
+  inline bool IsFinite(float s)
+  {
+    return s - s == 0.0f;
+  }
+
+  // Axis of the voxel edge between corners a and b
+  inline int EdgeAxis(int a, int b)
+  {
+    int d = a ^ b;
+    return d == 1 ? 0 : ( d == 2 ? 1 : 2 );
+  }
+}
+
+//----------------------------------------------------------------------------
+// Classifies the voxels of a range of layers.
+struct HeatFlowImageContourer::InitializeFunctor
+{
+  HeatFlowImageContourer* Self;
+
+  void operator()(itk::SizeValueType, itk::SizeValueType begin, itk::SizeValueType end)
+  {
+    for (itk::SizeValueType k = begin; k < end; ++k)
+      {
+      this->Self->InitializeLayer(static_cast<int>(k));
+      }
+  }
+};
+
+//----------------------------------------------------------------------------
+// Counts the points and triangles of a contour in a range of layers.
+struct HeatFlowImageContourer::CountFunctor
+{
+  const HeatFlowImageContourer* Self;
+  double                        Value;
+  std::vector<vtkIdType>*       LayerPoints;
+  std::vector<vtkIdType>*       LayerTriangles;
+
+  void operator()(itk::SizeValueType, itk::SizeValueType begin, itk::SizeValueType end)
+  {
+    LayerPointIds ids;
+    this->Self->AllocateLayer(ids);
+
+    for (itk::SizeValueType k = begin; k < end; ++k)
+      {
+      int layer = static_cast<int>(k);
+      ( *this->LayerPoints )[k] =
+        this->Self->NumberLayer(layer, this->Value, 0, ids, NULL);
+      ( *this->LayerTriangles )[k] =
+        this->Self->ContourLayer(layer, this->Value, ids, ids, NULL);
+      }
+  }
+};
+
+//----------------------------------------------------------------------------
+// Writes the points and triangles of a contour in a range of layers
+// at the offsets of the layers.
+struct HeatFlowImageContourer::GenerateFunctor
+{
+  const HeatFlowImageContourer*  Self;
+  double                         Value;
+  const std::vector<vtkIdType>*  PointOffsets;
+  const std::vector<vtkIdType>*  TriangleOffsets;
+  float*                         Points;
+  vtkIdType*                     Cells;
+
+  void operator()(itk::SizeValueType, itk::SizeValueType begin, itk::SizeValueType end)
+  {
+    if (begin >= end)
+      {
+      return;
+      }
+
+    LayerPointIds lower;
+    LayerPointIds upper;
+    this->Self->AllocateLayer(lower);
+    this->Self->AllocateLayer(upper);
+
+    int numberOfLayers = this->Self->Dimensions[2];
+    this->Self->NumberLayer(static_cast<int>(begin), this->Value,
+                            ( *this->PointOffsets )[begin], lower, this->Points);
+    for (itk::SizeValueType k = begin; k < end; ++k)
+      {
+      int layer = static_cast<int>(k);
+      if (layer + 1 >= numberOfLayers)
+        {
+        break;
+        }
+
+      // The ids of the next layer are needed for the voxels below it,
+      // but its points are written by the range that owns it
+      this->Self->NumberLayer(layer + 1, this->Value, ( *this->PointOffsets )[k + 1],
+                              upper, k + 1 < end ? this->Points : NULL);
+      this->Self->ContourLayer(layer, this->Value, lower, upper,
+                               this->Cells + 4 * ( *this->TriangleOffsets )[k]);
+
+      lower.Vertex.swap(upper.Vertex);
+      for (int axis = 0; axis < 3; ++axis)
+        {
+        lower.Edge[axis].swap(upper.Edge[axis]);
+        }
+      }
+  }
+};
+
+//----------------------------------------------------------------------------
+HeatFlowImageContourer::HeatFlowImageContourer()
+{
+  this->NumberOfThreads = 0;
+  this->Scalars = NULL;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    this->Dimensions[axis] = 0;
+    this->Increments[axis] = 0;
+    this->Origin[axis] = 0.0;
+    this->Spacing[axis] = 1.0;
+    }
+}
+
+//----------------------------------------------------------------------------
+HeatFlowImageContourer::~HeatFlowImageContourer()
+{
+}
+
+//----------------------------------------------------------------------------
+void HeatFlowImageContourer::SetNumberOfThreads(int numberOfThreads)
+{
+  this->NumberOfThreads = numberOfThreads;
+}
+
+//----------------------------------------------------------------------------
+bool HeatFlowImageContourer::SetInput(vtkImageData* image)
+{
+  vtkFloatArray* scalars =
+    vtkFloatArray::SafeDownCast(image->GetPointData()->GetScalars());
+  if (!scalars || scalars->GetNumberOfComponents() != 1)
+    {
+    return false;
+    }
+
+  this->Scalars = scalars->GetPointer(0);
+  this->ScalarsName = scalars->GetName() ? scalars->GetName() : "scalars";
+
+  int extent[6];
+  image->GetExtent(extent);
+  image->GetSpacing(this->Spacing);
+  image->GetOrigin(this->Origin);
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    this->Dimensions[axis] = extent[2*axis + 1] - extent[2*axis] + 1;
+    this->Origin[axis] += extent[2*axis] * this->Spacing[axis];
+    }
+  this->Increments[0] = 1;
+  this->Increments[1] = this->Dimensions[0];
+  this->Increments[2] = static_cast<vtkIdType>(this->Dimensions[0]) * this->Dimensions[1];
+
+  vtkIdType numberOfRows = static_cast<vtkIdType>(this->Dimensions[1]) * this->Dimensions[2];
+  this->ValidVoxels.assign(this->Increments[2] * this->Dimensions[2], 0);
+  this->RowMinimum.assign(numberOfRows, FLT_MAX);
+  this->RowMaximum.assign(numberOfRows, -FLT_MAX);
+
+  itk::ThreadIdType threads = this->NumberOfThreads > 0 ?
+    static_cast<itk::ThreadIdType>(this->NumberOfThreads) :
+    itk::MultiThreader::GetGlobalDefaultNumberOfThreads();
+  InitializeFunctor initialize;
+  initialize.Self = this;
+  itk::ThreadedRange::Execute(threads,
+    itk::ThreadedRange::GetNumberOfChunks(threads, this->Dimensions[2]),
+    this->Dimensions[2], initialize);
+
+  // The points and voxels around a row use the rows next to it
+  this->NeighborhoodMinimum.assign(numberOfRows, FLT_MAX);
+  this->NeighborhoodMaximum.assign(numberOfRows, -FLT_MAX);
+  for (int k = 0; k < this->Dimensions[2]; ++k)
+    {
+    for (int j = 0; j < this->Dimensions[1]; ++j)
+      {
+      vtkIdType row = j + static_cast<vtkIdType>(this->Dimensions[1]) * k;
+      for (int nk = std::max(k - 1, 0); nk <= std::min(k + 1, this->Dimensions[2] - 1); ++nk)
+        {
+        for (int nj = std::max(j - 1, 0); nj <= std::min(j + 1, this->Dimensions[1] - 1); ++nj)
+          {
+          vtkIdType neighbor = nj + static_cast<vtkIdType>(this->Dimensions[1]) * nk;
+          this->NeighborhoodMinimum[row] =
+            std::min(this->NeighborhoodMinimum[row], this->RowMinimum[neighbor]);
+          this->NeighborhoodMaximum[row] =
+            std::max(this->NeighborhoodMaximum[row], this->RowMaximum[neighbor]);
+          }
+        }
+      }
+    }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void HeatFlowImageContourer::Contour(const std::vector<double> & values,
+                                     vtkPolyData* output)
+{
+  itk::ThreadIdType threads = this->NumberOfThreads > 0 ?
+    static_cast<itk::ThreadIdType>(this->NumberOfThreads) :
+    itk::MultiThreader::GetGlobalDefaultNumberOfThreads();
+
+  // A few ranges of layers per thread balance the rows that are
+  // skipped
+  itk::SizeValueType numberOfLayers = this->Scalars ? this->Dimensions[2] : 0;
+  itk::SizeValueType numberOfChunks =
+    itk::ThreadedRange::GetNumberOfChunks(4 * threads, numberOfLayers);
+
+  std::vector<float>     points;
+  std::vector<vtkIdType> cells;
+  std::vector<float>     pointValues;
+  std::vector<vtkIdType> triangleContours;
+
+  std::vector<vtkIdType> layerPoints(numberOfLayers);
+  std::vector<vtkIdType> layerTriangles(numberOfLayers);
+  std::vector<vtkIdType> pointOffsets(numberOfLayers);
+  std::vector<vtkIdType> triangleOffsets(numberOfLayers);
+
+  for (size_t v = 0; v < values.size() && numberOfLayers > 0; ++v)
+    {
+    CountFunctor count;
+    count.Self = this;
+    count.Value = values[v];
+    count.LayerPoints = &layerPoints;
+    count.LayerTriangles = &layerTriangles;
+    itk::ThreadedRange::Execute(threads,
+                                numberOfChunks, numberOfLayers, count);
+
+    vtkIdType numberOfPoints = static_cast<vtkIdType>(pointValues.size());
+    vtkIdType numberOfTriangles = static_cast<vtkIdType>(cells.size() / 4);
+    for (itk::SizeValueType k = 0; k < numberOfLayers; ++k)
+      {
+      pointOffsets[k] = numberOfPoints;
+      triangleOffsets[k] = numberOfTriangles;
+      numberOfPoints += layerPoints[k];
+      numberOfTriangles += layerTriangles[k];
+      }
+
+    points.resize(3 * numberOfPoints);
+    cells.resize(4 * numberOfTriangles);
+    pointValues.resize(numberOfPoints, static_cast<float>(values[v]));
+    triangleContours.resize(numberOfTriangles, static_cast<vtkIdType>(v));
+    if (numberOfPoints == 0)
+      {
+      continue;
+      }
+
+    GenerateFunctor generate;
+    generate.Self = this;
+    generate.Value = values[v];
+    generate.PointOffsets = &pointOffsets;
+    generate.TriangleOffsets = &triangleOffsets;
+    generate.Points = &points[0];
+    generate.Cells = cells.empty() ? NULL : &cells[0];
+    itk::ThreadedRange::Execute(threads,
+                                numberOfChunks, numberOfLayers, generate);
+    }
+
+  vtkSmartPointer<vtkFloatArray> coordinates = vtkSmartPointer<vtkFloatArray>::New();
+  coordinates->SetNumberOfComponents(3);
+  coordinates->SetNumberOfTuples(static_cast<vtkIdType>(pointValues.size()));
+  std::copy(points.begin(), points.end(), coordinates->GetPointer(0));
+  vtkSmartPointer<vtkPoints> outputPoints = vtkSmartPointer<vtkPoints>::New();
+  outputPoints->SetData(coordinates);
+
+  vtkSmartPointer<vtkFloatArray> scalars = vtkSmartPointer<vtkFloatArray>::New();
+  scalars->SetName(this->ScalarsName.c_str());
+  scalars->SetNumberOfTuples(static_cast<vtkIdType>(pointValues.size()));
+  std::copy(pointValues.begin(), pointValues.end(), scalars->GetPointer(0));
+
+  vtkSmartPointer<vtkIdTypeArray> connectivity = vtkSmartPointer<vtkIdTypeArray>::New();
+  connectivity->SetNumberOfTuples(static_cast<vtkIdType>(cells.size()));
+  std::copy(cells.begin(), cells.end(), connectivity->GetPointer(0));
+  vtkSmartPointer<vtkCellArray> polys = vtkSmartPointer<vtkCellArray>::New();
+  polys->SetCells(static_cast<vtkIdType>(cells.size() / 4), connectivity);
+
+  vtkSmartPointer<vtkIdTypeArray> contourIDs = vtkSmartPointer<vtkIdTypeArray>::New();
+  contourIDs->SetName("contour ID");
+  contourIDs->SetNumberOfTuples(static_cast<vtkIdType>(triangleContours.size()));
+  std::copy(triangleContours.begin(), triangleContours.end(), contourIDs->GetPointer(0));
+
+  output->Initialize();
+  output->SetPoints(outputPoints);
+  output->SetPolys(polys);
+  output->GetPointData()->SetScalars(scalars);
+  output->GetCellData()->AddArray(contourIDs);
+}
+
+//----------------------------------------------------------------------------
+void HeatFlowImageContourer::AllocateLayer(LayerPointIds & ids) const
+{
+  ids.Vertex.resize(this->Increments[2]);
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    ids.Edge[axis].resize(this->Increments[2]);
+    }
+}
+
+//----------------------------------------------------------------------------
+void HeatFlowImageContourer::InitializeLayer(int k)
+{
+  const int* dims = this->Dimensions;
+  for (int j = 0; j < dims[1]; ++j)
+    {
+    vtkIdType row = j + static_cast<vtkIdType>(dims[1]) * k;
+    float minimum = FLT_MAX;
+    float maximum = -FLT_MAX;
+    for (int i = 0; i < dims[0]; ++i)
+      {
+      vtkIdType p = this->GetPointIndex(i, j, k);
+      float s = this->Scalars[p];
+      if (IsFinite(s))
+        {
+        minimum = std::min(minimum, s);
+        maximum = std::max(maximum, s);
+        }
+
+      if (i + 1 >= dims[0] || j + 1 >= dims[1] || k + 1 >= dims[2])
+        {
+        continue;
+        }
+      bool valid = true;
+      for (int corner = 0; corner < 8 && valid; ++corner)
+        {
+        valid = IsFinite(this->Scalars[p + ( corner & 1 ) * this->Increments[0] +
+                                           ( ( corner >> 1 ) & 1 ) * this->Increments[1] +
+                                           ( ( corner >> 2 ) & 1 ) * this->Increments[2]]);
+        }
+      this->ValidVoxels[p] = valid ? 1 : 0;
+      }
+    this->RowMinimum[row] = minimum;
+    this->RowMaximum[row] = maximum;
+    }
+}
+
+//----------------------------------------------------------------------------
+bool HeatFlowImageContourer::RowMayCross(int j, int k, double value) const
+{
+  // A contour crosses an edge whose ends are on either side of value,
+  // i.e., one below it and the other at or above it
+  vtkIdType row = j + static_cast<vtkIdType>(this->Dimensions[1]) * k;
+  return this->NeighborhoodMinimum[row] < value &&
+         value <= this->NeighborhoodMaximum[row];
+}
+
+//----------------------------------------------------------------------------
+bool HeatFlowImageContourer::EdgeHasValidVoxel(int axis, int i, int j, int k) const
+{
+  // The voxels around the edge are those with the same index along
+  // the axis and the index or the index - 1 along the other axes
+  int index[3] = { i, j, k };
+  int u = ( axis + 1 ) % 3;
+  int v = ( axis + 2 ) % 3;
+  for (int du = -1; du <= 0; ++du)
+    {
+    for (int dv = -1; dv <= 0; ++dv)
+      {
+      int voxel[3] = { index[0], index[1], index[2] };
+      voxel[u] += du;
+      voxel[v] += dv;
+      if (voxel[u] < 0 || voxel[u] + 1 >= this->Dimensions[u] ||
+          voxel[v] < 0 || voxel[v] + 1 >= this->Dimensions[v])
+        {
+        continue;
+        }
+      if (this->ValidVoxels[this->GetPointIndex(voxel[0], voxel[1], voxel[2])])
+        {
+        return true;
+        }
+      }
+    }
+
+  return false;
+}
+
+//----------------------------------------------------------------------------
+bool HeatFlowImageContourer::VertexIsUsed(int i, int j, int k, double value) const
+{
+  int index[3] = { i, j, k };
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    for (int direction = -1; direction <= 1; direction += 2)
+      {
+      int neighbor[3] = { index[0], index[1], index[2] };
+      neighbor[axis] += direction;
+      if (neighbor[axis] < 0 || neighbor[axis] >= this->Dimensions[axis])
+        {
+        continue;
+        }
+
+      // The grid point is at value, so the edge is crossed if the
+      // neighbor is below it
+      float s = this->Scalars[this->GetPointIndex(neighbor[0], neighbor[1], neighbor[2])];
+      if (!IsFinite(s) || s >= value)
+        {
+        continue;
+        }
+
+      int* lower = direction < 0 ? neighbor : index;
+      if (this->EdgeHasValidVoxel(axis, lower[0], lower[1], lower[2]))
+        {
+        return true;
+        }
+      }
+    }
+
+  return false;
+}
+
+//----------------------------------------------------------------------------
+vtkIdType HeatFlowImageContourer::NumberLayer(int k, double value, vtkIdType firstId,
+                                              LayerPointIds & ids, float* points) const
+{
+  const int* dims = this->Dimensions;
+  vtkIdType id = firstId;
+  for (int j = 0; j < dims[1]; ++j)
+    {
+    if (!this->RowMayCross(j, k, value))
+      {
+      continue;
+      }
+
+    for (int i = 0; i < dims[0]; ++i)
+      {
+      vtkIdType p = this->GetPointIndex(i, j, k);
+      vtkIdType l = i + this->Increments[1] * j;
+      float s = this->Scalars[p];
+      if (!IsFinite(s))
+        {
+        continue;
+        }
+
+      double x[3] = { this->Origin[0] + i * this->Spacing[0],
+                      this->Origin[1] + j * this->Spacing[1],
+                      this->Origin[2] + k * this->Spacing[2] };
+
+      // All the crossings on a grid point are merged into one point
+      if (s == value && this->VertexIsUsed(i, j, k, value))
+        {
+        ids.Vertex[l] = id;
+        if (points)
+          {
+          for (int c = 0; c < 3; ++c)
+            {
+            points[3*id + c] = static_cast<float>(x[c]);
+            }
+          }
+        ++id;
+        }
+
+      int index[3] = { i, j, k };
+      for (int axis = 0; axis < 3; ++axis)
+        {
+        if (index[axis] + 1 >= dims[axis])
+          {
+          continue;
+          }
+
+        float t = this->Scalars[p + this->Increments[axis]];
+        if (!IsFinite(t) || ( s >= value ) == ( t >= value ) ||
+            ( s >= value ? s : t ) == value ||
+            !this->EdgeHasValidVoxel(axis, i, j, k))
+          {
+          continue;
+          }
+
+        ids.Edge[axis][l] = id;
+        if (points)
+          {
+          double r = ( value - s ) / ( t - s );
+          for (int c = 0; c < 3; ++c)
+            {
+            double y = x[c] + ( c == axis ? r * this->Spacing[c] : 0.0 );
+            points[3*id + c] = static_cast<float>(y);
+            }
+          }
+        ++id;
+        }
+      }
+    }
+
+  return id - firstId;
+}
+
+//----------------------------------------------------------------------------
+vtkIdType HeatFlowImageContourer::ContourLayer(int k, double value,
+                                               const LayerPointIds & lower,
+                                               const LayerPointIds & upper,
+                                               vtkIdType* cells) const
+{
+  const int* dims = this->Dimensions;
+  if (k + 1 >= dims[2])
+    {
+    return 0;
+    }
+
+  vtkMarchingCubesTriangleCases* cases = vtkMarchingCubesTriangleCases::GetCases();
+
+  vtkIdType count = 0;
+  for (int j = 0; j + 1 < dims[1]; ++j)
+    {
+    if (!this->RowMayCross(j, k, value))
+      {
+      continue;
+      }
+
+    for (int i = 0; i + 1 < dims[0]; ++i)
+      {
+      vtkIdType p = this->GetPointIndex(i, j, k);
+      if (!this->ValidVoxels[p])
+        {
+        continue;
+        }
+
+      double s[8];
+      for (int corner = 0; corner < 8; ++corner)
+        {
+        s[corner] = this->Scalars[p + ( corner & 1 ) * this->Increments[0] +
+                                  ( ( corner >> 1 ) & 1 ) * this->Increments[1] +
+                                  ( ( corner >> 2 ) & 1 ) * this->Increments[2]];
+        }
+
+      int index = 0;
+      for (int corner = 0; corner < 8; ++corner)
+        {
+        if (s[HexahedronToVoxel[corner]] >= value)
+          {
+          index |= 1 << corner;
+          }
+        }
+      if (index == 0 || index == 255)
+        {
+        continue;
+        }
+
+      for (const EDGE_LIST* edge = cases[index].edges; edge[0] > -1; edge += 3)
+        {
+        // A crossing is identified by its edge, or by its corner if it
+        // is on one. Triangles with merged points are dropped.
+        int keys[3];
+        for (int m = 0; m < 3; ++m)
+          {
+          int a = VoxelEdges[edge[m]][0];
+          int b = VoxelEdges[edge[m]][1];
+          int above = s[a] >= value ? a : b;
+          keys[m] = s[above] == value ? 12 + above : edge[m];
+          }
+        if (keys[0] == keys[1] || keys[0] == keys[2] || keys[1] == keys[2])
+          {
+          continue;
+          }
+
+        if (cells)
+          {
+          vtkIdType* triangle = cells + 4*count;
+          triangle[0] = 3;
+          for (int m = 0; m < 3; ++m)
+            {
+            int corner = keys[m] >= 12 ? keys[m] - 12 : VoxelEdges[keys[m]][0];
+            const LayerPointIds & layer = ( corner >> 2 ) & 1 ? upper : lower;
+            vtkIdType l = i + ( corner & 1 ) + this->Increments[1] * ( j + ( ( corner >> 1 ) & 1 ) );
+            if (keys[m] >= 12)
+              {
+              triangle[m + 1] = layer.Vertex[l];
+              }
+            else
+              {
+              int axis = EdgeAxis(VoxelEdges[keys[m]][0], VoxelEdges[keys[m]][1]);
+              triangle[m + 1] = layer.Edge[axis][l];
+              }
+            }
+          }
+        ++count;
+        }
+      }
+    }
+
+  return count;
+}
@@ -0,0 +1,135 @@
+#ifndef HeatFlowImageContourer_h
+#define HeatFlowImageContourer_h
+
+#include <vtkType.h>
+
+#include <string>
+#include <vector>
+
+class vtkImageData;
+class vtkPolyData;
+
+// Description:
+// Contours a float image directly on its grid with marching cubes,
+// without turning the image into an unstructured grid first.
+//
+// Voxels with a NaN corner, i.e., outside the airway, are not
+// contoured. Each contour is computed in two passes over the layers
+// of the image, run concurrently: the first counts the points and
+// triangles of each layer, the second writes them at offsets given by
+// the counts. Every edge crossing gives one point shared by all the
+// voxels around the edge, and crossings on a grid point are merged
+// into one point, so the result does not depend on the number of
+// threads. Rows of the image whose neighborhood does not span a
+// contour value are skipped.
+//
+// The triangles are those of vtkVoxel, so the contours match those of
+// vtkContourFilter on the voxels of the image that have no NaN corner.
+class HeatFlowImageContourer
+{
+public:
+  HeatFlowImageContourer();
+  ~HeatFlowImageContourer();
+
+  // Description:
+  // Set the number of threads. 0, the default, uses the ITK default
+  // number of threads.
+  void SetNumberOfThreads(int numberOfThreads);
+
+  // Description:
+  // Set the image to contour. Its point scalars must be a float array
+  // with one component. Returns false otherwise.
+  bool SetInput(vtkImageData* image);
+
+  // Description:
+  // Contour the image at the given values into output. The point
+  // scalars of output hold the contour value of each point, in an
+  // array named like the image scalars, and the "contour ID" cell
+  // array holds the index in values of the contour of each triangle.
+  void Contour(const std::vector<double> & values, vtkPolyData* output);
+
+private:
+  HeatFlowImageContourer(const HeatFlowImageContourer&); // Not implemented
+  void operator=(const HeatFlowImageContourer&); // Not implemented
+
+  struct InitializeFunctor;
+  struct CountFunctor;
+  struct GenerateFunctor;
+  friend struct InitializeFunctor;
+  friend struct CountFunctor;
+  friend struct GenerateFunctor;
+
+  // Description:
+  // Point ids of the contour points owned by one layer of the image,
+  // indexed by the grid point of the layer: points on grid points and
+  // points on the edges from the grid points along each axis.
+  struct LayerPointIds
+  {
+    std::vector<vtkIdType> Vertex;
+    std::vector<vtkIdType> Edge[3];
+  };
+
+  void AllocateLayer(LayerPointIds & ids) const;
+
+  vtkIdType GetPointIndex(int i, int j, int k) const
+  {
+    return i + this->Increments[1]*j + this->Increments[2]*k;
+  }
+
+  // Description:
+  // Classify the voxels of layer k and find the scalar range of its
+  // rows.
+  void InitializeLayer(int k);
+
+  // Description:
+  // Number the points of the contour at value owned by layer k from
+  // firstId on into ids and return how many there are. The
+  // coordinates are written to points, indexed by point id, if it is
+  // not null.
+  vtkIdType NumberLayer(int k, double value, vtkIdType firstId,
+                        LayerPointIds & ids, float* points) const;
+
+  // Description:
+  // Triangulate the contour at value in the voxels between layers k
+  // and k + 1 and return the number of triangles. The triangles are
+  // written to cells as vtkCellArray connectivity, using the point ids
+  // of the two layers, if cells is not null.
+  vtkIdType ContourLayer(int k, double value, const LayerPointIds & lower,
+                         const LayerPointIds & upper, vtkIdType* cells) const;
+
+  // Description:
+  // Return whether a contour at value may cross the voxels around row
+  // j of layer k.
+  bool RowMayCross(int j, int k, double value) const;
+
+  // Description:
+  // Return whether the edge from grid point (i, j, k) along axis
+  // belongs to a voxel without NaN corners.
+  bool EdgeHasValidVoxel(int axis, int i, int j, int k) const;
+
+  // Description:
+  // Return whether the contour at value passes through grid point
+  // (i, j, k), whose scalar is value, from a crossed edge of a voxel
+  // without NaN corners.
+  bool VertexIsUsed(int i, int j, int k, double value) const;
+
+  int                          NumberOfThreads;
+
+  const float*                 Scalars;
+  std::string                  ScalarsName;
+  int                          Dimensions[3];
+  vtkIdType                    Increments[3];
+  double                       Origin[3];
+  double                       Spacing[3];
+
+  // Whether the voxel at each grid point has no NaN corner
+  std::vector<unsigned char>   ValidVoxels;
+
+  // Scalar range of each row, and of the rows around each row
+  std::vector<float>           RowMinimum;
+  std::vector<float>           RowMaximum;
+  std::vector<float>           NeighborhoodMinimum;
+  std::vector<float>           NeighborhoodMaximum;
+};
+
+#endif // HeatFlowImageContourer_h
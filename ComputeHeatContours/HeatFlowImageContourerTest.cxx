@@ -0,0 +1,138 @@
+// Compares HeatFlowImageContourer with vtkContourFilter on the heat
+// flow of a synthetic airway. The reference contours the voxels
+// without NaN corners, which vtkThreshold extracts as an unstructured
+// grid of vtkVoxel cells, so both must give the same triangles: the
+// same number of triangles and points and the same area for each
+// contour value.
+
+// Local includes
+#include "AirwayPhantom.h"
+#include "HeatFlowImageContourer.h"
+
+#include "itkAirwayLaplaceSolutionFilter.h"
+
+#include <itkImage.h>
+#include <itkImageToVTKImageFilter.h>
+
+#include <vtkCellArray.h>
+#include <vtkContourFilter.h>
+#include <vtkImageData.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkThreshold.h>
+#include <vtkTriangle.h>
+#include <vtkUnstructuredGrid.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+  typedef AirwayPhantom::ImageType                                             LabelImageType;
+  typedef itk::Image<float, 3>                                                 HeatFlowImageType;
+  typedef itk::AirwayLaplaceSolutionFilter<LabelImageType, HeatFlowImageType> SolutionFilterType;
+  typedef itk::ImageToVTKImageFilter<HeatFlowImageType>                        ConnectorType;
+
+  // Largest relative difference allowed between the areas of two
+  // contours, whose points are stored as floats
+  const double AreaTolerance = 1e-5;
+
+  /*******************************************************************/
+  /** Total area of the triangles of a contour. */
+  /*******************************************************************/
+  double ComputeArea(vtkPolyData* contour)
+  {
+    double area = 0.0;
+    vtkCellArray* polys = contour->GetPolys();
+    vtkIdType npts;
+    vtkIdType* pts;
+    for (polys->InitTraversal(); polys->GetNextCell(npts, pts); )
+      {
+      double p0[3], p1[3], p2[3];
+      contour->GetPoint(pts[0], p0);
+      contour->GetPoint(pts[1], p1);
+      contour->GetPoint(pts[2], p2);
+      area += vtkTriangle::TriangleArea(p0, p1, p2);
+      }
+    return area;
+  }
+}
+
+int main(int, char*[])
+{
+  AirwayPhantom phantom;
+  phantom.Update();
+
+  SolutionFilterType::Pointer solutionFilter = SolutionFilterType::New();
+  solutionFilter->SetInput(phantom.GetLabelImage());
+  solutionFilter->SetNosePoint(phantom.GetNosePoint());
+  solutionFilter->SetNoseVector(phantom.GetNoseVector());
+  solutionFilter->SetTrachPoint(phantom.GetTracheaPoint());
+  solutionFilter->SetTrachVector(phantom.GetTracheaVector());
+
+  ConnectorType::Pointer connector = ConnectorType::New();
+  connector->SetInput(solutionFilter->GetOutput());
+  try
+    {
+    connector->Update();
+    }
+  catch (itk::ExceptionObject & e)
+    {
+    std::cerr << e << std::endl;
+    return EXIT_FAILURE;
+    }
+  vtkImageData* heatFlow = connector->GetOutput();
+
+  // Voxels with all corners defined. NaN fails any range test, and the
+  // range is wide enough for solution values rounded past 0 or 1.
+  vtkSmartPointer<vtkThreshold> threshold = vtkSmartPointer<vtkThreshold>::New();
+  threshold->SetInputData(heatFlow);
+  threshold->ThresholdBetween(-1.0, 2.0);
+  threshold->AllScalarsOn();
+  threshold->Update();
+
+  HeatFlowImageContourer contourer;
+  if (!contourer.SetInput(heatFlow))
+    {
+    std::cerr << "Could not contour the heat flow" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const double values[5] = { 0.1, 0.3, 0.5, 0.7, 0.9 };
+  int status = EXIT_SUCCESS;
+  for (int v = 0; v < 5; ++v)
+    {
+    vtkSmartPointer<vtkPolyData> contour = vtkSmartPointer<vtkPolyData>::New();
+    contourer.Contour(std::vector<double>(1, values[v]), contour);
+
+    vtkSmartPointer<vtkContourFilter> contourFilter = vtkSmartPointer<vtkContourFilter>::New();
+    contourFilter->SetInputConnection(threshold->GetOutputPort());
+    contourFilter->SetValue(0, values[v]);
+    contourFilter->Update();
+    vtkPolyData* reference = contourFilter->GetOutput();
+
+    double area = ComputeArea(contour);
+    double referenceArea = ComputeArea(reference);
+    std::cout << "Value " << values[v] << ": "
+              << contour->GetNumberOfPolys() << " triangles, "
+              << contour->GetNumberOfPoints() << " points, area " << area
+              << "; vtkContourFilter "
+              << reference->GetNumberOfPolys() << " triangles, "
+              << reference->GetNumberOfPoints() << " points, area " << referenceArea
+              << std::endl;
+
+    if (contour->GetNumberOfPolys() == 0 ||
+        contour->GetNumberOfPolys() != reference->GetNumberOfPolys() ||
+        contour->GetNumberOfPoints() != reference->GetNumberOfPoints() ||
+        std::abs(area - referenceArea) > AreaTolerance * referenceArea)
+      {
+      std::cerr << "The contour at " << values[v]
+                << " differs from that of vtkContourFilter" << std::endl;
+      status = EXIT_FAILURE;
+      }
+    }
+
+  return status;
+}
@@ -4,6 +4,7 @@
 
 #include "LBMNoseSphere.h"
 #include "ComputeLBMBoundariesCLP.h"
+#include "Profiler.h"
 
 #include <itkAutoCropImageFilter.h>
 #include <itkBinaryThresholdImageFilter.h>
@@ -59,6 +60,7 @@ int DoIt(int argc, char* argv[], T)
   inputReader->SetFileName( ctImage.c_str() );
   try
     {
+    ProfileTimer timer( "read CT image" );
     inputReader->Update();
     }
   catch ( itk::ExceptionObject & except )
@@ -72,6 +74,7 @@ int DoIt(int argc, char* argv[], T)
   labelReader->SetFileName( segmentationImage.c_str() );
   try
     {
+    ProfileTimer timer( "read segmentation" );
     labelReader->Update();
     }
   catch ( itk::ExceptionObject & except )
@@ -118,7 +121,12 @@ int DoIt(int argc, char* argv[], T)
   relabelThresholdFilter->SetLowerThreshold( 1 );
   relabelThresholdFilter->SetUpperThreshold( 1 );
   relabelThresholdFilter->SetInput( relabelComponentFilter->GetOutput() );
-  relabelThresholdFilter->UpdateLargestPossibleRegion();
+  {
+    ProfileTimer timer( "remove islands" );
+    relabelThresholdFilter->UpdateLargestPossibleRegion();
+  }
+  Profiler::GetInstance().SetCounter( "voxels",
+    labelReader->GetOutput()->GetLargestPossibleRegion().GetNumberOfPixels() );
 
   // Add the nose sphere to the segmentation
   double sphereCenter[3];
@@ -273,6 +281,8 @@ int DoIt(int argc, char* argv[], T)
   size = padFilter->GetOutput()->GetLargestPossibleRegion().GetSize();
 
   LabelImageType * paddedImage = padFilter->GetOutput();
+  Profiler::GetInstance().SetCounter( "output voxels",
+    paddedImage->GetLargestPossibleRegion().GetNumberOfPixels() );
 
   // Write the output
   typedef itk::ImageFileWriter< LabelImageType > OutputWriter;
@@ -292,6 +302,7 @@ int DoIt(int argc, char* argv[], T)
 
   try
     {
+    ProfileTimer timer( "write boundaries" );
     writer->Update();
     }
   catch ( itk::ExceptionObject & except )
@@ -311,6 +322,8 @@ int main( int argc, char* argv[] )
 {
   PARSE_ARGS;
 
+  ProfileSession profileSession( "ComputeLBMBoundaries", profile );
+
   itk::ImageIOBase::IOPixelType     pixelType;
   itk::ImageIOBase::IOComponentType componentType;
 
@@ -20,6 +20,7 @@
 
 #include "itkAirwayLaplaceSolutionFilter.h"
 #include "ComputeLaplaceSolutionCLP.h"
+#include "Profiler.h"
 
 // Use an anonymous namespace to keep class types and function names
 // from colliding when module is used as shared object module.  Every
@@ -94,6 +95,7 @@ int DoIt( int argc, char * argv[], T )
 
   // readers/writers
   typedef itk::ImageFileReader<InputImageType>  ReaderType;
+  typedef itk::ImageFileReader<OutputImageType> SolutionReaderType;
   typedef itk::ImageFileWriter<OutputImageType> WriterType;
 
   // define the boundary filter
@@ -120,10 +122,70 @@ int DoIt( int argc, char * argv[], T )
   // Setup the boundary method
   bound->SetInput(  reader->GetOutput() );
 
-  // Write the output
-  writer->SetInput( bound->GetOutput() );
-  writer->Update();
-  writer->Write();
+  // Start from a previous solution if one was given
+  typename SolutionReaderType::Pointer initialSolutionReader;
+  if ( !initialSolution.empty() )
+    {
+    initialSolutionReader = SolutionReaderType::New();
+    initialSolutionReader->SetFileName( initialSolution.c_str() );
+    bound->SetInitialSolution( initialSolutionReader->GetOutput() );
+    }
+
+  // Solver settings
+  if ( solver == "matrixfree" )
+    {
+    bound->SetSolver( AirwayFilterType::LaplaceSolverType::MATRIX_FREE_CONJUGATE_GRADIENT );
+    }
+  else if ( solver == "multigrid" )
+    {
+    bound->SetSolver( AirwayFilterType::LaplaceSolverType::MULTIGRID_CONJUGATE_GRADIENT );
+    }
+  else
+    {
+    bound->SetSolver( AirwayFilterType::LaplaceSolverType::ASSEMBLED_CONJUGATE_GRADIENT );
+    }
+  if ( tolerance > 0.0 )
+    {
+    bound->SetTolerance( tolerance );
+    }
+  if ( maximumIterations > 0 )
+    {
+    bound->SetMaximumNumberOfIterations( maximumIterations );
+    }
+
+  // Read the inputs, solve and write the output as separate stages
+  // so that each can be profiled
+  {
+    ProfileTimer timer( "read input" );
+    reader->Update();
+    if ( initialSolutionReader )
+      {
+      initialSolutionReader->Update();
+      }
+  }
+  {
+    ProfileTimer timer( "solve" );
+    bound->Update();
+  }
+  {
+    ProfileTimer timer( "write output" );
+    writer->SetInput( bound->GetOutput() );
+    writer->Update();
+    writer->Write();
+  }
+
+  Profiler & profiler = Profiler::GetInstance();
+  profiler.SetCounter( "voxels",
+    reader->GetOutput()->GetLargestPossibleRegion().GetNumberOfPixels() );
+  profiler.SetCounter( "unknowns", bound->GetNumberOfUnknowns() );
+  profiler.SetCounter( "iterations", bound->GetCurrentIteration() );
+  profiler.SetCounter( "setup time", bound->GetSetupTime() );
+  profiler.SetCounter( "solve time", bound->GetSolveTime() );
+
+  std::cout << "Laplace solver: " << bound->GetCurrentIteration() << " iterations, "
+            << "relative residual " << bound->GetCurrentResidual() << ", "
+            << "setup " << bound->GetSetupTime() << " s, "
+            << "solve " << bound->GetSolveTime() << " s" << std::endl;
 
   return EXIT_SUCCESS;
 
@@ -136,6 +198,8 @@ int main( int argc, char * argv[] )
   // DoIt(argc, argv);
   PARSE_ARGS;
 
+  ProfileSession profileSession( "ComputeLaplaceSolution", profile );
+
 
   itk::ImageIOBase::IOPixelType     pixelType;
   itk::ImageIOBase::IOComponentType componentType;
@@ -0,0 +1,264 @@
+// Tests of LaplaceEquationSolverImageFilter on the boundary conditions
+// of a synthetic airway.
+//
+// Usage: LaplaceEquationSolverTest <test>, where test is one of
+//   threads     - every solver gives the same solution with 1 and 4 threads
+//   matrixfree  - the matrix-free solution matches the assembled one
+//   multigrid   - the multigrid preconditioned solution matches the
+//                 Jacobi preconditioned one
+//   singular    - a singular coarsest multigrid operator throws
+
+// Local includes
+#include "AirwayPhantom.h"
+
+#include "itkAirwayLaplaceBoundaryImageFilter.h"
+#include "itkLaplaceEquationSolverImageFilter.h"
+#include "itkLaplaceMultigridPreconditioner.h"
+
+#include <itkImage.h>
+#include <itkImageRegionConstIterator.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+namespace
+{
+  typedef AirwayPhantom::ImageType                  LabelImageType;
+  typedef itk::Image<double, 3>                     SolutionImageType;
+
+  typedef itk::AirwayLaplaceBoundaryImageFilter<LabelImageType>                    BoundaryFilterType;
+  typedef itk::LaplaceEquationSolverImageFilter<LabelImageType, SolutionImageType> SolverFilterType;
+
+  // Relative residual at which the solves stop
+  const double SolverTolerance = 1e-12;
+
+  // Largest difference allowed between two solvers. The error of a
+  // solution is bounded by |A^-1| |b| times the tolerance, which is
+  // about 1e-8 on the 1 mm phantom.
+  const double SolutionTolerance = 1e-6;
+
+  /*******************************************************************/
+  /** Label the boundary conditions of the default phantom at the
+   *  given spacing. */
+  /*******************************************************************/
+  LabelImageType::Pointer CreateBoundaryImage(double spacing)
+  {
+    AirwayPhantom phantom;
+    phantom.SetSpacing(spacing);
+    phantom.Update();
+
+    BoundaryFilterType::Pointer boundaryFilter = BoundaryFilterType::New();
+    boundaryFilter->SetInput(phantom.GetLabelImage());
+    boundaryFilter->SetNasalPoint(phantom.GetNosePoint());
+    boundaryFilter->SetNasalVector(phantom.GetNoseVector());
+    boundaryFilter->SetTracheaPoint(phantom.GetTracheaPoint());
+    boundaryFilter->SetTracheaVector(phantom.GetTracheaVector());
+    boundaryFilter->Update();
+
+    LabelImageType::Pointer boundaries = boundaryFilter->GetOutput();
+    boundaries->DisconnectPipeline();
+    return boundaries;
+  }
+
+  /*******************************************************************/
+  /** Solve with the labels of AirwayLaplaceSolutionFilter. */
+  /*******************************************************************/
+  SolutionImageType::Pointer Solve(LabelImageType* boundaries,
+                                   SolverFilterType::SolverType solver,
+                                   itk::ThreadIdType numberOfThreads)
+  {
+    SolverFilterType::Pointer solverFilter = SolverFilterType::New();
+    solverFilter->SetInput(boundaries);
+    solverFilter->SetSolver(solver);
+    solverFilter->SetTolerance(SolverTolerance);
+    solverFilter->SetNumberOfThreads(numberOfThreads);
+    solverFilter->SetSolutionLabel(11);
+    solverFilter->SetNeumannBoundaryConditionLabel(6);
+    solverFilter->AddDirichletBoundaryCondition(4, 0.0);
+    solverFilter->AddDirichletBoundaryCondition(5, 1.0);
+    solverFilter->Update();
+
+    SolutionImageType::Pointer solution = solverFilter->GetOutput();
+    solution->DisconnectPipeline();
+    return solution;
+  }
+
+  /*******************************************************************/
+  /** Largest absolute difference between two solutions. Returns -1
+   *  if they are not defined on the same voxels. */
+  /*******************************************************************/
+  double MaximumDifference(const SolutionImageType* a, const SolutionImageType* b)
+  {
+    if (a->GetBufferedRegion() != b->GetBufferedRegion())
+      {
+      return -1.0;
+      }
+
+    typedef itk::ImageRegionConstIterator<SolutionImageType> IteratorType;
+    IteratorType aIt(a, a->GetBufferedRegion());
+    IteratorType bIt(b, b->GetBufferedRegion());
+
+    double maximum = 0.0;
+    for (; !aIt.IsAtEnd(); ++aIt, ++bIt)
+      {
+      double aValue = aIt.Get();
+      double bValue = bIt.Get();
+
+      // Both are NaN outside the solution domain
+      bool aDefined = aValue == aValue;
+      bool bDefined = bValue == bValue;
+      if (aDefined != bDefined)
+        {
+        return -1.0;
+        }
+      if (aDefined)
+        {
+        maximum = std::max(maximum, std::abs(aValue - bValue));
+        }
+      }
+
+    return maximum;
+  }
+
+  /*******************************************************************/
+  /** The dot products are summed per block in block order, so the
+   *  solutions must be identical. The phantom has more unknowns than
+   *  a block of LaplaceVectorKernels to run on several threads. */
+  /*******************************************************************/
+  int TestThreads()
+  {
+    LabelImageType::Pointer boundaries = CreateBoundaryImage(0.5);
+
+    const SolverFilterType::SolverType solvers[3] = {
+      SolverFilterType::ASSEMBLED_CONJUGATE_GRADIENT,
+      SolverFilterType::MATRIX_FREE_CONJUGATE_GRADIENT,
+      SolverFilterType::MULTIGRID_CONJUGATE_GRADIENT };
+    const char* solverNames[3] = { "assembled", "matrix-free", "multigrid" };
+
+    int status = EXIT_SUCCESS;
+    for (int s = 0; s < 3; ++s)
+      {
+      SolutionImageType::Pointer serial = Solve(boundaries, solvers[s], 1);
+      SolutionImageType::Pointer threaded = Solve(boundaries, solvers[s], 4);
+
+      double difference = MaximumDifference(serial, threaded);
+      std::cout << solverNames[s] << ": 1 and 4 threads differ by "
+                << difference << std::endl;
+      if (difference != 0.0)
+        {
+        std::cerr << "The " << solverNames[s]
+                  << " solution depends on the number of threads" << std::endl;
+        status = EXIT_FAILURE;
+        }
+      }
+
+    return status;
+  }
+
+  /*******************************************************************/
+  /** Compare the solutions of two solvers. */
+  /*******************************************************************/
+  int CompareSolvers(SolverFilterType::SolverType referenceSolver, const char* referenceName,
+                     SolverFilterType::SolverType solver, const char* solverName)
+  {
+    LabelImageType::Pointer boundaries = CreateBoundaryImage(1.0);
+
+    SolutionImageType::Pointer reference = Solve(boundaries, referenceSolver, 1);
+    SolutionImageType::Pointer solution = Solve(boundaries, solver, 1);
+
+    double difference = MaximumDifference(reference, solution);
+    std::cout << solverName << ": differs from the " << referenceName
+              << " solution by " << difference << std::endl;
+    if (difference < 0.0 || difference > SolutionTolerance)
+      {
+      std::cerr << "The " << solverName << " solution differs from the "
+                << referenceName << " one" << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    return EXIT_SUCCESS;
+  }
+
+  /*******************************************************************/
+  /** A single unknown enclosed by Neumann voxels has a zero row, so
+   *  the coarsest operator cannot be factored. */
+  /*******************************************************************/
+  int TestSingularCoarsestOperator()
+  {
+    typedef itk::LaplaceMultigridPreconditioner<double> PreconditionerType;
+    typedef PreconditionerType::OperatorType            OperatorType;
+
+    const double spacing[3] = { 1.0, 1.0, 1.0 };
+    const double inverseSpacingSquared[3] = { 1.0, 1.0, 1.0 };
+    const itk::SizeValueType gridSize[3] = { 3, 3, 3 };
+
+    OperatorType op;
+    op.Initialize(1, inverseSpacingSquared);
+    for (unsigned int n = 0; n < OperatorType::NumberOfNeighbors; ++n)
+      {
+      op.AddToDiagonal(0, inverseSpacingSquared[n / 2]);
+      }
+
+    // The center voxel of the grid
+    PreconditionerType::OffsetListType unknownOffsets(1, 13);
+    PreconditionerType::OffsetListType dirichletOffsets;
+
+    PreconditionerType preconditioner;
+    try
+      {
+      preconditioner.Compute(op, gridSize, spacing, unknownOffsets, dirichletOffsets);
+      }
+    catch (itk::ExceptionObject & e)
+      {
+      std::cout << "Caught expected exception: " << e.GetDescription() << std::endl;
+      return EXIT_SUCCESS;
+      }
+
+    std::cerr << "The singular coarsest operator was factored" << std::endl;
+    return EXIT_FAILURE;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+    {
+    std::cerr << "Usage: " << argv[0] << " threads|matrixfree|multigrid|singular"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::string test = argv[1];
+  try
+    {
+    if (test == "threads")
+      {
+      return TestThreads();
+      }
+    if (test == "matrixfree")
+      {
+      return CompareSolvers(SolverFilterType::ASSEMBLED_CONJUGATE_GRADIENT, "assembled",
+                            SolverFilterType::MATRIX_FREE_CONJUGATE_GRADIENT, "matrix-free");
+      }
+    if (test == "multigrid")
+      {
+      return CompareSolvers(SolverFilterType::MATRIX_FREE_CONJUGATE_GRADIENT, "Jacobi",
+                            SolverFilterType::MULTIGRID_CONJUGATE_GRADIENT, "multigrid");
+      }
+    if (test == "singular")
+      {
+      return TestSingularCoarsestOperator();
+      }
+    }
+  catch (itk::ExceptionObject & e)
+    {
+    std::cerr << e << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::cerr << "Unknown test '" << test << "'" << std::endl;
+  return EXIT_FAILURE;
+}
@@ -73,6 +73,8 @@ int main( int argc, char * argv[] )
 
   PARSE_ARGS;
 
+  ProfileSession profileSession( "ConvertDICOMToNRRD", profile );
+
   DICOMToNRRD::ProgramArguments args;
   args.dicomDir    = dicomDir;
   args.outputImage = outputImage;
@@ -21,6 +21,9 @@
 #include <algorithm>
 #include <cfloat>
 
+/* Local includes */
+#include "Profiler.h"
+
 /* ITK includes */
 #include <itkGDCMImageIO.h>
 #include <itkGDCMSeriesFileNames.h>
@@ -227,6 +230,8 @@ namespace DICOMToNRRD {
     nameGenerator->SetDirectory( args.dicomDir );
     try
       {
+      ProfileTimer timer( "read DICOM series" );
+
       typename ReaderType::Pointer singleReader = ReaderType::New();
       singleReader->SetFileName( firstFile.c_str() );
 
@@ -238,6 +243,7 @@ namespace DICOMToNRRD {
       typedef std::vector< std::string > FileNamesContainer;
       FileNamesContainer fileNames( nameGenerator->GetFileNames( seriesInstance ) );
       reader->SetFileNames( fileNames );
+      Profiler::GetInstance().SetCounter( "DICOM files", fileNames.size() );
 
       // Read the input file
       reader->Update();
@@ -251,12 +257,19 @@ namespace DICOMToNRRD {
 
     // Run the algorithm
     typename InputImageType::Pointer resampledInput;
-    int result = Execute( reader->GetOutput(), resampledInput );
+    int result;
+    {
+      ProfileTimer timer( "resample" );
+      result = Execute( reader->GetOutput(), resampledInput );
+    }
     if ( result != EXIT_SUCCESS ) {
       return result;
     }
+    Profiler::GetInstance().SetCounter( "voxels",
+      resampledInput->GetLargestPossibleRegion().GetNumberOfPixels() );
 
     // Write the result.
+    ProfileTimer timer( "write image" );
     typename WriterType::Pointer writer = WriterType::New();
     writer->SetInput( resampledInput );
     writer->SetFileName( args.outputImage );
@@ -3,11 +3,13 @@
 #endif
 
 #include "ConvertPolyDataToImageCLP.h"
+#include "Profiler.h"
 
 #include <itkImageFileReader.h>
 #include <itkImageFileWriter.h>
 #include <itkVTKImageToImageFilter.h>
 
+#include <vtkImageData.h>
 #include <vtkImageStencilToImage.h>
 #include <vtkPolyData.h>
 #include <vtkPolyDataToImageStencil.h>
@@ -102,6 +104,8 @@ int main( int argc, char* argv[] )
 {
   PARSE_ARGS;
 
+  ProfileSession profileSession( "ConvertPolyDataToImage", profile );
+
   itk::ImageIOBase::IOPixelType     pixelType;
   itk::ImageIOBase::IOComponentType componentType;
 
@@ -192,7 +196,12 @@ int main( int argc, char* argv[] )
     vtkSmartPointer<vtkTransformFilter>::New();
   transformedModel->SetTransform( RASToLPSTransform );
   transformedModel->SetInputConnection( modelReader->GetOutputPort() );
-  transformedModel->Update();
+  {
+    ProfileTimer timer( "read model" );
+    transformedModel->Update();
+  }
+  Profiler::GetInstance().SetCounter( "model cells",
+    transformedModel->GetOutput()->GetNumberOfCells() );
 
   double bounds[6];
   transformedModel->GetOutput()->GetBounds(bounds);
@@ -216,7 +225,12 @@ int main( int argc, char* argv[] )
   stencil->SetOutputScalarTypeToUnsignedChar();
   stencil->SetInsideValue( interiorValue );
   stencil->SetOutsideValue( exteriorValue );
-  stencil->Update();
+  {
+    ProfileTimer timer( "rasterize model" );
+    stencil->Update();
+  }
+  Profiler::GetInstance().SetCounter( "voxels",
+    stencil->GetOutput()->GetNumberOfPoints() );
 
   // Write the output
   typedef itk::Image< unsigned char, 3 >                OutputImageType;
@@ -231,6 +245,7 @@ int main( int argc, char* argv[] )
   writer->SetFileName( outputImage.c_str() );
   try
     {
+    ProfileTimer timer( "write image" );
     writer->Update();
     }
   catch ( itk::ExceptionObject & except )
@@ -18,6 +18,7 @@
 
 // Local includes
 #include "ExtractCrossSectionsCLP.h"
+#include "Profiler.h"
 
 #include <vtkAppendPolyData.h>
 #include <vtkCellArray.h>
@@ -54,14 +55,22 @@ int main( int argc, char* argv[] )
 {
   PARSE_ARGS;
 
+  ProfileSession profileSession( "ExtractCrossSections", profile );
+  Profiler & profiler = Profiler::GetInstance();
+
   int returnValue = EXIT_SUCCESS;
 
   vtkSmartPointer<vtkXMLPolyDataReader> crossSectionsReader =
     vtkSmartPointer<vtkXMLPolyDataReader>::New();
   crossSectionsReader->SetFileName( crossSections.c_str() );
-  crossSectionsReader->Update();
+  {
+    ProfileTimer timer( "read cross sections" );
+    crossSectionsReader->Update();
+  }
 
   vtkPolyData* crossSectionsPD = crossSectionsReader->GetOutput();
+  profiler.SetCounter( "cross section cells", crossSectionsPD->GetNumberOfCells() );
+  profiler.SetCounter( "query points", queryPoints.size() );
 
   vtkFieldData* inputFieldData = crossSectionsPD->GetFieldData();
 
@@ -97,7 +106,10 @@ int main( int argc, char* argv[] )
   vtkSmartPointer<vtkCellLocator> cellLocator =
     vtkSmartPointer<vtkCellLocator>::New();
   cellLocator->SetDataSet( crossSectionsPD );
-  cellLocator->BuildLocator();
+  {
+    ProfileTimer timer( "build cell locator" );
+    cellLocator->BuildLocator();
+  }
 
   // Field data containing meta data about the cross sections. One
   // entry for each cross-section is stored for each of the arrays
@@ -134,6 +146,7 @@ int main( int argc, char* argv[] )
   vtkSmartPointer<vtkAppendPolyData> appender =
     vtkSmartPointer<vtkAppendPolyData>::New();
 
+  profiler.BeginStage( "extract cross sections" );
   for ( size_t inputPtID = 0; inputPtID < queryPoints.size(); ++inputPtID )
     {
     double queryPoint[3], closestPoint[3];
@@ -209,6 +222,10 @@ int main( int argc, char* argv[] )
     }
 
   appender->Update();
+  profiler.EndStage();
+  profiler.SetCounter( "extracted cross sections", queryPtIDInfo->GetNumberOfTuples() );
+
+  ProfileTimer writeTimer( "write cross sections" );
   vtkSmartPointer<vtkPointSet> outputCopy;
   outputCopy.TakeReference( appender->GetOutput()->NewInstance() );
   outputCopy->ShallowCopy( appender->GetOutput() );
@@ -16,6 +16,16 @@ namespace itk
  * \brief Labels the boundary of an airway with the boundary
  *        conditions for the Laplace equation.
  *
+ * Airway voxels (value 1) below the nasal or tracheal plane, in a box
+ * reaching 20 mm from the plane's point, are cut off. The remaining airway voxels
+ * are labeled as interior. Zero voxels that share a face with an
+ * airway voxel are labeled as Neumann boundary, or as nostril or
+ * trachea boundary if they lie below the respective plane.
+ *
+ * All labels are computed in a single pass over scanlines without
+ * intermediate images. The plane tests are evaluated incrementally
+ * along each scanline.
+ *
  * Authors: Schuyler Kylstra. */
 template< typename TInputImage >
 class AirwayLaplaceBoundaryImageFilter: public ImageToImageFilter< TInputImage, TInputImage >
@@ -48,11 +58,14 @@ public:
   itkSetMacro( TracheaVector, PointType );
   itkGetMacro( TracheaVector, PointType );
 
-  typedef          TInputImage            InputImageType;
-  typedef typename TInputImage::PixelType InputPixelType;
-  typedef typename TInputImage::IndexType InputIndexType;
-  typedef typename TInputImage::PixelType OutputPixelType;
-  typedef typename TInputImage::IndexType OutputIndexType;
+  typedef          TInputImage             InputImageType;
+  typedef typename TInputImage::PixelType  InputPixelType;
+  typedef typename TInputImage::IndexType  InputIndexType;
+  typedef typename TInputImage::RegionType InputRegionType;
+  typedef typename TInputImage::PixelType  OutputPixelType;
+  typedef typename TInputImage::IndexType  OutputIndexType;
+
+  typedef typename Superclass::OutputImageRegionType OutputImageRegionType;
 
 
   /** Set/get the voxels that are part of the interior of the airway */
@@ -79,10 +92,15 @@ protected:
   AirwayLaplaceBoundaryImageFilter();
   virtual ~AirwayLaplaceBoundaryImageFilter() {}
 
-  /**
-   * Standard pipeline method.
-   */
-  void GenerateData();
+  /** Requests one extra voxel around the output region for the
+   *  neighbor tests. */
+  void GenerateInputRequestedRegion();
+
+  /** Sets up the regions and plane equations of the cuts. */
+  void BeforeThreadedGenerateData();
+
+  void ThreadedGenerateData( const OutputImageRegionType & outputRegionForThread,
+                             ThreadIdType threadId );
 
 private:
   AirwayLaplaceBoundaryImageFilter(const Self &); //purposely not implemented
@@ -95,6 +113,29 @@ private:
   PointType m_NasalPoint, m_NasalVector;
   PointType m_TracheaPoint, m_TracheaVector;
 
+  /** Voxels the nostril and carina cuts apply to, the plane offsets d
+   *  in n . x + d = 0 and the change of n . x + d per voxel along a
+   *  scanline. */
+  InputRegionType m_NostrilRegion, m_CarinaRegion;
+  double          m_NostrilD, m_CarinaD;
+  double          m_NostrilStep, m_CarinaStep;
+
+  /** Copy a scanline of the input and apply both cuts to it. If labels
+   *  is given, it receives the label each voxel gets if it is on the
+   *  boundary. */
+  void EvaluateLine( const InputImageType * input, const InputIndexType & start,
+                     SizeValueType length, InputPixelType * values,
+                     InputPixelType * labels ) const;
+
+  /** Zero the voxels of a scanline that lie in region and below the
+   *  plane. If labels is given, these voxels are labeled with
+   *  belowLabel and the other voxels in region as Neumann boundary. */
+  void CutLine( const InputImageType * input, const InputRegionType & region,
+                const PointType & normal, double d, double step,
+                const InputIndexType & start, SizeValueType length,
+                InputPixelType * values, InputPixelType * labels,
+                InputPixelType belowLabel ) const;
+
   void DefineBoundary();
 };
 } // end namespace itk
@@ -2,11 +2,9 @@
 #define itkAirwayLaplaceBoundaryImageFilter_hxx_included
 
 #include "itkAirwayLaplaceBoundaryImageFilter.h"
-#include "itkImageRegionIteratorWithIndex.h"
-#include <itkInvertIntensityImageFilter.h>
-#include <itkBinaryContourImageFilter.h>
-#include "itkImageDuplicator.h"
-#include "itkVector.h"
+#include <itkImageLinearIteratorWithIndex.h>
+#include <itkProgressReporter.h>
+#include <algorithm>
 #include <cmath>
 
 namespace itk
@@ -20,33 +18,41 @@ AirwayLaplaceBoundaryImageFilter< TInputImage >
   m_NostrilBoundaryConditionLabel         = 4;
   m_TracheaBoundaryConditionLabel         = 5;
   m_NeumannBoundaryConditionLabel         = 6;
+
+  m_NostrilD = m_CarinaD = 0.0;
+  m_NostrilStep = m_CarinaStep = 0.0;
 }
 
 
 template< typename TInputImage>
 void
 AirwayLaplaceBoundaryImageFilter< TInputImage>
-::GenerateData()
+::GenerateInputRequestedRegion()
 {
+  Superclass::GenerateInputRequestedRegion();
 
-  typename InputImageType::ConstPointer  input  = this->GetInput();
-  typename InputImageType::Pointer       output = this->GetOutput();
+  InputImageType * input = const_cast< InputImageType * >( this->GetInput() );
+  if ( !input )
+    {
+    return;
+    }
 
-  this->AllocateOutputs();
-  output->FillBuffer( 0 );
+  InputRegionType requestedRegion = input->GetRequestedRegion();
+  requestedRegion.PadByRadius( 1 );
+  requestedRegion.Crop( input->GetLargestPossibleRegion() );
+  input->SetRequestedRegion( requestedRegion );
+}
 
-  // Copy the Input to the intermediate
-  typedef itk::ImageDuplicator< InputImageType > DuplicatorType;
-  typename DuplicatorType::Pointer duplicator = DuplicatorType::New();
-  duplicator->SetInputImage( input ); //->GetPointer() );
-  duplicator->Update();
-  typename InputImageType::Pointer airway  = duplicator->GetOutput();
 
-  // Cut off the nostrils and the trachea carina
-  typedef itk::ImageRegionIteratorWithIndex< InputImageType > ImageIterator;
+template< typename TInputImage>
+void
+AirwayLaplaceBoundaryImageFilter< TInputImage>
+::BeforeThreadedGenerateData()
+{
+  const InputImageType * input = this->GetInput();
 
-  // Iterate within a region near the nostrils to avoid cutting off
-  // other parts of the airway.
+  // Only cut within a region near the nostrils and the carina to
+  // avoid cutting off other parts of the airway.
   typename InputImageType::PointType nostrilLowPoint, nostrilHighPoint;
   typename InputImageType::PointType carinaLowPoint, carinaHighPoint;
   double regionRadius = 20.0;
@@ -58,155 +64,226 @@ AirwayLaplaceBoundaryImageFilter< TInputImage>
     carinaHighPoint[i]  = m_TracheaPoint[i] + regionRadius;
     }
 
-  typename InputImageType::IndexType nostrilLowIndex, nostrilHighIndex;
-  airway->TransformPhysicalPointToIndex( nostrilLowPoint, nostrilLowIndex );
-  airway->TransformPhysicalPointToIndex( nostrilHighPoint, nostrilHighIndex );
+  InputIndexType nostrilLowIndex, nostrilHighIndex;
+  input->TransformPhysicalPointToIndex( nostrilLowPoint, nostrilLowIndex );
+  input->TransformPhysicalPointToIndex( nostrilHighPoint, nostrilHighIndex );
 
-  typename InputImageType::IndexType carinaLowIndex, carinaHighIndex;
-  airway->TransformPhysicalPointToIndex( carinaLowPoint, carinaLowIndex );
-  airway->TransformPhysicalPointToIndex( carinaHighPoint, carinaHighIndex );
+  InputIndexType carinaLowIndex, carinaHighIndex;
+  input->TransformPhysicalPointToIndex( carinaLowPoint, carinaLowIndex );
+  input->TransformPhysicalPointToIndex( carinaHighPoint, carinaHighIndex );
 
-  typename InputImageType::RegionType nostrilRegion;
-  nostrilRegion.SetIndex( nostrilLowIndex );
-  nostrilRegion.SetUpperIndex( nostrilHighIndex );
-  nostrilRegion.Crop( airway->GetLargestPossibleRegion() );
+  m_NostrilRegion.SetIndex( nostrilLowIndex );
+  m_NostrilRegion.SetUpperIndex( nostrilHighIndex );
+  m_NostrilRegion.Crop( input->GetLargestPossibleRegion() );
 
-  typename InputImageType::RegionType carinaRegion;
-  carinaRegion.SetIndex( carinaLowIndex );
-  carinaRegion.SetUpperIndex( carinaHighIndex );
-  carinaRegion.Crop( airway->GetLargestPossibleRegion() );
+  m_CarinaRegion.SetIndex( carinaLowIndex );
+  m_CarinaRegion.SetUpperIndex( carinaHighIndex );
+  m_CarinaRegion.Crop( input->GetLargestPossibleRegion() );
 
   // Compute d in equation ax + by + cz + d = 0
-  double nostrilD = 0.0;
-  double carinaD = 0.0;
+  m_NostrilD = 0.0;
+  m_CarinaD = 0.0;
   for ( unsigned int i = 0; i < InputImageType::ImageDimension; ++i )
     {
-    nostrilD -= m_NasalVector[i]   * m_NasalPoint[i];
-    carinaD  -= m_TracheaVector[i] * m_TracheaPoint[i];
+    m_NostrilD -= m_NasalVector[i]   * m_NasalPoint[i];
+    m_CarinaD  -= m_TracheaVector[i] * m_TracheaPoint[i];
     }
 
-  ImageIterator nostrilIt( airway, nostrilRegion );
-  for ( nostrilIt.GoToBegin(); !nostrilIt.IsAtEnd(); ++nostrilIt )
+  // Physical step between neighboring voxels of a scanline
+  InputIndexType index = input->GetLargestPossibleRegion().GetIndex();
+  PointType point, nextPoint;
+  input->TransformIndexToPhysicalPoint( index, point );
+  ++index[0];
+  input->TransformIndexToPhysicalPoint( index, nextPoint );
+
+  m_NostrilStep = 0.0;
+  m_CarinaStep = 0.0;
+  for ( unsigned int i = 0; i < InputImageType::ImageDimension; ++i )
     {
-    typename InputImageType::PointType inputPoint;
-    airway->TransformIndexToPhysicalPoint( nostrilIt.GetIndex(), inputPoint );
+    m_NostrilStep += m_NasalVector[i]   * ( nextPoint[i] - point[i] );
+    m_CarinaStep  += m_TracheaVector[i] * ( nextPoint[i] - point[i] );
+    }
+}
 
-    double nostrilDotProduct = 0.0;
-    for ( unsigned int i = 0; i < InputImageType::ImageDimension; ++i )
-      {
-      nostrilDotProduct += m_NasalVector[i] * inputPoint[i];
-      }
 
-    // Apply plane equation test
-    if ( nostrilDotProduct + nostrilD  < 0 )
+template< typename TInputImage>
+void
+AirwayLaplaceBoundaryImageFilter< TInputImage>
+::CutLine( const InputImageType * input, const InputRegionType & region,
+           const PointType & normal, double d, double step,
+           const InputIndexType & start, SizeValueType length,
+           InputPixelType * values, InputPixelType * labels,
+           InputPixelType belowLabel ) const
+{
+  const InputIndexType & regionIndex = region.GetIndex();
+  const typename InputRegionType::SizeType & regionSize = region.GetSize();
+  for ( unsigned int i = 1; i < InputImageType::ImageDimension; ++i )
+    {
+    if ( start[i] < regionIndex[i] ||
+         start[i] >= regionIndex[i] + static_cast< IndexValueType >( regionSize[i] ) )
       {
-      nostrilIt.Set( 0 );
+      return;
       }
     }
 
-  ImageIterator carinaIt( airway, carinaRegion );
-  for ( carinaIt.GoToBegin(); !carinaIt.IsAtEnd(); ++carinaIt )
+  const IndexValueType begin = std::max( start[0], regionIndex[0] );
+  const IndexValueType end =
+    std::min( start[0] + static_cast< IndexValueType >( length ),
+              regionIndex[0] + static_cast< IndexValueType >( regionSize[0] ) );
+  if ( begin >= end )
     {
-    typename InputImageType::PointType inputPoint;
-    airway->TransformIndexToPhysicalPoint( carinaIt.GetIndex(), inputPoint );
+    return;
+    }
 
-    double carinaDotProduct = 0.0;
-    for ( unsigned int i = 0; i < InputImageType::ImageDimension; ++i )
-      {
-      carinaDotProduct += m_TracheaVector[i] * inputPoint[i];
-      }
+  InputIndexType index = start;
+  index[0] = begin;
+  PointType point;
+  input->TransformIndexToPhysicalPoint( index, point );
 
-    // Apply plane equation test
-    if ( carinaDotProduct + carinaD  < 0 )
-      {
-      carinaIt.Set( 0 );
-      }
+  double distance = d;
+  for ( unsigned int i = 0; i < InputImageType::ImageDimension; ++i )
+    {
+    distance += normal[i] * point[i];
     }
 
-  // find the boundary
-  typedef itk::BinaryContourImageFilter < InputImageType, InputImageType > ContourFilter;
-  typename ContourFilter::Pointer contourFilter =  ContourFilter::New();
-  contourFilter->SetInput( airway );
-  contourFilter->SetForegroundValue( 0 );
-  contourFilter->SetBackgroundValue( 1 );
-  contourFilter->Update();
-
-  // Invert intensity
-  typedef itk::InvertIntensityImageFilter < InputImageType, InputImageType > InvertFilter;
-  typename InvertFilter::Pointer invertFilter = InvertFilter::New();
-  invertFilter->SetInput( contourFilter->GetOutput() );
-  invertFilter->SetMaximum(1);
-  invertFilter->Update();
-
-  typename InputImageType::Pointer airwayBoundary = invertFilter->GetOutput();
-
-  // Final classification
-  ImageIterator airwayIt( airway,
-                          airway->GetLargestPossibleRegion() );
-  ImageIterator boundaryIt( airwayBoundary,
-                            airwayBoundary->GetLargestPossibleRegion() );
-  ImageIterator outputIt( output,
-                          output->GetLargestPossibleRegion() );
-  while ( !airwayIt.IsAtEnd() &&
-          !boundaryIt.IsAtEnd() &&
-          !outputIt.IsAtEnd() )
+  for ( IndexValueType x = begin; x < end; ++x, distance += step )
     {
-    if ( airwayIt.Get() == 1 )
+    const SizeValueType k = static_cast< SizeValueType >( x - start[0] );
+    const bool below = distance < 0;
+    if ( below )
       {
-      outputIt.Set( m_InteriorAirwayBoundaryConditionLabel );
+      values[k] = 0;
       }
-    else if ( boundaryIt.Get() == 1 )
+    if ( labels )
       {
-      typename InputImageType::PointType inputPoint;
-      airway->TransformIndexToPhysicalPoint( airwayIt.GetIndex(),
-                                             inputPoint );
+      labels[k] = below ? belowLabel : m_NeumannBoundaryConditionLabel;
+      }
+    }
+}
 
-      // Set as Neumann boundary condition by default
-      outputIt.Set( m_NeumannBoundaryConditionLabel );
 
-      // But check to see if voxel should be Dirichlet boundary condition
-      if ( nostrilRegion.IsInside( airwayIt.GetIndex() ) )
-        {
-        // Do dot product test again. Voxels above the plane on the
-        // boundary should be marked with the nostril boundary
-        // condition.
-        double nostrilDotProduct = 0.0;
-        for ( unsigned int i = 0; i < InputImageType::ImageDimension; ++i )
-          {
-          nostrilDotProduct += m_NasalVector[i] * inputPoint[i];
-          }
+template< typename TInputImage>
+void
+AirwayLaplaceBoundaryImageFilter< TInputImage>
+::EvaluateLine( const InputImageType * input, const InputIndexType & start,
+                SizeValueType length, InputPixelType * values,
+                InputPixelType * labels ) const
+{
+  const InputPixelType * buffer = input->GetBufferPointer() + input->ComputeOffset( start );
+  std::copy( buffer, buffer + length, values );
 
-        if ( nostrilDotProduct + nostrilD  < 0 )
-          {
-          outputIt.Set( m_NostrilBoundaryConditionLabel );
-          }
-        }
-      else if ( carinaRegion.IsInside( airwayIt.GetIndex() ) )
+  if ( labels )
+    {
+    std::fill( labels, labels + length, m_NeumannBoundaryConditionLabel );
+    }
+
+  // Boundary voxels in the nostril region are labeled by the nostril
+  // plane alone, so that cut goes last.
+  this->CutLine( input, m_CarinaRegion, m_TracheaVector, m_CarinaD, m_CarinaStep,
+                 start, length, values, labels, m_TracheaBoundaryConditionLabel );
+  this->CutLine( input, m_NostrilRegion, m_NasalVector, m_NostrilD, m_NostrilStep,
+                 start, length, values, labels, m_NostrilBoundaryConditionLabel );
+}
+
+
+template< typename TInputImage>
+void
+AirwayLaplaceBoundaryImageFilter< TInputImage>
+::ThreadedGenerateData( const OutputImageRegionType & outputRegionForThread,
+                        ThreadIdType threadId )
+{
+  const InputImageType * input  = this->GetInput();
+  InputImageType *       output = this->GetOutput();
+
+  const InputRegionType & bufferedRegion = input->GetBufferedRegion();
+  const IndexValueType bufferBegin = bufferedRegion.GetIndex()[0];
+  const IndexValueType bufferEnd =
+    bufferBegin + static_cast< IndexValueType >( bufferedRegion.GetSize()[0] );
+
+  const SizeValueType length = outputRegionForThread.GetSize()[0];
+  if ( length == 0 )
+    {
+    return;
+    }
+
+  // The scanline with up to one voxel on either side, the labels of
+  // its voxels, one neighboring scanline, and whether each voxel of
+  // the scanline has an airway voxel as face neighbor.
+  std::vector< InputPixelType > line( length + 2 );
+  std::vector< InputPixelType > labels( length + 2 );
+  std::vector< InputPixelType > neighborLine( length );
+  std::vector< unsigned char >  nextToAirway( length );
+
+  ProgressReporter progress( this, threadId,
+                             outputRegionForThread.GetNumberOfPixels() / length );
+
+  typedef ImageLinearIteratorWithIndex< InputImageType > IteratorType;
+  IteratorType outputIt( output, outputRegionForThread );
+  outputIt.SetDirection( 0 );
+
+  for ( outputIt.GoToBegin(); !outputIt.IsAtEnd(); outputIt.NextLine() )
+    {
+    const InputIndexType lineStart = outputIt.GetIndex();
+
+    InputIndexType extendedStart = lineStart;
+    extendedStart[0] = std::max( lineStart[0] - 1, bufferBegin );
+    const IndexValueType extendedEnd =
+      std::min( lineStart[0] + static_cast< IndexValueType >( length ) + 1, bufferEnd );
+    const SizeValueType extendedLength =
+      static_cast< SizeValueType >( extendedEnd - extendedStart[0] );
+    const SizeValueType first =
+      static_cast< SizeValueType >( lineStart[0] - extendedStart[0] );
+
+    this->EvaluateLine( input, extendedStart, extendedLength, &line[0], &labels[0] );
+
+    for ( SizeValueType i = 0; i < length; ++i )
+      {
+      const SizeValueType k = first + i;
+      nextToAirway[i] = ( k > 0 && line[k - 1] != 0 ) ||
+                        ( k + 1 < extendedLength && line[k + 1] != 0 );
+      }
+
+    for ( unsigned int dim = 1; dim < InputImageType::ImageDimension; ++dim )
+      {
+      for ( int side = -1; side <= 1; side += 2 )
         {
-        // Do dot product test again. Voxels above the plane on the
-        // boundary should be marked with the carina boundary
-        // condition.
-        double carinaDotProduct = 0.0;
-        for ( unsigned int i = 0; i < InputImageType::ImageDimension; ++i )
+        InputIndexType neighborStart = lineStart;
+        neighborStart[dim] += side;
+        if ( !bufferedRegion.IsInside( neighborStart ) )
           {
-          carinaDotProduct += m_TracheaVector[i] * inputPoint[i];
+          continue;
           }
 
-        if ( carinaDotProduct + carinaD  < 0 )
+        this->EvaluateLine( input, neighborStart, length, &neighborLine[0], 0 );
+        for ( SizeValueType i = 0; i < length; ++i )
           {
-          outputIt.Set( m_TracheaBoundaryConditionLabel );
+          if ( neighborLine[i] != 0 )
+            {
+            nextToAirway[i] = 1;
+            }
           }
         }
       }
-    else
+
+    for ( SizeValueType i = 0; !outputIt.IsAtEndOfLine(); ++i, ++outputIt )
       {
-      // Exterior
-      outputIt.Set( 0 );
+      const InputPixelType value = line[first + i];
+      if ( value == 1 )
+        {
+        outputIt.Set( m_InteriorAirwayBoundaryConditionLabel );
+        }
+      else if ( value == 0 && nextToAirway[i] )
+        {
+        outputIt.Set( labels[first + i] );
+        }
+      else
+        {
+        // Exterior
+        outputIt.Set( 0 );
+        }
       }
 
-    ++airwayIt;
-    ++boundaryIt;
-    ++outputIt;
+    progress.CompletedPixel();
     }
 }
 
@@ -57,6 +57,45 @@ public:
   typedef typename TOutputImage::PixelType  OutputPixelType;
   typedef typename TOutputImage::IndexType  OutputIndexType;
 
+  typedef LaplaceEquationSolverImageFilter< TInputImage, TOutputImage > LaplaceSolverType;
+  typedef typename LaplaceSolverType::SolverType                      SolverType;
+
+  /** Settings passed on to the Laplace solver. See
+   *  LaplaceEquationSolverImageFilter. */
+  itkSetMacro( Solver, SolverType );
+  itkGetConstMacro( Solver, SolverType );
+
+  itkSetMacro( Tolerance, double );
+  itkGetConstMacro( Tolerance, double );
+
+  itkSetMacro( MaximumNumberOfIterations, SizeValueType );
+  itkGetConstMacro( MaximumNumberOfIterations, SizeValueType );
+
+  /** Convergence of the Laplace solver. Updated before every
+   *  IterationEvent this filter invokes while the solver runs. */
+  itkGetConstMacro( CurrentIteration, SizeValueType );
+  itkGetConstMacro( CurrentResidual, double );
+
+  /** Number of unknowns of the Laplace solver, i.e., airway voxels. */
+  itkGetConstMacro( NumberOfUnknowns, SizeValueType );
+
+  /** Setup and solve times of the Laplace solver in seconds. */
+  itkGetConstMacro( SetupTime, double );
+  itkGetConstMacro( SolveTime, double );
+
+  /** Set/get whether the work is restricted to the bounding box of
+   *  the non-zero input voxels, padded by one voxel. The output
+   *  outside the box is NaN, as it is for every voxel outside the
+   *  airway. Defaults to on. */
+  itkSetMacro( AutoCrop, bool );
+  itkGetConstMacro( AutoCrop, bool );
+  itkBooleanMacro( AutoCrop );
+
+  /** Set/get an optional initial guess for the Laplace solution,
+   *  e.g., the output of a previous run. See
+   *  LaplaceEquationSolverImageFilter::SetInitialSolution(). */
+  void SetInitialSolution( const TOutputImage * image );
+  const TOutputImage * GetInitialSolution() const;
 
 protected:
   AirwayLaplaceSolutionFilter();
@@ -74,6 +113,22 @@ private:
   PointType m_NosePoint, m_NoseVector;
   PointType m_TrachPoint, m_TrachVector;
 
+  bool          m_AutoCrop;
+
+  SolverType    m_Solver;
+  double        m_Tolerance;
+  SizeValueType m_MaximumNumberOfIterations;
+
+  SizeValueType m_CurrentIteration;
+  double        m_CurrentResidual;
+  SizeValueType m_NumberOfUnknowns;
+  double        m_SetupTime;
+  double        m_SolveTime;
+
+  /** Copies the solver state and invokes IterationEvent on this
+   *  filter. */
+  void ForwardIterationEvent( Object * caller, const EventObject & event );
+
   void DefineBoundary();
 };
 
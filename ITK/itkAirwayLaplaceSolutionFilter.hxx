@@ -3,17 +3,19 @@
 
 #include "itkAirwayLaplaceSolutionFilter.h"
 #include "itkAirwayLaplaceBoundaryImageFilter.h"
+#include "itkAutoCropImageFilter.h"
+#include <itkExtractImageFilter.h>
+#include <itkImageAlgorithm.h>
 #include <itkBinaryThresholdImageFilter.h>
 #include <itkConnectedComponentImageFilter.h>
 #include "itkLaplaceEquationSolverImageFilter.h"
 #include <itkRelabelComponentImageFilter.h>
-#include "itkImageRegionIteratorWithIndex.h"
-#include <itkInvertIntensityImageFilter.h>
-#include <itkBinaryContourImageFilter.h>
-#include "itkImageDuplicator.h"
 #include "itkVector.h"
+#include <itkCommand.h>
+#include <itkProgressAccumulator.h>
 #include <stdio.h>
 #include <math.h>
+#include <limits>
 
 // TEMPORARY
 #include <itkImageFileWriter.h>
@@ -25,7 +27,43 @@ template< typename TInputImage, typename TOutputImage >
 AirwayLaplaceSolutionFilter< TInputImage, TOutputImage >
 ::AirwayLaplaceSolutionFilter()
 {
+  m_AutoCrop = true;
+  m_Solver = LaplaceSolverType::ASSEMBLED_CONJUGATE_GRADIENT;
+  m_Tolerance = Eigen::NumTraits< typename TOutputImage::PixelType >::epsilon();
+  m_MaximumNumberOfIterations = 0;
+  m_CurrentIteration = 0;
+  m_CurrentResidual = 0.0;
+  m_NumberOfUnknowns = 0;
+  m_SetupTime = 0.0;
+  m_SolveTime = 0.0;
+}
 
+template< typename TInputImage, typename TOutputImage >
+void
+AirwayLaplaceSolutionFilter< TInputImage, TOutputImage >
+::ForwardIterationEvent( Object * caller, const EventObject & event )
+{
+  const LaplaceSolverType * solver = static_cast< const LaplaceSolverType * >( caller );
+  m_CurrentIteration = solver->GetCurrentIteration();
+  m_CurrentResidual = solver->GetCurrentResidual();
+  this->InvokeEvent( event );
+}
+
+
+template< typename TInputImage, typename TOutputImage >
+void
+AirwayLaplaceSolutionFilter< TInputImage, TOutputImage >
+::SetInitialSolution( const TOutputImage * image )
+{
+  this->SetNthInput( 1, const_cast< TOutputImage * >( image ) );
+}
+
+template< typename TInputImage, typename TOutputImage >
+const TOutputImage *
+AirwayLaplaceSolutionFilter< TInputImage, TOutputImage >
+::GetInitialSolution() const
+{
+  return static_cast< const TOutputImage * >( this->ProcessObject::GetInput( 1 ) );
 }
 
 
@@ -39,17 +77,42 @@ AirwayLaplaceSolutionFilter< TInputImage, TOutputImage >
   typename TInputImage::ConstPointer  input  = this->GetInput();
   typename TOutputImage::Pointer      output = this->GetOutput();
 
-  this->AllocateOutputs();
-  output->FillBuffer( 0 );
+  // The airway fills only a small part of the image. Crop to the
+  // foreground with a one voxel margin so that the boundary voxels
+  // around the airway are kept, and run the whole pipeline there.
+  // Both filters keep the image indices, so the solution can be
+  // pasted back into the output at the same region.
+  //
+  // Intermediate images are released as soon as the next filter of
+  // the mini-pipeline has consumed them.
+  typedef itk::AutoCropImageFilter< TInputImage, TInputImage > CropFilterType;
+  typename CropFilterType::Pointer cropFilter = CropFilterType::New();
+  typename TInputImage::ConstPointer airwayInput = input;
+  if ( m_AutoCrop )
+    {
+    typename TInputImage::SizeType padRadius;
+    padRadius.Fill( 1 );
+    cropFilter->ReleaseDataFlagOn();
+    cropFilter->SetInput( input );
+    cropFilter->SetBackgroundValue( NumericTraits< InputPixelType >::Zero );
+    cropFilter->SetPadRadius( padRadius );
+    cropFilter->Update();
+    airwayInput = cropFilter->GetOutput();
+
+    itkDebugMacro( << "Cropped to " << airwayInput->GetLargestPossibleRegion().GetSize()
+                   << " of " << input->GetLargestPossibleRegion().GetSize() << " voxels" );
+    }
 
   // Extract largest connected component from binary image. If we don't
   // do this, the Laplace solution will be undefined (maybe).
   typedef itk::ConnectedComponentImageFilter< TInputImage, TInputImage, TInputImage > ConnectedFilterType;
   typename ConnectedFilterType::Pointer connectedFilter = ConnectedFilterType::New();
-  connectedFilter->SetInput( input );
+  connectedFilter->ReleaseDataFlagOn();
+  connectedFilter->SetInput( airwayInput );
 
   typedef itk::RelabelComponentImageFilter< TInputImage, TInputImage > RelabelFilterType;
   typename RelabelFilterType::Pointer relabelFilter = RelabelFilterType::New();
+  relabelFilter->ReleaseDataFlagOn();
   relabelFilter->SetInput( connectedFilter->GetOutput() );
 
   typedef itk::BinaryThresholdImageFilter< TInputImage, TInputImage > ThresholdType;
@@ -58,6 +121,7 @@ AirwayLaplaceSolutionFilter< TInputImage, TOutputImage >
   thresholdFilter->SetOutsideValue( 0 );
   thresholdFilter->SetLowerThreshold( 1 );
   thresholdFilter->SetUpperThreshold( 1 );
+  thresholdFilter->ReleaseDataFlagOn();
   thresholdFilter->SetInput( relabelFilter->GetOutput() );
 
   // Identify Boundary
@@ -68,27 +132,78 @@ AirwayLaplaceSolutionFilter< TInputImage, TOutputImage >
   boundaryFilter->SetNasalVector(   m_NoseVector  );
   boundaryFilter->SetTracheaPoint(  m_TrachPoint  );
   boundaryFilter->SetTracheaVector( m_TrachVector );
-  boundaryFilter->Update();
+  boundaryFilter->ReleaseDataFlagOn();
 
   // // Solve Laplace Equation
-  typedef itk::LaplaceEquationSolverImageFilter< TInputImage, TOutputImage > LaplaceFilterType;
+  typedef LaplaceSolverType LaplaceFilterType;
   typename LaplaceFilterType::Pointer heatFlowFilter = LaplaceFilterType::New();
+  heatFlowFilter->SetSolver( m_Solver );
+  heatFlowFilter->SetTolerance( m_Tolerance );
+  heatFlowFilter->SetMaximumNumberOfIterations( m_MaximumNumberOfIterations );
   heatFlowFilter->SetSolutionLabel( 11 );
   heatFlowFilter->SetNeumannBoundaryConditionLabel( 6      );
   heatFlowFilter->AddDirichletBoundaryCondition(    4, 0.0 );
   heatFlowFilter->AddDirichletBoundaryCondition(    5, 1.0 );
   heatFlowFilter->SetInput( boundaryFilter->GetOutput()    );
+  typedef itk::ExtractImageFilter< TOutputImage, TOutputImage > SolutionExtractType;
+  typename SolutionExtractType::Pointer initialSolutionExtract = SolutionExtractType::New();
+  if ( this->GetInitialSolution() )
+    {
+    if ( m_AutoCrop )
+      {
+      initialSolutionExtract->SetInput( this->GetInitialSolution() );
+      initialSolutionExtract->SetExtractionRegion( airwayInput->GetLargestPossibleRegion() );
+      initialSolutionExtract->Update();
+      heatFlowFilter->SetInitialSolution( initialSolutionExtract->GetOutput() );
+      }
+    else
+      {
+      heatFlowFilter->SetInitialSolution( this->GetInitialSolution() );
+      }
+    }
+
+  // The solver takes nearly all of the time, so it alone drives the
+  // progress of this filter.
+  ProgressAccumulator::Pointer progress = ProgressAccumulator::New();
+  progress->SetMiniPipelineFilter( this );
+  progress->RegisterInternalFilter( heatFlowFilter, 1.0f );
+
+  typedef MemberCommand< Self > CommandType;
+  typename CommandType::Pointer iterationCommand = CommandType::New();
+  iterationCommand->SetCallbackFunction( this, &Self::ForwardIterationEvent );
+  heatFlowFilter->AddObserver( IterationEvent(), iterationCommand );
+
+  // Without cropping the solver writes straight into the output of
+  // this filter.
+  if ( !m_AutoCrop )
+    {
+    heatFlowFilter->GraftOutput( output );
+    }
+
   heatFlowFilter->Update();
 
+  m_CurrentIteration = heatFlowFilter->GetCurrentIteration();
+  m_CurrentResidual = heatFlowFilter->GetCurrentResidual();
+  m_NumberOfUnknowns = heatFlowFilter->GetNumberOfUnknowns();
+  m_SetupTime = heatFlowFilter->GetSetupTime();
+  m_SolveTime = heatFlowFilter->GetSolveTime();
+
   // Export Result
-  typedef itk::ImageRegionIteratorWithIndex< TOutputImage > ImageIterator;
-  ImageIterator it( heatFlowFilter->GetOutput(), ( heatFlowFilter->GetOutput() )->GetRequestedRegion() );
-  for (it.GoToBegin(); !it.IsAtEnd(); ++it)
-  {
-    const OutputIndexType index = it.GetIndex();
-    output->SetPixel( index, ( heatFlowFilter->GetOutput() )->GetPixel( index ) );
-  }
+  if ( !m_AutoCrop )
+    {
+    this->GraftOutput( heatFlowFilter->GetOutput() );
+    return;
+    }
+
+  // Outside the cropped region there is no airway, so the output is
+  // NaN there, as the solver leaves it outside the airway.
+  this->AllocateOutputs();
+  output->FillBuffer( std::numeric_limits< OutputPixelType >::quiet_NaN() );
 
+  const typename TOutputImage::RegionType & solutionRegion =
+    heatFlowFilter->GetOutput()->GetBufferedRegion();
+  ImageAlgorithm::Copy( heatFlowFilter->GetOutput(), output.GetPointer(),
+                        solutionRegion, solutionRegion );
 }
 
 } // end namespace itk
@@ -3,6 +3,12 @@
 
 #include <itkImageToImageFilter.h>
 
+#include "itkLaplaceMultigridPreconditioner.h"
+#include "itkLaplaceStencilOperator.h"
+#include "itkLaplaceUnknownIndexMap.h"
+#include "itkLaplaceVectorKernels.h"
+#include "itkThreadedRange.h"
+
 #include <Eigen/Sparse>
 
 #include <vector>
@@ -20,6 +26,17 @@ namespace itk
  * region. This can be useful to, for instance, compute cross sections
  * of a tube-like objects.
  *
+ * The linear system can either be assembled into a sparse matrix or
+ * solved matrix-free by applying the 7-point stencil directly. The
+ * matrix-free solver needs considerably less memory on large images.
+ * The matrix-free solver can be preconditioned with geometric
+ * multigrid, which keeps the number of iterations nearly independent
+ * of the voxel spacing.
+ *
+ * Both are solved with a conjugate gradient iteration that runs on
+ * GetNumberOfThreads() threads. The result does not depend on the
+ * number of threads.
+ *
  * Authors: Marc Niethammer and Yi Hong wrote MATLAB code that was
  * adapted to ITK by Cory Quammen. */
 template< typename TInputImage, typename TOutputImage >
@@ -43,6 +60,67 @@ public:
   typedef typename TOutputImage::PixelType OutputPixelType;
   typedef typename TOutputImage::IndexType OutputIndexType;
 
+  /** Linear solvers available to this filter. */
+  typedef enum {
+    ASSEMBLED_CONJUGATE_GRADIENT = 0,
+    MATRIX_FREE_CONJUGATE_GRADIENT,
+    MULTIGRID_CONJUGATE_GRADIENT
+  } SolverType;
+
+  /** Set/get the solver used for the linear system. Defaults to
+   *  ASSEMBLED_CONJUGATE_GRADIENT. */
+  itkSetMacro( Solver, SolverType );
+  itkGetConstMacro( Solver, SolverType );
+
+  /** Multigrid cycles available as preconditioner. */
+  typedef enum {
+    V_CYCLE = 0,
+    F_CYCLE
+  } MultigridCycleType;
+
+  /** Set/get the cycle used by MULTIGRID_CONJUGATE_GRADIENT. Defaults
+   *  to V_CYCLE. */
+  itkSetMacro( MultigridCycle, MultigridCycleType );
+  itkGetConstMacro( MultigridCycle, MultigridCycleType );
+
+  /** Set/get the maximum number of multigrid levels, including the
+   *  full resolution level. Zero, the default, coarsens until the
+   *  coarsest level can be solved directly. */
+  itkSetMacro( MaximumNumberOfMultigridLevels, unsigned int );
+  itkGetConstMacro( MaximumNumberOfMultigridLevels, unsigned int );
+
+  /** Set/get the relative residual norm |b - A x| / |b| at which the
+   *  conjugate gradient iteration stops. Defaults to the machine
+   *  epsilon of the output pixel type, as in
+   *  Eigen::ConjugateGradient. */
+  itkSetMacro( Tolerance, double );
+  itkGetConstMacro( Tolerance, double );
+
+  /** Set/get the maximum number of conjugate gradient iterations.
+   *  Zero, the default, allows twice the number of unknowns and
+   *  raises an exception if the tolerance is not reached. With an
+   *  explicit limit, stopping early only produces a warning. */
+  itkSetMacro( MaximumNumberOfIterations, SizeValueType );
+  itkGetConstMacro( MaximumNumberOfIterations, SizeValueType );
+
+  /** Get the number of conjugate gradient iterations done so far.
+   *  Observers of IterationEvent can query it while the filter runs,
+   *  afterwards it holds the final count. */
+  itkGetConstMacro( CurrentIteration, SizeValueType );
+
+  /** Get the current relative residual norm |b - A x| / |b|. */
+  itkGetConstMacro( CurrentResidual, double );
+
+  /** Get the number of unknowns of the linear system, i.e., the
+   *  number of voxels labeled SolutionLabel, of the last update. */
+  itkGetConstMacro( NumberOfUnknowns, SizeValueType );
+
+  /** Get the wall clock time in seconds spent setting up the linear
+   *  system (including the preconditioner) and in the conjugate
+   *  gradient iteration during the last update. */
+  itkGetConstMacro( SetupTime, double );
+  itkGetConstMacro( SolveTime, double );
+
   /** Set/get the label used to designate a voxel for which the
    *  Laplace equation solution should be computed. */
   itkSetMacro( SolutionLabel, InputPixelType );
@@ -68,6 +146,15 @@ public:
   /** Get the number of Dirichlet boundary conditions. */
   size_t GetNumberOfDirichletBoundaryConditions() const;
 
+  /** Set/get an optional initial guess for the solution, e.g., the
+   *  output of a previous run with slightly different boundary
+   *  conditions. It must be defined on the same grid as the input.
+   *  Voxels of the guess that are not finite, such as the NaN voxels
+   *  outside the solution region of a previous output, start at
+   *  zero. */
+  void SetInitialSolution( const TOutputImage * image );
+  const TOutputImage * GetInitialSolution() const;
+
 // #ifdef ITK_USE_CONCEPT_CHECKING
 //   // Begin concept checking
 //   itkConceptMacro( FloatTypeCheck,
@@ -88,17 +175,108 @@ private:
   LaplaceEquationSolverImageFilter(const Self &); //purposely not implemented
   void operator=(const Self &); //purposely not implemented
 
+  SolverType         m_Solver;
+  MultigridCycleType m_MultigridCycle;
+  unsigned int       m_MaximumNumberOfMultigridLevels;
+  double             m_Tolerance;
+  SizeValueType      m_MaximumNumberOfIterations;
+
+  SizeValueType      m_CurrentIteration;
+  double             m_CurrentResidual;
+  SizeValueType      m_NumberOfUnknowns;
+  double             m_SetupTime;
+  double             m_SolveTime;
+
   InputPixelType m_SolutionLabel;
   InputPixelType m_NeumannBoundaryConditionLabel;
 
   typedef std::map< InputPixelType, OutputPixelType > DirichletMapType;
   DirichletMapType m_DirichletBoundaryConditionMap;
 
+  typedef LaplaceUnknownIndexMap< TInputImage >               UnknownIndexMapType;
   typedef std::vector< Eigen::Triplet< OutputPixelType > >    TripletListType;
   typedef Eigen::Matrix< OutputPixelType, Eigen::Dynamic, 1 > VectorType;
+  typedef LaplaceStencilOperator< OutputPixelType >           StencilOperatorType;
+  typedef LaplaceSparseMatrixOperator< OutputPixelType >      SparseMatrixOperatorType;
+  typedef LaplaceVectorKernels< OutputPixelType >             KernelsType;
+  typedef LaplaceMultigridPreconditioner< OutputPixelType >   MultigridPreconditionerType;
+
   void UpdateAB( size_t i, InputIndexType index, OutputPixelType invDxDx,
                  TripletListType & tripletList, VectorType & b,
                  OffsetValueType solutionIndex );
+
+  void UpdateStencil( size_t i, unsigned int neighbor, InputIndexType index,
+                      OutputPixelType invDxDx, StencilOperatorType & stencil,
+                      VectorType & b, OffsetValueType solutionIndex );
+
+  /** Add the rows of unknowns [begin, end) to the triplet list and b. */
+  void AssembleTriplets( const UnknownIndexMapType & unknowns,
+                         SizeValueType begin, SizeValueType end,
+                         TripletListType & tripletList, VectorType & b );
+
+  /** Set up the stencil and b for unknowns [begin, end). */
+  void AssembleStencil( const UnknownIndexMapType & unknowns,
+                        SizeValueType begin, SizeValueType end,
+                        StencilOperatorType & stencil, VectorType & b );
+
+  struct AssembleTripletsFunctor
+  {
+    Self *                         Filter;
+    const UnknownIndexMapType *    Unknowns;
+    VectorType *                   B;
+    std::vector< TripletListType > Triplets;
+
+    void operator()( SizeValueType chunk, SizeValueType begin, SizeValueType end )
+    { Filter->AssembleTriplets( *Unknowns, begin, end, Triplets[chunk], *B ); }
+  };
+
+  struct AssembleStencilFunctor
+  {
+    Self *                      Filter;
+    const UnknownIndexMapType * Unknowns;
+    StencilOperatorType *       Stencil;
+    VectorType *                B;
+
+    void operator()( SizeValueType, SizeValueType begin, SizeValueType end )
+    { Filter->AssembleStencil( *Unknowns, begin, end, *Stencil, *B ); }
+  };
+
+  struct DirichletLabelPredicate
+  {
+    const DirichletMapType * Map;
+
+    bool operator()( const InputPixelType & label ) const
+    { return Map->find( label ) != Map->end(); }
+  };
+
+  /** Set x to the initial guess at the unknowns. */
+  void InitializeSolution( const UnknownIndexMapType & unknowns, VectorType & x );
+
+  /** Solve by assembling the sparse matrix. x holds the initial guess
+   *  on entry. Returns true if the tolerance was reached. */
+  bool SolveAssembled( const UnknownIndexMapType & unknowns,
+                       VectorType & x );
+
+  /** Solve by applying the stencil directly in a conjugate gradient
+   *  loop preconditioned with Jacobi or multigrid. No matrix is
+   *  built. x holds the initial guess on entry. Returns true if the
+   *  tolerance was reached. */
+  bool SolveMatrixFree( const UnknownIndexMapType & unknowns,
+                        VectorType & x );
+
+  /** Preconditioned conjugate gradient iteration following
+   *  Eigen::internal::conjugate_gradient. TOperator must provide
+   *  ApplyRange( x, y, begin, end ) as used by LaplaceVectorKernels
+   *  and TPreconditioner must provide Solve( r, z ) computing
+   *  z = M^-1 r. Preconditioners that are not symmetric are handled
+   *  with the flexible (Polak-Ribiere) update of the search direction.
+   *  Invokes IterationEvent and updates the progress after every
+   *  iteration. Returns true if the relative residual dropped below
+   *  the tolerance. */
+  template< typename TOperator, typename TPreconditioner >
+  bool SolveConjugateGradient( const TOperator & A, const TPreconditioner & M,
+                               const KernelsType & kernels,
+                               const VectorType & b, VectorType & x );
 };
 } // end namespace itk
 
@@ -4,9 +4,12 @@
 #include "itkLaplaceEquationSolverImageFilter.h"
 
 #include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkTimeProbe.h"
+
+#include <vnl/vnl_math.h>
 
 #include <algorithm>
-#include <ctime>
+#include <cmath>
 #include <limits>
 
 #include <Eigen/SparseCholesky>
@@ -52,10 +55,65 @@ LaplaceEquationSolverImageFilter< TInputImage, TOutputImage >
     }
 }
 
+template< typename TInputImage, typename TOutputImage >
+inline void
+LaplaceEquationSolverImageFilter< TInputImage, TOutputImage >
+::UpdateStencil( size_t i, unsigned int neighbor, InputIndexType voxelIndex,
+                 OutputPixelType invDxDx, StencilOperatorType & stencil,
+                 VectorType & b, OffsetValueType solutionIndex )
+{
+  bool labelFound = false;
+  InputPixelType label = this->GetInput()->GetPixel( voxelIndex );
+  if ( label == m_SolutionLabel )
+    {
+    // Neighbors clamped to the image boundary refer back to the
+    // unknown itself and end up on the diagonal.
+    if ( static_cast< size_t >( solutionIndex ) == i )
+      {
+      stencil.AddToDiagonal( i, invDxDx );
+      }
+    else
+      {
+      stencil.SetNeighbor( i, neighbor, solutionIndex );
+      }
+    labelFound = true;
+    }
+  else if ( label == m_NeumannBoundaryConditionLabel )
+    {
+    stencil.AddToDiagonal( i, invDxDx );
+    labelFound = true;
+    }
+  else
+    {
+    typename DirichletMapType::iterator iter =
+      m_DirichletBoundaryConditionMap.find( label );
+    if ( iter != m_DirichletBoundaryConditionMap.end() )
+      {
+      b[i] -= iter->second * invDxDx;
+      labelFound = true;
+      }
+    }
+  if ( !labelFound )
+    {
+    itkExceptionMacro( << "Unknown label value "
+                       << label << " at index " << voxelIndex );
+    }
+}
+
 template< typename TInputImage, typename TOutputImage >
 LaplaceEquationSolverImageFilter< TInputImage, TOutputImage >
 ::LaplaceEquationSolverImageFilter()
 {
+  m_Solver = ASSEMBLED_CONJUGATE_GRADIENT;
+  m_MultigridCycle = V_CYCLE;
+  m_MaximumNumberOfMultigridLevels = 0;
+  m_Tolerance = Eigen::NumTraits< OutputPixelType >::epsilon();
+  m_MaximumNumberOfIterations = 0;
+  m_CurrentIteration = 0;
+  m_CurrentResidual = 0.0;
+  m_NumberOfUnknowns = 0;
+  m_SetupTime = 0.0;
+  m_SolveTime = 0.0;
   m_SolutionLabel = 11;
   m_NeumannBoundaryConditionLabel = 6;
 }
@@ -90,6 +148,61 @@ LaplaceEquationSolverImageFilter< TInputImage, TOutputImage >
   return m_DirichletBoundaryConditionMap.size();
 }
 
+template< typename TInputImage, typename TOutputImage >
+void
+LaplaceEquationSolverImageFilter< TInputImage, TOutputImage >
+::SetInitialSolution( const TOutputImage * image )
+{
+  this->SetNthInput( 1, const_cast< TOutputImage * >( image ) );
+}
+
+template< typename TInputImage, typename TOutputImage >
+const TOutputImage *
+LaplaceEquationSolverImageFilter< TInputImage, TOutputImage >
+::GetInitialSolution() const
+{
+  return static_cast< const TOutputImage * >( this->ProcessObject::GetInput( 1 ) );
+}
+
+template< typename TInputImage, typename TOutputImage >
+void
+LaplaceEquationSolverImageFilter< TInputImage, TOutputImage >
+::InitializeSolution( const UnknownIndexMapType & unknowns, VectorType & x )
+{
+  const SizeValueType numberOfUnknowns = unknowns.GetNumberOfUnknowns();
+  x.resize( numberOfUnknowns );
+  x.fill( 0.0 );
+
+  const TOutputImage * initialSolution = this->GetInitialSolution();
+  if ( !initialSolution )
+    {
+    return;
+    }
+
+  // The unknowns are indexed in the input, so the guess must cover it
+  const typename TInputImage::RegionType & inputRegion = this->GetInput()->GetBufferedRegion();
+  if ( !initialSolution->GetBufferedRegion().IsInside( inputRegion ) )
+    {
+    itkExceptionMacro( << "Initial solution region "
+                       << initialSolution->GetBufferedRegion()
+                       << " does not contain the input region " << inputRegion );
+    }
+
+  SizeValueType numberOfGuesses = 0;
+  for ( SizeValueType i = 0; i < numberOfUnknowns; ++i )
+    {
+    OutputPixelType value = initialSolution->GetPixel( unknowns.GetIndex( i ) );
+    if ( vnl_math_isfinite( value ) )
+      {
+      x[i] = value;
+      ++numberOfGuesses;
+      }
+    }
+
+  itkDebugMacro( << "Initial solution defined at " << numberOfGuesses
+                 << " of " << numberOfUnknowns << " unknowns" );
+}
+
 template< typename TInputImage, typename TOutputImage >
 void
 LaplaceEquationSolverImageFilter< TInputImage, TOutputImage >
@@ -98,55 +211,103 @@ LaplaceEquationSolverImageFilter< TInputImage, TOutputImage >
   typename TInputImage::ConstPointer input = this->GetInput();
   typename TOutputImage::Pointer output = this->GetOutput();
 
+  TimeProbe probe;
+  probe.Start();
+
+  m_CurrentIteration = 0;
+  m_CurrentResidual = 0.0;
+  m_NumberOfUnknowns = 0;
+  m_SolveTime = 0.0;
+  m_SetupTime = 0.0;
+
   // Allocate the output and initialize to NaN
   this->AllocateOutputs();
   output->FillBuffer( std::numeric_limits< OutputPixelType >::quiet_NaN() );
 
-  // Do Laplace solution by iterative solver using 6 neighborhood
-  InputIndexType minIndex = input->GetBufferedRegion().GetIndex();
-  InputIndexType maxIndex = input->GetBufferedRegion().GetUpperIndex();
+  // First number the voxels of the solution domain. We do this,
+  // otherwise the matrices to solve will be far too large to fit into
+  // memory. The map only stores the unknowns and the runs of unknowns
+  // along each image row, not an entry per voxel.
+  UnknownIndexMapType unknowns;
+  unknowns.Build( input.GetPointer(), m_SolutionLabel, this->GetNumberOfThreads() );
 
-  // First get all the solution domain indices. We do this, otherwise
-  // the matrices to solve will be far too large to fit into memory.
-  std::vector< InputIndexType > solutionIndices;
+  m_NumberOfUnknowns = unknowns.GetNumberOfUnknowns();
 
-  typedef typename TInputImage::OffsetValueType OffsetValueType;
-  std::vector< OffsetValueType > linearIndex2UnknownIndex(
-    input->GetPixelContainer()->Size(), 0 );
+  itkDebugMacro( << "Done with noting indices" );
+
+  itkDebugMacro( << "Number of unknowns: " << unknowns.GetNumberOfUnknowns()
+                 << " in " << unknowns.GetNumberOfRuns() << " runs" );
+
+  VectorType x;
+  this->InitializeSolution( unknowns, x );
+  bool converged;
+  if ( m_Solver == ASSEMBLED_CONJUGATE_GRADIENT )
+    {
+    converged = this->SolveAssembled( unknowns, x );
+    }
+  else
+    {
+    converged = this->SolveMatrixFree( unknowns, x );
+    }
+
+  probe.Stop();
+  m_SetupTime = probe.GetTotal() - m_SolveTime;
 
-  long counter = 0;
-  typedef ImageRegionConstIteratorWithIndex< TInputImage > IteratorWithIndexType;
-  IteratorWithIndexType fullRegionIter( input.GetPointer(), input->GetBufferedRegion() );
-  for ( fullRegionIter.GoToBegin(); !fullRegionIter.IsAtEnd(); ++fullRegionIter )
+  itkDebugMacro( << "Done solving. " << m_CurrentIteration << " iterations, "
+                 << "relative residual " << m_CurrentResidual << ", "
+                 << m_SetupTime << " s setup, " << m_SolveTime << " s solve" );
+
+  if ( !converged )
     {
-    InputPixelType pixelValue = fullRegionIter.Get();
-    InputIndexType index = fullRegionIter.GetIndex();
-    if ( pixelValue == m_SolutionLabel )
+    // Stopping at an iteration cap set by the user is a deliberate
+    // trade of accuracy for speed, so it only warrants a warning.
+    if ( m_MaximumNumberOfIterations == 0 )
       {
-      solutionIndices.push_back( index );
-      linearIndex2UnknownIndex[ input->ComputeOffset( fullRegionIter.GetIndex() ) ] = counter;
-      ++counter;
+      itkExceptionMacro( << "Failed to solve linear system." );
       }
+    itkWarningMacro( << "Stopped after " << m_CurrentIteration
+                     << " iterations at relative residual " << m_CurrentResidual
+                     << " above the tolerance " << m_Tolerance );
     }
 
-  itkDebugMacro( << "Done with noting indices" );
+  // Now copy the output vector to the output image
+  for ( SizeValueType i = 0; i < unknowns.GetNumberOfUnknowns(); ++i )
+    {
+    output->SetPixel( unknowns.GetIndex( i ), x[i] );
+    }
 
-  size_t numberOfUnknowns = solutionIndices.size();
+  // Now set the values for the Dirichlet boundary conditions
+  // in the output image.
+  ImageRegionConstIterator< TInputImage > iterIn( input.GetPointer(),
+                                                     input->GetBufferedRegion() );
+  ImageRegionIterator< TOutputImage > iterOut( output.GetPointer(),
+                                                  output->GetBufferedRegion() );
 
-  itkDebugMacro( << "Number of unknowns: " << numberOfUnknowns );
+  while ( !iterIn.IsAtEnd() && !iterOut.IsAtEnd() )
+    {
+    typename DirichletMapType::iterator iter = m_DirichletBoundaryConditionMap.find( iterIn.Get() );
+    if ( iter != m_DirichletBoundaryConditionMap.end() )
+      {
+      iterOut.Set( iter->second );
+      }
+    ++iterIn;
+    ++iterOut;
+    }
+}
 
-  // Set up the linear system by going through all the indices of the
-  // solution domain and creating the sparse matrix A and the right
-  // vector b
-  typedef Eigen::SparseMatrix< OutputPixelType, Eigen::ColMajor > MatrixType;
-  MatrixType A( numberOfUnknowns, numberOfUnknowns );
+template< typename TInputImage, typename TOutputImage >
+void
+LaplaceEquationSolverImageFilter< TInputImage, TOutputImage >
+::AssembleTriplets( const UnknownIndexMapType & unknowns,
+                    SizeValueType begin, SizeValueType end,
+                    TripletListType & tripletList, VectorType & b )
+{
+  const TInputImage * input = this->GetInput();
 
-  // Set up the b vector
-  typedef Eigen::Matrix< OutputPixelType, Eigen::Dynamic, 1 > VectorType;
-  VectorType b( numberOfUnknowns );
-  b.fill( 0.0 );
+  // Do Laplace solution by iterative solver using 6 neighborhood
+  InputIndexType minIndex = input->GetBufferedRegion().GetIndex();
+  InputIndexType maxIndex = input->GetBufferedRegion().GetUpperIndex();
 
-  // Set the diagonal elements
   OutputPixelType dx = input->GetSpacing()[0];
   OutputPixelType dy = input->GetSpacing()[1];
   OutputPixelType dz = input->GetSpacing()[2];
@@ -155,27 +316,17 @@ LaplaceEquationSolverImageFilter< TInputImage, TOutputImage >
   OutputPixelType invDyDy = 1.0 / (dy * dy);
   OutputPixelType invDzDz = 1.0 / (dz * dz);
 
-  itkDebugMacro( << "Done setting diagonal elements of A" );
-
-  // Triplets to feed into A via
-  // Eigen::SparseMatrix<>::setFromTriplets.  Note that triplets with
-  // the same i, j indices will be summed in the sparse matrix.
   typedef Eigen::Triplet< OutputPixelType > Triplet;
-  std::vector< Triplet > tripletList;
-  tripletList.reserve( 7 * numberOfUnknowns );
+  tripletList.reserve( 7 * ( end - begin ) );
 
   // This is somewhat of a goofy way to set up A. It is nearly a
-  // direct translation from MATLAB code. Setting the elements based
-  // on a traditional stencil approach might be faster and use less
-  // memory.
-  for ( size_t i = 0; i < numberOfUnknowns; ++i )
+  // direct translation from MATLAB code. SolveMatrixFree() applies
+  // the same stencil without building the matrix.
+  for ( size_t i = begin; i < end; ++i )
     {
     tripletList.push_back( Triplet( i, i, -2.0 * ( invDxDx + invDyDy + invDzDz ) ) );
-    }
 
-  for ( size_t i = 0; i < numberOfUnknowns; ++i )
-    {
-    InputIndexType index = solutionIndices[i];
+    InputIndexType index = unknowns.GetIndex( i );
 
     // +x, -x
     InputIndexType indexXP = index;
@@ -195,25 +346,119 @@ LaplaceEquationSolverImageFilter< TInputImage, TOutputImage >
     InputIndexType indexZM = index;
     indexZM[2] = std::max( minIndex[2], index[2] - 1 );
 
-    OffsetValueType linearIndex;
-    linearIndex = input->ComputeOffset( indexXP );
     this->UpdateAB( i, indexXP, invDxDx, tripletList, b,
-                    linearIndex2UnknownIndex[ linearIndex ] );
-    linearIndex = input->ComputeOffset( indexXM );
+                    unknowns.GetUnknownIndex( indexXP ) );
     this->UpdateAB( i, indexXM, invDxDx, tripletList, b,
-                    linearIndex2UnknownIndex[ linearIndex ] );
-    linearIndex = input->ComputeOffset( indexYP );
+                    unknowns.GetUnknownIndex( indexXM ) );
     this->UpdateAB( i, indexYP, invDyDy, tripletList, b,
-                    linearIndex2UnknownIndex[ linearIndex ] );
-    linearIndex = input->ComputeOffset( indexYM );
+                    unknowns.GetUnknownIndex( indexYP ) );
     this->UpdateAB( i, indexYM, invDyDy, tripletList, b,
-                    linearIndex2UnknownIndex[ linearIndex ] );
-    linearIndex = input->ComputeOffset( indexZP );
+                    unknowns.GetUnknownIndex( indexYM ) );
     this->UpdateAB( i, indexZP, invDzDz, tripletList, b,
-                    linearIndex2UnknownIndex[ linearIndex ] );
-    linearIndex = input->ComputeOffset( indexZM );
+                    unknowns.GetUnknownIndex( indexZP ) );
     this->UpdateAB( i, indexZM, invDzDz, tripletList, b,
-                    linearIndex2UnknownIndex[ linearIndex ] );
+                    unknowns.GetUnknownIndex( indexZM ) );
+    }
+}
+
+template< typename TInputImage, typename TOutputImage >
+void
+LaplaceEquationSolverImageFilter< TInputImage, TOutputImage >
+::AssembleStencil( const UnknownIndexMapType & unknowns,
+                   SizeValueType begin, SizeValueType end,
+                   StencilOperatorType & stencil, VectorType & b )
+{
+  const TInputImage * input = this->GetInput();
+
+  InputIndexType minIndex = input->GetBufferedRegion().GetIndex();
+  InputIndexType maxIndex = input->GetBufferedRegion().GetUpperIndex();
+
+  OutputPixelType inverseSpacingSquared[3];
+  for ( unsigned int d = 0; d < 3; ++d )
+    {
+    OutputPixelType spacing = input->GetSpacing()[d];
+    inverseSpacingSquared[d] = 1.0 / ( spacing * spacing );
+    }
+
+  // Visit the same neighbors in the same order as AssembleTriplets()
+  // so that both solvers see the same linear system.
+  for ( size_t i = begin; i < end; ++i )
+    {
+    InputIndexType index = unknowns.GetIndex( i );
+    for ( unsigned int n = 0; n < StencilOperatorType::NumberOfNeighbors; ++n )
+      {
+      unsigned int d = n / 2;
+      InputIndexType neighborIndex = index;
+      if ( n % 2 == 0 )
+        {
+        neighborIndex[d] = std::min( maxIndex[d], index[d] + 1 );
+        }
+      else
+        {
+        neighborIndex[d] = std::max( minIndex[d], index[d] - 1 );
+        }
+
+      this->UpdateStencil( i, n, neighborIndex, inverseSpacingSquared[d],
+                           stencil, b, unknowns.GetUnknownIndex( neighborIndex ) );
+      }
+    }
+}
+
+template< typename TInputImage, typename TOutputImage >
+bool
+LaplaceEquationSolverImageFilter< TInputImage, TOutputImage >
+::SolveAssembled( const UnknownIndexMapType & unknowns,
+                  VectorType & x )
+{
+  typename TInputImage::ConstPointer input = this->GetInput();
+
+  size_t numberOfUnknowns = unknowns.GetNumberOfUnknowns();
+
+  // Set up the linear system by going through all the indices of the
+  // solution domain and creating the sparse matrix A and the right
+  // vector b
+  typedef typename SparseMatrixOperatorType::MatrixType MatrixType;
+  MatrixType A( numberOfUnknowns, numberOfUnknowns );
+
+  // Set up the b vector
+  VectorType b( numberOfUnknowns );
+  b.fill( 0.0 );
+
+  // Each thread collects the triplets of a contiguous block of
+  // unknowns. The blocks are concatenated in order, so every entry of
+  // A is summed in the same order for any number of threads.
+  const SizeValueType numberOfChunks =
+    ThreadedRange::GetNumberOfChunks( this->GetNumberOfThreads(), numberOfUnknowns );
+
+  AssembleTripletsFunctor assembler;
+  assembler.Filter = this;
+  assembler.Unknowns = &unknowns;
+  assembler.B = &b;
+  assembler.Triplets.resize( numberOfChunks );
+  ThreadedRange::Execute( numberOfChunks, numberOfUnknowns, assembler );
+
+  // Triplets to feed into A via
+  // Eigen::SparseMatrix<>::setFromTriplets.  Note that triplets with
+  // the same i, j indices will be summed in the sparse matrix.
+  TripletListType tripletList;
+  if ( numberOfChunks == 1 )
+    {
+    tripletList.swap( assembler.Triplets[0] );
+    }
+  else
+    {
+    size_t numberOfTriplets = 0;
+    for ( SizeValueType chunk = 0; chunk < numberOfChunks; ++chunk )
+      {
+      numberOfTriplets += assembler.Triplets[chunk].size();
+      }
+    tripletList.reserve( numberOfTriplets );
+    for ( SizeValueType chunk = 0; chunk < numberOfChunks; ++chunk )
+      {
+      tripletList.insert( tripletList.end(), assembler.Triplets[chunk].begin(),
+                          assembler.Triplets[chunk].end() );
+      TripletListType().swap( assembler.Triplets[chunk] );
+      }
     }
 
   itkDebugMacro( << "Done building linear systems" );
@@ -227,55 +472,211 @@ LaplaceEquationSolverImageFilter< TInputImage, TOutputImage >
 
   itkDebugMacro( << "Done compressing" );
 
-  std::time_t startTime;
-  std::time( &startTime );
-
   // Tried several solvers on one large image to find the fastest:
   // ConjugateGradient  - 111 seconds
   // SimplicialCholesky - 204 seconds
   // SimplicialLDLT     - 203 seconds
   // SimplicalLLT       - error
-  Eigen::ConjugateGradient< MatrixType > solver;
-  solver.compute( A );
-  VectorType x = solver.solve( b );
+  //
+  // The conjugate gradient iteration below is the one of
+  // Eigen::ConjugateGradient with its default Jacobi preconditioner,
+  // but applies the row-major matrix and updates the vectors with
+  // multiple threads.
+  KernelsType kernels;
+  kernels.SetNumberOfThreads( this->GetNumberOfThreads() );
+
+  SparseMatrixOperatorType op( A );
+  LaplaceJacobiPreconditioner< OutputPixelType > preconditioner;
+  preconditioner.SetKernels( &kernels );
+  preconditioner.Compute( op.GetDiagonal() );
+
+  return this->SolveConjugateGradient( op, preconditioner, kernels, b, x );
+}
+
+template< typename TInputImage, typename TOutputImage >
+bool
+LaplaceEquationSolverImageFilter< TInputImage, TOutputImage >
+::SolveMatrixFree( const UnknownIndexMapType & unknowns,
+                   VectorType & x )
+{
+  typename TInputImage::ConstPointer input = this->GetInput();
+
+  size_t numberOfUnknowns = unknowns.GetNumberOfUnknowns();
+
+  OutputPixelType inverseSpacingSquared[3];
+  for ( unsigned int d = 0; d < 3; ++d )
+    {
+    OutputPixelType spacing = input->GetSpacing()[d];
+    inverseSpacingSquared[d] = 1.0 / ( spacing * spacing );
+    }
 
-  itkDebugMacro( << "Done solving" );
+  StencilOperatorType stencil;
+  stencil.Initialize( numberOfUnknowns, inverseSpacingSquared );
 
-  std::time_t endTime;
-  std::time( &endTime );
+  VectorType b( numberOfUnknowns );
+  b.fill( 0.0 );
+
+  // Unknowns only write their own row of the stencil and b, so the
+  // blocks can be assembled independently.
+  AssembleStencilFunctor assembler;
+  assembler.Filter = this;
+  assembler.Unknowns = &unknowns;
+  assembler.Stencil = &stencil;
+  assembler.B = &b;
+  ThreadedRange::Execute( ThreadedRange::GetNumberOfChunks( this->GetNumberOfThreads(),
+                                                            numberOfUnknowns ),
+                          numberOfUnknowns, assembler );
+
+  itkDebugMacro( << "Done building stencil operator" );
 
-  double elapsedSeconds = std::difftime( endTime, startTime );
-  (void) elapsedSeconds; // To avoid warning when compiled in release mode
-  itkDebugMacro( << "Execution took " << elapsedSeconds << " seconds." );
+  KernelsType kernels;
+  kernels.SetNumberOfThreads( this->GetNumberOfThreads() );
+
+  bool converged = false;
+  if ( m_Solver == MULTIGRID_CONJUGATE_GRADIENT )
+    {
+    SizeValueType gridSize[3];
+    OutputPixelType spacing[3];
+    for ( unsigned int d = 0; d < 3; ++d )
+      {
+      gridSize[d] = input->GetBufferedRegion().GetSize()[d];
+      spacing[d] = input->GetSpacing()[d];
+      }
 
-  if ( solver.info() != Eigen::Success )
+    // Dirichlet voxels anywhere in the image, in increasing offset order
+    DirichletLabelPredicate isDirichlet;
+    isDirichlet.Map = &m_DirichletBoundaryConditionMap;
+    UnknownIndexMapType dirichlet;
+    dirichlet.BuildWithPredicate( input.GetPointer(), isDirichlet,
+                                  this->GetNumberOfThreads() );
+
+    MultigridPreconditionerType preconditioner;
+    preconditioner.SetCycle( m_MultigridCycle == F_CYCLE ?
+                             MultigridPreconditionerType::F_CYCLE :
+                             MultigridPreconditionerType::V_CYCLE );
+    preconditioner.SetMaximumNumberOfLevels( m_MaximumNumberOfMultigridLevels );
+    preconditioner.SetKernels( &kernels );
+    preconditioner.Compute( stencil, gridSize, spacing, unknowns.GetOffsets(),
+                            dirichlet.GetOffsets() );
+
+    itkDebugMacro( << "Built " << preconditioner.GetNumberOfLevels()
+                   << " multigrid levels" );
+
+    converged = this->SolveConjugateGradient( stencil, preconditioner, kernels, b, x );
+    }
+  else
     {
-    itkExceptionMacro( << "Failed to solve linear system." );
+    LaplaceJacobiPreconditioner< OutputPixelType > preconditioner;
+    preconditioner.SetKernels( &kernels );
+    preconditioner.Compute( stencil.GetDiagonal() );
+
+    converged = this->SolveConjugateGradient( stencil, preconditioner, kernels, b, x );
     }
 
-  // Now copy the output vector to the output image
-  for ( size_t i = 0; i < solutionIndices.size(); ++i )
+  return converged;
+}
+
+template< typename TInputImage, typename TOutputImage >
+template< typename TOperator, typename TPreconditioner >
+bool
+LaplaceEquationSolverImageFilter< TInputImage, TOutputImage >
+::SolveConjugateGradient( const TOperator & A, const TPreconditioner & M,
+                          const KernelsType & kernels,
+                          const VectorType & b, VectorType & x )
+{
+  typedef OutputPixelType RealType;
+
+  TimeProbe probe;
+  probe.Start();
+
+  // Same defaults as Eigen::ConjugateGradient
+  const RealType tolerance = static_cast< RealType >( m_Tolerance );
+  const SizeValueType maxIterations = m_MaximumNumberOfIterations > 0 ?
+    m_MaximumNumberOfIterations : 2 * static_cast< SizeValueType >( b.size() );
+
+  m_CurrentIteration = 0;
+  m_CurrentResidual = 0.0;
+
+  const RealType rhsNorm2 = kernels.Dot( b, b );
+  if ( rhsNorm2 == 0 )
     {
-    output->SetPixel( solutionIndices[i], x[i] );
+    x.setZero();
+    probe.Stop();
+    m_SolveTime = probe.GetTotal();
+    return true;
     }
 
-  // Now set the values for the Dirichlet boundary conditions
-  // in the output image.
-  ImageRegionConstIterator< TInputImage > iterIn( input.GetPointer(),
-                                                     input->GetBufferedRegion() );
-  ImageRegionIterator< TOutputImage > iterOut( output.GetPointer(),
-                                                  output->GetBufferedRegion() );
+  VectorType residual;
+  RealType residualNorm2 = kernels.Residual( A, b, x, residual );
+  m_CurrentResidual = std::sqrt( residualNorm2 / rhsNorm2 );
 
-  while ( !iterIn.IsAtEnd() && !iterOut.IsAtEnd() )
+  const RealType considerAsZero = std::numeric_limits< RealType >::min();
+  const RealType threshold =
+    std::max( RealType( tolerance * tolerance * rhsNorm2 ), considerAsZero );
+
+  // Progress is reported as the fraction of the residual reduction
+  // achieved so far on a log scale.
+  const double initialResidual = m_CurrentResidual;
+  const double logReduction = initialResidual > tolerance && tolerance > 0 ?
+    std::log( initialResidual / tolerance ) : 1.0;
+
+  if ( residualNorm2 >= threshold )
     {
-    typename DirichletMapType::iterator iter = m_DirichletBoundaryConditionMap.find( iterIn.Get() );
-    if ( iter != m_DirichletBoundaryConditionMap.end() )
+    VectorType p;
+    M.Solve( residual, p );
+
+    // Previous preconditioned residual, only needed for the flexible
+    // update with non-symmetric preconditioners
+    const bool flexible = !M.IsSymmetric();
+    VectorType zOld;
+    if ( flexible )
       {
-      iterOut.Set( iter->second );
+      zOld = p;
+      }
+
+    VectorType z, tmp;
+    RealType absNew = kernels.Dot( residual, p );
+    while ( m_CurrentIteration < maxIterations )
+      {
+      RealType alpha = absNew / kernels.ApplyAndDot( A, p, tmp );
+      residualNorm2 = kernels.UpdateSolutionAndResidual( alpha, p, tmp, x, residual );
+
+      ++m_CurrentIteration;
+      m_CurrentResidual = std::sqrt( residualNorm2 / rhsNorm2 );
+      this->InvokeEvent( IterationEvent() );
+      if ( m_CurrentResidual > 0 )
+        {
+        double progress = std::log( initialResidual / m_CurrentResidual ) / logReduction;
+        this->UpdateProgress( static_cast< float >( std::min( std::max( progress, 0.0 ), 1.0 ) ) );
+        }
+
+      if ( residualNorm2 < threshold )
+        {
+        break;
+        }
+
+      M.Solve( residual, z );
+
+      RealType absOld = absNew;
+      absNew = kernels.Dot( residual, z );
+      RealType beta = absNew / absOld;
+      if ( flexible )
+        {
+        beta = ( absNew - kernels.Dot( residual, zOld ) ) / absOld;
+        zOld = z;
+        }
+      kernels.UpdateDirection( beta, z, p );
       }
-    ++iterIn;
-    ++iterOut;
     }
+
+  probe.Stop();
+  m_SolveTime = probe.GetTotal();
+
+  itkDebugMacro( << "Conjugate gradient took " << m_CurrentIteration << " iterations, "
+                 << "relative residual " << m_CurrentResidual << ", "
+                 << m_SolveTime << " s" );
+
+  return m_CurrentResidual <= tolerance;
 }
 
 } // end namespace itk
@@ -0,0 +1,176 @@
+#ifndef itkLaplaceMultigridPreconditioner_h_included
+#define itkLaplaceMultigridPreconditioner_h_included
+
+#include "itkLaplaceStencilOperator.h"
+
+#include <Eigen/Sparse>
+#include <Eigen/SparseCholesky>
+
+#include <vector>
+
+
+namespace itk
+{
+
+/** \class LaplaceMultigridPreconditioner
+ * \brief Geometric multigrid cycle for the 7-point Laplace operator
+ * over a masked voxel grid.
+ *
+ * The hierarchy is built by coarsening the voxel grid by a factor of
+ * two along each axis. A coarse voxel is a Dirichlet voxel if any of
+ * its eight children is one, otherwise it is an unknown if any of its
+ * children is an unknown. All other coarse voxels act as zero-flux
+ * Neumann voxels. The coarse operators are rediscretized with doubled
+ * spacing, residuals are restricted by averaging over the children
+ * and corrections are prolongated by injection. Weighted Jacobi is
+ * used for smoothing and the coarsest level is solved directly.
+ *
+ * One call to Solve() applies a single V- or F-cycle with a zero
+ * initial guess, which makes the class usable as a conjugate gradient
+ * preconditioner. Only the V-cycle is symmetric.
+ *
+ * Unknowns and Dirichlet voxels are described by their sorted 32-bit
+ * linear offsets in the fine grid, so the hierarchy needs memory
+ * proportional to the number of unknowns only. */
+template< typename TValue >
+class LaplaceMultigridPreconditioner
+{
+public:
+  typedef LaplaceMultigridPreconditioner           Self;
+  typedef TValue                                   ValueType;
+  typedef LaplaceStencilOperator< TValue >         OperatorType;
+  typedef typename OperatorType::VectorType        VectorType;
+  typedef typename OperatorType::UnknownIndexType  UnknownIndexType;
+  typedef LaplaceVectorKernels< TValue >           KernelsType;
+  typedef uint32_t                                 OffsetType;
+  typedef std::vector< OffsetType >                OffsetListType;
+
+  typedef enum {
+    V_CYCLE = 0,
+    F_CYCLE
+  } CycleType;
+
+  LaplaceMultigridPreconditioner();
+
+  /** Set/get the cycle applied by Solve(). Defaults to V_CYCLE. */
+  void SetCycle( CycleType cycle ) { m_Cycle = cycle; }
+  CycleType GetCycle() const { return m_Cycle; }
+
+  /** Set/get the maximum number of levels, including the finest
+   *  one. Zero means coarsening continues until the coarsest level is
+   *  small enough to be solved directly. */
+  void SetMaximumNumberOfLevels( unsigned int levels )
+  { m_MaximumNumberOfLevels = levels; }
+  unsigned int GetMaximumNumberOfLevels() const
+  { return m_MaximumNumberOfLevels; }
+
+  /** Set/get the number of Jacobi sweeps before and after each
+   *  coarse grid correction. */
+  void SetNumberOfSmoothingIterations( unsigned int iterations )
+  { m_NumberOfSmoothingIterations = iterations; }
+  unsigned int GetNumberOfSmoothingIterations() const
+  { return m_NumberOfSmoothingIterations; }
+
+  /** Set the kernels used for smoothing and residuals. The kernels
+   *  are referenced and must outlive this object. Without kernels the
+   *  cycle runs in the calling thread. */
+  void SetKernels( const KernelsType * kernels )
+  { m_Kernels = kernels ? kernels : &m_SerialKernels; }
+
+  /** Build the hierarchy. The fine operator is referenced, not
+   *  copied, and must outlive this object. The unknown offsets must
+   *  be sorted and in the same order as the unknowns of the fine
+   *  operator. Throws if the coarsest operator cannot be factored. */
+  void Compute( const OperatorType & fineOperator,
+                const SizeValueType gridSize[3],
+                const ValueType spacing[3],
+                const OffsetListType & unknownOffsets,
+                const OffsetListType & dirichletOffsets );
+
+  unsigned int GetNumberOfLevels() const
+  { return static_cast< unsigned int >( m_Levels.size() ); }
+
+  SizeValueType GetNumberOfUnknowns( unsigned int level ) const
+  { return this->GetOperator( level ).GetNumberOfUnknowns(); }
+
+  /** Compute z = M^-1 r by one multigrid cycle. */
+  void Solve( const VectorType & r, VectorType & z ) const;
+
+  bool IsSymmetric() const
+  { return m_Cycle == V_CYCLE; }
+
+private:
+  struct Level
+  {
+    /** Operator of this level. Unused on the finest level. */
+    OperatorType Operator;
+
+    /** Weighted inverse diagonal used by the Jacobi smoother. */
+    VectorType SmootherDiagonal;
+
+    /** Coarse unknown of each unknown on this level, or -1 if its
+     *  parent voxel is a Dirichlet voxel. Empty on the coarsest
+     *  level. */
+    std::vector< UnknownIndexType > CoarseUnknown;
+
+    /** Scratch vectors. */
+    VectorType Rhs;
+    VectorType Solution;
+    VectorType Residual;
+  };
+
+  const OperatorType & GetOperator( unsigned int level ) const
+  { return level == 0 ? *m_FineOperator : m_Levels[level].Operator; }
+
+  void Coarsen( const SizeValueType fineSize[3],
+                const OffsetListType & fineUnknowns,
+                const OffsetListType & fineDirichlet,
+                SizeValueType coarseSize[3],
+                OffsetListType & coarseUnknowns,
+                OffsetListType & coarseDirichlet,
+                std::vector< UnknownIndexType > & coarseUnknown ) const;
+
+  void BuildOperator( const SizeValueType size[3],
+                      const ValueType inverseSpacingSquared[3],
+                      const OffsetListType & unknowns,
+                      const OffsetListType & dirichlet,
+                      OperatorType & op ) const;
+
+  void Cycle( unsigned int level, CycleType cycle,
+              const VectorType & b, VectorType & x ) const;
+
+  void Smooth( unsigned int level, const VectorType & b, VectorType & x ) const;
+
+  /** Adds the coarse correction to the fine unknowns. */
+  struct ProlongateFunctor
+  {
+    const std::vector< UnknownIndexType > * CoarseUnknown;
+    const VectorType *                      Correction;
+    VectorType *                            X;
+
+    void operator()( SizeValueType, SizeValueType begin, SizeValueType end );
+  };
+
+  typedef Eigen::SparseMatrix< ValueType >     CoarseMatrixType;
+  typedef Eigen::SimplicialLDLT< CoarseMatrixType > CoarseSolverType;
+
+  CycleType     m_Cycle;
+  unsigned int  m_MaximumNumberOfLevels;
+  unsigned int  m_NumberOfSmoothingIterations;
+  SizeValueType m_CoarsestLevelSize;
+  ValueType     m_SmootherWeight;
+
+  const OperatorType *  m_FineOperator;
+  KernelsType           m_SerialKernels;
+  const KernelsType *   m_Kernels;
+  mutable std::vector< Level > m_Levels;
+  CoarseSolverType      m_CoarseSolver;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkLaplaceMultigridPreconditioner.hxx"
+#endif
+
+#endif
@@ -0,0 +1,360 @@
+#ifndef itkLaplaceMultigridPreconditioner_hxx_included
+#define itkLaplaceMultigridPreconditioner_hxx_included
+
+#include "itkLaplaceMultigridPreconditioner.h"
+
+#include "itkMacro.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace itk
+{
+
+template< typename TValue >
+LaplaceMultigridPreconditioner< TValue >
+::LaplaceMultigridPreconditioner()
+{
+  m_Cycle = V_CYCLE;
+  m_MaximumNumberOfLevels = 0;
+  m_NumberOfSmoothingIterations = 2;
+  m_CoarsestLevelSize = 4096;
+  m_SmootherWeight = 2.0 / 3.0;
+  m_FineOperator = 0;
+  m_Kernels = &m_SerialKernels;
+}
+
+template< typename TValue >
+void
+LaplaceMultigridPreconditioner< TValue >
+::Compute( const OperatorType & fineOperator,
+           const SizeValueType gridSize[3],
+           const ValueType spacing[3],
+           const OffsetListType & unknownOffsets,
+           const OffsetListType & dirichletOffsets )
+{
+  m_FineOperator = &fineOperator;
+  m_Levels.clear();
+  m_Levels.push_back( Level() );
+
+  SizeValueType size[3] = { gridSize[0], gridSize[1], gridSize[2] };
+  ValueType inverseSpacingSquared[3];
+  for ( unsigned int d = 0; d < 3; ++d )
+    {
+    inverseSpacingSquared[d] = 1.0 / ( spacing[d] * spacing[d] );
+    }
+
+  OffsetListType unknowns( unknownOffsets );
+  OffsetListType dirichlet( dirichletOffsets );
+
+  while ( m_MaximumNumberOfLevels == 0 ||
+          m_Levels.size() < m_MaximumNumberOfLevels )
+    {
+    SizeValueType numberOfUnknowns = unknowns.size();
+    if ( numberOfUnknowns <= m_CoarsestLevelSize )
+      {
+      break;
+      }
+
+    SizeValueType coarseSize[3];
+    OffsetListType coarseUnknowns;
+    OffsetListType coarseDirichlet;
+    std::vector< UnknownIndexType > coarseUnknown;
+    this->Coarsen( size, unknowns, dirichlet,
+                   coarseSize, coarseUnknowns, coarseDirichlet, coarseUnknown );
+
+    // Stop if coarsening no longer reduces the problem
+    if ( coarseUnknowns.empty() ||
+         coarseUnknowns.size() >= numberOfUnknowns )
+      {
+      break;
+      }
+
+    m_Levels.back().CoarseUnknown.swap( coarseUnknown );
+
+    for ( unsigned int d = 0; d < 3; ++d )
+      {
+      size[d] = coarseSize[d];
+      inverseSpacingSquared[d] *= 0.25;
+      }
+    unknowns.swap( coarseUnknowns );
+    dirichlet.swap( coarseDirichlet );
+
+    m_Levels.push_back( Level() );
+    this->BuildOperator( size, inverseSpacingSquared, unknowns, dirichlet,
+                         m_Levels.back().Operator );
+    }
+
+  for ( unsigned int level = 0; level < m_Levels.size(); ++level )
+    {
+    const VectorType & diagonal = this->GetOperator( level ).GetDiagonal();
+    Level & current = m_Levels[level];
+    current.SmootherDiagonal.resize( diagonal.size() );
+    for ( typename VectorType::Index i = 0; i < diagonal.size(); ++i )
+      {
+      current.SmootherDiagonal[i] =
+        diagonal[i] != 0.0 ? m_SmootherWeight / diagonal[i] : 0.0;
+      }
+    current.Rhs.resize( diagonal.size() );
+    current.Solution.resize( diagonal.size() );
+    current.Residual.resize( diagonal.size() );
+    }
+
+  // Factor the coarsest operator
+  const unsigned int coarsest = this->GetNumberOfLevels() - 1;
+  const OperatorType & coarseOperator = this->GetOperator( coarsest );
+  const SizeValueType numberOfCoarseUnknowns = coarseOperator.GetNumberOfUnknowns();
+
+  typedef Eigen::Triplet< ValueType > TripletType;
+  std::vector< TripletType > triplets;
+  triplets.reserve( 7 * numberOfCoarseUnknowns );
+  for ( SizeValueType i = 0; i < numberOfCoarseUnknowns; ++i )
+    {
+    triplets.push_back( TripletType( i, i, coarseOperator.GetDiagonal()[i] ) );
+    for ( unsigned int n = 0; n < OperatorType::NumberOfNeighbors; ++n )
+      {
+      UnknownIndexType j = coarseOperator.GetNeighbor( i, n );
+      if ( j >= 0 )
+        {
+        triplets.push_back( TripletType( i, j, coarseOperator.GetNeighborWeight( n ) ) );
+        }
+      }
+    }
+
+  CoarseMatrixType coarseMatrix( numberOfCoarseUnknowns, numberOfCoarseUnknowns );
+  coarseMatrix.setFromTriplets( triplets.begin(), triplets.end() );
+  m_CoarseSolver.compute( coarseMatrix );
+  if ( m_CoarseSolver.info() != Eigen::Success )
+    {
+    // E.g. a singular coarse operator from a component of the airway
+    // without Dirichlet boundary
+    itkGenericExceptionMacro( << "Failed to factor the coarsest multigrid operator of "
+                              << numberOfCoarseUnknowns << " unknowns." );
+    }
+}
+
+template< typename TValue >
+void
+LaplaceMultigridPreconditioner< TValue >
+::Coarsen( const SizeValueType fineSize[3],
+           const OffsetListType & fineUnknowns,
+           const OffsetListType & fineDirichlet,
+           SizeValueType coarseSize[3],
+           OffsetListType & coarseUnknowns,
+           OffsetListType & coarseDirichlet,
+           std::vector< UnknownIndexType > & coarseUnknown ) const
+{
+  for ( unsigned int d = 0; d < 3; ++d )
+    {
+    coarseSize[d] = ( fineSize[d] + 1 ) / 2;
+    }
+
+  const OffsetValueType fineSliceSize =
+    static_cast< OffsetValueType >( fineSize[0] * fineSize[1] );
+
+  // Parent voxel offset of each fine unknown
+  OffsetListType parents( fineUnknowns.size() );
+  for ( SizeValueType i = 0; i < fineUnknowns.size(); ++i )
+    {
+    OffsetValueType offset = fineUnknowns[i];
+    OffsetValueType z = offset / fineSliceSize;
+    OffsetValueType y = ( offset % fineSliceSize ) / fineSize[0];
+    OffsetValueType x = offset % fineSize[0];
+    parents[i] = static_cast< OffsetType >(
+      ( x / 2 ) + coarseSize[0] * ( ( y / 2 ) + coarseSize[1] * ( z / 2 ) ) );
+    }
+
+  coarseDirichlet.resize( fineDirichlet.size() );
+  for ( SizeValueType i = 0; i < fineDirichlet.size(); ++i )
+    {
+    OffsetValueType offset = fineDirichlet[i];
+    OffsetValueType z = offset / fineSliceSize;
+    OffsetValueType y = ( offset % fineSliceSize ) / fineSize[0];
+    OffsetValueType x = offset % fineSize[0];
+    coarseDirichlet[i] = static_cast< OffsetType >(
+      ( x / 2 ) + coarseSize[0] * ( ( y / 2 ) + coarseSize[1] * ( z / 2 ) ) );
+    }
+  std::sort( coarseDirichlet.begin(), coarseDirichlet.end() );
+  coarseDirichlet.erase( std::unique( coarseDirichlet.begin(), coarseDirichlet.end() ),
+                         coarseDirichlet.end() );
+
+  // Coarse unknowns are the parents that do not contain a Dirichlet
+  // voxel
+  OffsetListType sortedParents( parents );
+  std::sort( sortedParents.begin(), sortedParents.end() );
+  sortedParents.erase( std::unique( sortedParents.begin(), sortedParents.end() ),
+                       sortedParents.end() );
+
+  coarseUnknowns.clear();
+  coarseUnknowns.reserve( sortedParents.size() );
+  std::set_difference( sortedParents.begin(), sortedParents.end(),
+                       coarseDirichlet.begin(), coarseDirichlet.end(),
+                       std::back_inserter( coarseUnknowns ) );
+
+  coarseUnknown.resize( fineUnknowns.size() );
+  for ( SizeValueType i = 0; i < fineUnknowns.size(); ++i )
+    {
+    typename OffsetListType::const_iterator iter =
+      std::lower_bound( coarseUnknowns.begin(), coarseUnknowns.end(), parents[i] );
+    if ( iter != coarseUnknowns.end() && *iter == parents[i] )
+      {
+      coarseUnknown[i] = static_cast< UnknownIndexType >( iter - coarseUnknowns.begin() );
+      }
+    else
+      {
+      coarseUnknown[i] = -1;
+      }
+    }
+}
+
+template< typename TValue >
+void
+LaplaceMultigridPreconditioner< TValue >
+::BuildOperator( const SizeValueType size[3],
+                 const ValueType inverseSpacingSquared[3],
+                 const OffsetListType & unknowns,
+                 const OffsetListType & dirichlet,
+                 OperatorType & op ) const
+{
+  op.Initialize( unknowns.size(), inverseSpacingSquared );
+
+  const OffsetValueType stride[3] = {
+    1,
+    static_cast< OffsetValueType >( size[0] ),
+    static_cast< OffsetValueType >( size[0] * size[1] ) };
+
+  for ( SizeValueType i = 0; i < unknowns.size(); ++i )
+    {
+    OffsetValueType offset = unknowns[i];
+    OffsetValueType position[3];
+    position[2] = offset / stride[2];
+    position[1] = ( offset % stride[2] ) / stride[1];
+    position[0] = offset % stride[1];
+
+    for ( unsigned int n = 0; n < OperatorType::NumberOfNeighbors; ++n )
+      {
+      unsigned int d = n / 2;
+      OffsetValueType step = ( n % 2 == 0 ) ? 1 : -1;
+      OffsetValueType neighborPosition = position[d] + step;
+
+      // Voxels outside the grid act as Neumann voxels, like the
+      // clamped neighbors on the finest level.
+      if ( neighborPosition < 0 ||
+           neighborPosition >= static_cast< OffsetValueType >( size[d] ) )
+        {
+        op.AddToDiagonal( i, inverseSpacingSquared[d] );
+        continue;
+        }
+
+      OffsetValueType neighborOffset = offset + step * stride[d];
+      typename OffsetListType::const_iterator iter =
+        std::lower_bound( unknowns.begin(), unknowns.end(), neighborOffset );
+      if ( iter != unknowns.end() && *iter == neighborOffset )
+        {
+        op.SetNeighbor( i, n, static_cast< UnknownIndexType >( iter - unknowns.begin() ) );
+        }
+      else if ( !std::binary_search( dirichlet.begin(), dirichlet.end(), neighborOffset ) )
+        {
+        // Neumann voxel. Dirichlet voxels contribute nothing because
+        // the coarse grid corrections vanish on them.
+        op.AddToDiagonal( i, inverseSpacingSquared[d] );
+        }
+      }
+    }
+}
+
+template< typename TValue >
+void
+LaplaceMultigridPreconditioner< TValue >
+::Solve( const VectorType & r, VectorType & z ) const
+{
+  z.resize( r.size() );
+  z.setZero();
+  this->Cycle( 0, m_Cycle, r, z );
+}
+
+template< typename TValue >
+void
+LaplaceMultigridPreconditioner< TValue >
+::Cycle( unsigned int level, CycleType cycle,
+         const VectorType & b, VectorType & x ) const
+{
+  if ( level + 1 == this->GetNumberOfLevels() )
+    {
+    x = m_CoarseSolver.solve( b );
+    return;
+    }
+
+  Level & current = m_Levels[level];
+  Level & coarse  = m_Levels[level + 1];
+  const OperatorType & op = this->GetOperator( level );
+
+  this->Smooth( level, b, x );
+
+  // Restrict the residual by averaging over the children
+  m_Kernels->Residual( op, b, x, current.Residual );
+
+  coarse.Rhs.setZero();
+  for ( SizeValueType i = 0; i < current.CoarseUnknown.size(); ++i )
+    {
+    UnknownIndexType j = current.CoarseUnknown[i];
+    if ( j >= 0 )
+      {
+      coarse.Rhs[j] += current.Residual[i];
+      }
+    }
+  coarse.Rhs *= 0.125;
+
+  coarse.Solution.setZero();
+  this->Cycle( level + 1, cycle, coarse.Rhs, coarse.Solution );
+  if ( cycle == F_CYCLE )
+    {
+    this->Cycle( level + 1, V_CYCLE, coarse.Rhs, coarse.Solution );
+    }
+
+  // Prolongate the correction by injection
+  ProlongateFunctor prolongate;
+  prolongate.CoarseUnknown = &current.CoarseUnknown;
+  prolongate.Correction = &coarse.Solution;
+  prolongate.X = &x;
+  m_Kernels->Execute( current.CoarseUnknown.size(), prolongate );
+
+  this->Smooth( level, b, x );
+}
+
+template< typename TValue >
+void
+LaplaceMultigridPreconditioner< TValue >
+::Smooth( unsigned int level, const VectorType & b, VectorType & x ) const
+{
+  Level & current = m_Levels[level];
+  const OperatorType & op = this->GetOperator( level );
+
+  for ( unsigned int iteration = 0; iteration < m_NumberOfSmoothingIterations; ++iteration )
+    {
+    m_Kernels->Apply( op, x, current.Residual );
+    m_Kernels->AddScaledDifference( current.SmootherDiagonal, b, current.Residual, x );
+    }
+}
+
+template< typename TValue >
+void
+LaplaceMultigridPreconditioner< TValue >::ProlongateFunctor
+::operator()( SizeValueType, SizeValueType begin, SizeValueType end )
+{
+  const std::vector< UnknownIndexType > & coarseUnknown = *CoarseUnknown;
+  const VectorType & correction = *Correction;
+  VectorType & x = *X;
+  for ( SizeValueType i = begin; i < end; ++i )
+    {
+    UnknownIndexType j = coarseUnknown[i];
+    if ( j >= 0 )
+      {
+      x[i] += correction[j];
+      }
+    }
+}
+
+} // end namespace itk
+
+#endif
@@ -0,0 +1,176 @@
+#ifndef itkLaplaceStencilOperator_h_included
+#define itkLaplaceStencilOperator_h_included
+
+#include "itkLaplaceVectorKernels.h"
+
+#include <itkIntTypes.h>
+#include <itkMacro.h>
+
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+
+#include <vector>
+
+
+namespace itk
+{
+
+/** \class LaplaceStencilOperator
+ * \brief Applies the 7-point discrete Laplacian over a set of
+ * unknown voxels without assembling a sparse matrix.
+ *
+ * Only the indices of the six face neighbors of each unknown and the
+ * diagonal of the operator are stored. The off-diagonal coefficients
+ * are the inverse squared voxel spacings along each axis. Neighbors
+ * that are not unknowns (Neumann or Dirichlet voxels) are stored as
+ * -1; their contributions are folded into the diagonal and the
+ * right-hand side when the operator is set up.
+ *
+ * Neighbors are ordered +x, -x, +y, -y, +z, -z. */
+template< typename TValue >
+class LaplaceStencilOperator
+{
+public:
+  typedef LaplaceStencilOperator                    Self;
+  typedef TValue                                    ValueType;
+  typedef Eigen::Matrix< TValue, Eigen::Dynamic, 1 > VectorType;
+  typedef int32_t                                   UnknownIndexType;
+
+  itkStaticConstMacro( NumberOfNeighbors, unsigned int, 6 );
+
+  LaplaceStencilOperator();
+
+  /** Allocate storage for the given number of unknowns. The
+   *  diagonal is initialized to the central stencil weight and all
+   *  neighbors are marked as not being unknowns. */
+  void Initialize( SizeValueType numberOfUnknowns,
+                   const ValueType inverseSpacingSquared[3] );
+
+  SizeValueType GetNumberOfUnknowns() const
+  { return static_cast< SizeValueType >( m_Diagonal.size() ); }
+
+  /** Set the unknown index of neighbor n of unknown i. */
+  void SetNeighbor( SizeValueType i, unsigned int n, UnknownIndexType j )
+  { m_Neighbors[ NumberOfNeighbors * i + n ] = j; }
+
+  UnknownIndexType GetNeighbor( SizeValueType i, unsigned int n ) const
+  { return m_Neighbors[ NumberOfNeighbors * i + n ]; }
+
+  /** Add a value to the diagonal entry of unknown i. */
+  void AddToDiagonal( SizeValueType i, ValueType value )
+  { m_Diagonal[i] += value; }
+
+  const VectorType & GetDiagonal() const
+  { return m_Diagonal; }
+
+  /** Weight of neighbor n, i.e., the inverse squared spacing along
+   *  the axis of that neighbor. */
+  ValueType GetNeighborWeight( unsigned int n ) const
+  { return m_InverseSpacingSquared[ n / 2 ]; }
+
+  /** Compute y = A x. */
+  void Apply( const VectorType & x, VectorType & y ) const;
+
+  /** Compute entries [begin, end) of y = A x. y must already have
+   *  the right size. */
+  void ApplyRange( const VectorType & x, VectorType & y,
+                   SizeValueType begin, SizeValueType end ) const;
+
+private:
+  std::vector< UnknownIndexType > m_Neighbors;
+  VectorType                      m_Diagonal;
+  ValueType                       m_InverseSpacingSquared[3];
+};
+
+
+/** \class LaplaceSparseMatrixOperator
+ * \brief Applies an assembled row-major sparse matrix.
+ *
+ * Gives the assembled matrix the same interface as
+ * LaplaceStencilOperator so both can be used with
+ * LaplaceVectorKernels. The matrix is referenced, not copied. */
+template< typename TValue >
+class LaplaceSparseMatrixOperator
+{
+public:
+  typedef LaplaceSparseMatrixOperator                    Self;
+  typedef Eigen::SparseMatrix< TValue, Eigen::RowMajor > MatrixType;
+  typedef Eigen::Matrix< TValue, Eigen::Dynamic, 1 >     VectorType;
+
+  explicit LaplaceSparseMatrixOperator( const MatrixType & matrix ) :
+    m_Matrix( matrix ) {}
+
+  SizeValueType GetNumberOfUnknowns() const
+  { return static_cast< SizeValueType >( m_Matrix.rows() ); }
+
+  VectorType GetDiagonal() const
+  { return m_Matrix.diagonal(); }
+
+  /** Compute entries [begin, end) of y = A x. The matrix must be
+   *  compressed. */
+  void ApplyRange( const VectorType & x, VectorType & y,
+                   SizeValueType begin, SizeValueType end ) const;
+
+private:
+  /** The index type of the compressed storage differs between Eigen
+   *  versions, so it is deduced here. */
+  template< typename TIndex >
+  static void ApplyRows( const TIndex * outer, const TIndex * inner,
+                         const TValue * values,
+                         const VectorType & x, VectorType & y,
+                         SizeValueType begin, SizeValueType end );
+
+  const MatrixType & m_Matrix;
+};
+
+
+/** \class LaplaceJacobiPreconditioner
+ * \brief Diagonal preconditioner for LaplaceStencilOperator and
+ * LaplaceSparseMatrixOperator.
+ *
+ * Equivalent to Eigen::DiagonalPreconditioner, which is what
+ * Eigen::ConjugateGradient uses by default. */
+template< typename TValue >
+class LaplaceJacobiPreconditioner
+{
+public:
+  typedef Eigen::Matrix< TValue, Eigen::Dynamic, 1 > VectorType;
+  typedef LaplaceVectorKernels< TValue >             KernelsType;
+
+  LaplaceJacobiPreconditioner() : m_Kernels( 0 ) {}
+
+  /** Set the kernels used to apply the preconditioner. Without
+   *  kernels it is applied in the calling thread. */
+  void SetKernels( const KernelsType * kernels )
+  { m_Kernels = kernels; }
+
+  void Compute( const VectorType & diagonal );
+
+  /** Compute z = M^-1 r. */
+  void Solve( const VectorType & r, VectorType & z ) const
+  {
+    if ( m_Kernels )
+      {
+      m_Kernels->CwiseProduct( m_InverseDiagonal, r, z );
+      }
+    else
+      {
+      z = m_InverseDiagonal.cwiseProduct( r );
+      }
+  }
+
+  bool IsSymmetric() const
+  { return true; }
+
+private:
+  VectorType          m_InverseDiagonal;
+  const KernelsType * m_Kernels;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkLaplaceStencilOperator.hxx"
+#endif
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef itkLaplaceStencilOperator_hxx_included
+#define itkLaplaceStencilOperator_hxx_included
+
+#include "itkLaplaceStencilOperator.h"
+
+namespace itk
+{
+
+template< typename TValue >
+LaplaceStencilOperator< TValue >
+::LaplaceStencilOperator()
+{
+  m_InverseSpacingSquared[0] = 0.0;
+  m_InverseSpacingSquared[1] = 0.0;
+  m_InverseSpacingSquared[2] = 0.0;
+}
+
+template< typename TValue >
+void
+LaplaceStencilOperator< TValue >
+::Initialize( SizeValueType numberOfUnknowns,
+              const ValueType inverseSpacingSquared[3] )
+{
+  ValueType centerWeight = 0.0;
+  for ( unsigned int i = 0; i < 3; ++i )
+    {
+    m_InverseSpacingSquared[i] = inverseSpacingSquared[i];
+    centerWeight -= 2.0 * inverseSpacingSquared[i];
+    }
+
+  m_Neighbors.assign( NumberOfNeighbors * numberOfUnknowns, -1 );
+  m_Diagonal.resize( numberOfUnknowns );
+  m_Diagonal.fill( centerWeight );
+}
+
+template< typename TValue >
+void
+LaplaceStencilOperator< TValue >
+::Apply( const VectorType & x, VectorType & y ) const
+{
+  y.resize( this->GetNumberOfUnknowns() );
+  this->ApplyRange( x, y, 0, this->GetNumberOfUnknowns() );
+}
+
+template< typename TValue >
+void
+LaplaceStencilOperator< TValue >
+::ApplyRange( const VectorType & x, VectorType & y,
+              SizeValueType begin, SizeValueType end ) const
+{
+  if ( begin >= end )
+    {
+    return;
+    }
+
+  const UnknownIndexType * neighbors = &m_Neighbors[ NumberOfNeighbors * begin ];
+  for ( SizeValueType i = begin; i < end; ++i )
+    {
+    ValueType sum = m_Diagonal[i] * x[i];
+    for ( unsigned int n = 0; n < NumberOfNeighbors; ++n )
+      {
+      UnknownIndexType j = neighbors[n];
+      if ( j >= 0 )
+        {
+        sum += m_InverseSpacingSquared[ n / 2 ] * x[j];
+        }
+      }
+    y[i] = sum;
+    neighbors += NumberOfNeighbors;
+    }
+}
+
+template< typename TValue >
+void
+LaplaceSparseMatrixOperator< TValue >
+::ApplyRange( const VectorType & x, VectorType & y,
+              SizeValueType begin, SizeValueType end ) const
+{
+  Self::ApplyRows( m_Matrix.outerIndexPtr(), m_Matrix.innerIndexPtr(),
+                   m_Matrix.valuePtr(), x, y, begin, end );
+}
+
+template< typename TValue >
+template< typename TIndex >
+void
+LaplaceSparseMatrixOperator< TValue >
+::ApplyRows( const TIndex * outer, const TIndex * inner, const TValue * values,
+             const VectorType & x, VectorType & y,
+             SizeValueType begin, SizeValueType end )
+{
+  for ( SizeValueType i = begin; i < end; ++i )
+    {
+    TValue sum = 0.0;
+    for ( TIndex k = outer[i]; k < outer[i+1]; ++k )
+      {
+      sum += values[k] * x[ inner[k] ];
+      }
+    y[i] = sum;
+    }
+}
+
+template< typename TValue >
+void
+LaplaceJacobiPreconditioner< TValue >
+::Compute( const VectorType & diagonal )
+{
+  m_InverseDiagonal.resize( diagonal.size() );
+  for ( typename VectorType::Index i = 0; i < diagonal.size(); ++i )
+    {
+    m_InverseDiagonal[i] = diagonal[i] != 0.0 ? 1.0 / diagonal[i] : 1.0;
+    }
+}
+
+} // end namespace itk
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef itkLaplaceUnknownIndexMap_h_included
+#define itkLaplaceUnknownIndexMap_h_included
+
+#include <itkIntTypes.h>
+#include <itkMacro.h>
+
+#include <vector>
+
+
+namespace itk
+{
+
+/** \class LaplaceUnknownIndexMap
+ * \brief Compact mapping between the voxels carrying a given label
+ * and the unknowns of the Laplace system.
+ *
+ * Unknowns are numbered in raster order. Each unknown is stored as a
+ * 32-bit linear offset into the image buffer. The reverse mapping is
+ * a run-length index: for each scanline along the first axis the
+ * runs of labeled voxels are recorded together with the number of
+ * their first unknown. Memory therefore scales with the number of
+ * unknowns and scanlines instead of the number of voxels.
+ *
+ * The map can be built with several threads. Each thread numbers a
+ * contiguous block of scanlines after the unknowns in the preceding
+ * blocks have been counted, so the numbering is always the raster
+ * order. */
+template< typename TImage >
+class LaplaceUnknownIndexMap
+{
+public:
+  typedef LaplaceUnknownIndexMap         Self;
+  typedef TImage                         ImageType;
+  typedef typename TImage::PixelType     PixelType;
+  typedef typename TImage::IndexType     IndexType;
+  typedef typename TImage::RegionType    RegionType;
+  typedef uint32_t                       OffsetType;
+  typedef int32_t                        UnknownIndexType;
+  typedef std::vector< OffsetType >      OffsetListType;
+
+  LaplaceUnknownIndexMap();
+
+  /** Number the voxels of the image's buffered region with the given
+   *  label. The image is scanned serially with one thread. */
+  void Build( const ImageType * image, PixelType label,
+              ThreadIdType numberOfThreads = 1 );
+
+  /** Number the voxels for which predicate( pixel ) is true. */
+  template< typename TPredicate >
+  void BuildWithPredicate( const ImageType * image, const TPredicate & predicate,
+                           ThreadIdType numberOfThreads = 1 );
+
+  /** Get the region the offsets refer to. */
+  const RegionType & GetRegion() const
+  { return m_Region; }
+
+  SizeValueType GetNumberOfUnknowns() const
+  { return static_cast< SizeValueType >( m_Offsets.size() ); }
+
+  /** Get the linear offset of unknown i in the image buffer. */
+  OffsetType GetOffset( SizeValueType i ) const
+  { return m_Offsets[i]; }
+
+  /** Get the linear offsets of all unknowns in increasing order. */
+  const OffsetListType & GetOffsets() const
+  { return m_Offsets; }
+
+  /** Get the image index of unknown i. */
+  IndexType GetIndex( SizeValueType i ) const;
+
+  /** Get the unknown at the given image index or linear offset, or
+   *  -1 if that voxel is not an unknown. */
+  UnknownIndexType GetUnknownIndex( const IndexType & index ) const;
+  UnknownIndexType GetUnknownIndex( OffsetType offset ) const;
+
+  SizeValueType GetNumberOfRuns() const
+  { return static_cast< SizeValueType >( m_Runs.size() ); }
+
+private:
+  struct Run
+  {
+    OffsetType       Begin;
+    OffsetType       End;
+    UnknownIndexType FirstUnknown;
+  };
+
+  struct LabelPredicate
+  {
+    PixelType Label;
+    bool operator()( const PixelType & pixel ) const
+    { return pixel == Label; }
+  };
+
+  /** First pass: count the unknowns and runs in a block of rows. */
+  template< typename TPredicate >
+  struct CountFunctor
+  {
+    const PixelType *            Buffer;
+    const TPredicate *           Predicate;
+    OffsetValueType              RowLength;
+    std::vector< SizeValueType > NumberOfUnknowns;
+    std::vector< SizeValueType > NumberOfRuns;
+
+    void operator()( SizeValueType chunk, SizeValueType beginRow, SizeValueType endRow );
+  };
+
+  /** Second pass: store the unknowns and runs of a block of rows
+   *  starting at the positions found by the first pass. */
+  template< typename TPredicate >
+  struct FillFunctor
+  {
+    Self *                       Map;
+    const PixelType *            Buffer;
+    const TPredicate *           Predicate;
+    OffsetValueType              RowLength;
+    std::vector< SizeValueType > FirstUnknown;
+    std::vector< SizeValueType > FirstRun;
+
+    void operator()( SizeValueType chunk, SizeValueType beginRow, SizeValueType endRow );
+  };
+
+  RegionType                  m_Region;
+  OffsetValueType             m_OffsetTable[ TImage::ImageDimension + 1 ];
+  OffsetListType              m_Offsets;
+  std::vector< Run >          m_Runs;
+  std::vector< uint32_t >     m_RowRunStart;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkLaplaceUnknownIndexMap.hxx"
+#endif
+
+#endif
@@ -0,0 +1,242 @@
+#ifndef itkLaplaceUnknownIndexMap_hxx_included
+#define itkLaplaceUnknownIndexMap_hxx_included
+
+#include "itkLaplaceUnknownIndexMap.h"
+#include "itkThreadedRange.h"
+
+#include <limits>
+
+namespace itk
+{
+
+template< typename TImage >
+LaplaceUnknownIndexMap< TImage >
+::LaplaceUnknownIndexMap()
+{
+  for ( unsigned int d = 0; d <= TImage::ImageDimension; ++d )
+    {
+    m_OffsetTable[d] = 0;
+    }
+}
+
+template< typename TImage >
+void
+LaplaceUnknownIndexMap< TImage >
+::Build( const ImageType * image, PixelType label,
+         ThreadIdType numberOfThreads )
+{
+  LabelPredicate predicate;
+  predicate.Label = label;
+  this->BuildWithPredicate( image, predicate, numberOfThreads );
+}
+
+template< typename TImage >
+template< typename TPredicate >
+void
+LaplaceUnknownIndexMap< TImage >
+::BuildWithPredicate( const ImageType * image, const TPredicate & predicate,
+                      ThreadIdType numberOfThreads )
+{
+  m_Region = image->GetBufferedRegion();
+  m_Offsets.clear();
+  m_Runs.clear();
+  m_RowRunStart.clear();
+
+  m_OffsetTable[0] = 1;
+  for ( unsigned int d = 0; d < TImage::ImageDimension; ++d )
+    {
+    m_OffsetTable[d+1] = m_OffsetTable[d] *
+      static_cast< OffsetValueType >( m_Region.GetSize()[d] );
+    }
+
+  const OffsetValueType numberOfPixels = m_OffsetTable[ TImage::ImageDimension ];
+  if ( numberOfPixels >
+       static_cast< OffsetValueType >( std::numeric_limits< OffsetType >::max() ) )
+    {
+    itkGenericExceptionMacro( << "Image with " << numberOfPixels
+                              << " voxels is too large for 32-bit offsets." );
+    }
+  if ( numberOfPixels == 0 )
+    {
+    return;
+    }
+
+  const SizeValueType numberOfRows =
+    static_cast< SizeValueType >( numberOfPixels / m_OffsetTable[1] );
+  const SizeValueType numberOfChunks =
+    ThreadedRange::GetNumberOfChunks( numberOfThreads, numberOfRows );
+
+  CountFunctor< TPredicate > counter;
+  counter.Buffer = image->GetBufferPointer();
+  counter.Predicate = &predicate;
+  counter.RowLength = m_OffsetTable[1];
+  counter.NumberOfUnknowns.resize( numberOfChunks );
+  counter.NumberOfRuns.resize( numberOfChunks );
+  ThreadedRange::Execute( numberOfChunks, numberOfRows, counter );
+
+  FillFunctor< TPredicate > filler;
+  filler.Map = this;
+  filler.Buffer = counter.Buffer;
+  filler.Predicate = &predicate;
+  filler.RowLength = counter.RowLength;
+  filler.FirstUnknown.resize( numberOfChunks );
+  filler.FirstRun.resize( numberOfChunks );
+
+  SizeValueType numberOfUnknowns = 0;
+  SizeValueType numberOfRuns = 0;
+  for ( SizeValueType chunk = 0; chunk < numberOfChunks; ++chunk )
+    {
+    filler.FirstUnknown[chunk] = numberOfUnknowns;
+    filler.FirstRun[chunk] = numberOfRuns;
+    numberOfUnknowns += counter.NumberOfUnknowns[chunk];
+    numberOfRuns += counter.NumberOfRuns[chunk];
+    }
+
+  if ( numberOfUnknowns >
+       static_cast< SizeValueType >( std::numeric_limits< UnknownIndexType >::max() ) )
+    {
+    itkGenericExceptionMacro( << "Too many unknowns for 32-bit indices." );
+    }
+
+  m_Offsets.resize( numberOfUnknowns );
+  m_Runs.resize( numberOfRuns );
+  m_RowRunStart.resize( numberOfRows + 1 );
+  m_RowRunStart[ numberOfRows ] = static_cast< uint32_t >( numberOfRuns );
+  ThreadedRange::Execute( numberOfChunks, numberOfRows, filler );
+}
+
+template< typename TImage >
+template< typename TPredicate >
+void
+LaplaceUnknownIndexMap< TImage >::CountFunctor< TPredicate >
+::operator()( SizeValueType chunk, SizeValueType beginRow, SizeValueType endRow )
+{
+  SizeValueType unknowns = 0;
+  SizeValueType runs = 0;
+  for ( SizeValueType row = beginRow; row < endRow; ++row )
+    {
+    const PixelType * pixel = Buffer + row * RowLength;
+    bool inRun = false;
+    for ( OffsetValueType x = 0; x < RowLength; ++x, ++pixel )
+      {
+      bool isUnknown = ( *Predicate )( *pixel );
+      if ( isUnknown )
+        {
+        ++unknowns;
+        if ( !inRun )
+          {
+          ++runs;
+          }
+        }
+      inRun = isUnknown;
+      }
+    }
+  NumberOfUnknowns[chunk] = unknowns;
+  NumberOfRuns[chunk] = runs;
+}
+
+template< typename TImage >
+template< typename TPredicate >
+void
+LaplaceUnknownIndexMap< TImage >::FillFunctor< TPredicate >
+::operator()( SizeValueType chunk, SizeValueType beginRow, SizeValueType endRow )
+{
+  SizeValueType unknown = FirstUnknown[chunk];
+  SizeValueType run = FirstRun[chunk];
+  for ( SizeValueType row = beginRow; row < endRow; ++row )
+    {
+    Map->m_RowRunStart[row] = static_cast< uint32_t >( run );
+
+    OffsetValueType offset = static_cast< OffsetValueType >( row ) * RowLength;
+    const OffsetValueType rowEnd = offset + RowLength;
+    while ( offset < rowEnd )
+      {
+      if ( !( *Predicate )( Buffer[offset] ) )
+        {
+        ++offset;
+        continue;
+        }
+
+      Run & current = Map->m_Runs[run++];
+      current.Begin = static_cast< OffsetType >( offset );
+      current.FirstUnknown = static_cast< UnknownIndexType >( unknown );
+      while ( offset < rowEnd && ( *Predicate )( Buffer[offset] ) )
+        {
+        Map->m_Offsets[unknown++] = static_cast< OffsetType >( offset );
+        ++offset;
+        }
+      current.End = static_cast< OffsetType >( offset );
+      }
+    }
+}
+
+template< typename TImage >
+typename LaplaceUnknownIndexMap< TImage >::IndexType
+LaplaceUnknownIndexMap< TImage >
+::GetIndex( SizeValueType i ) const
+{
+  OffsetValueType offset = m_Offsets[i];
+  IndexType index = m_Region.GetIndex();
+  for ( int d = TImage::ImageDimension - 1; d >= 0; --d )
+    {
+    index[d] += offset / m_OffsetTable[d];
+    offset %= m_OffsetTable[d];
+    }
+  return index;
+}
+
+template< typename TImage >
+typename LaplaceUnknownIndexMap< TImage >::UnknownIndexType
+LaplaceUnknownIndexMap< TImage >
+::GetUnknownIndex( const IndexType & index ) const
+{
+  if ( !m_Region.IsInside( index ) )
+    {
+    return -1;
+    }
+
+  OffsetValueType offset = 0;
+  for ( unsigned int d = 0; d < TImage::ImageDimension; ++d )
+    {
+    offset += ( index[d] - m_Region.GetIndex()[d] ) * m_OffsetTable[d];
+    }
+  return this->GetUnknownIndex( static_cast< OffsetType >( offset ) );
+}
+
+template< typename TImage >
+typename LaplaceUnknownIndexMap< TImage >::UnknownIndexType
+LaplaceUnknownIndexMap< TImage >
+::GetUnknownIndex( OffsetType offset ) const
+{
+  if ( m_RowRunStart.empty() )
+    {
+    return -1;
+    }
+
+  const OffsetValueType row = offset / m_OffsetTable[1];
+  if ( row + 1 >= static_cast< OffsetValueType >( m_RowRunStart.size() ) )
+    {
+    return -1;
+    }
+
+  // Rows of a segmented image rarely hold more than a few runs, so a
+  // linear scan is cheaper than a binary search here.
+  const uint32_t last = m_RowRunStart[row+1];
+  for ( uint32_t r = m_RowRunStart[row]; r < last; ++r )
+    {
+    const Run & run = m_Runs[r];
+    if ( offset < run.Begin )
+      {
+      break;
+      }
+    if ( offset < run.End )
+      {
+      return run.FirstUnknown + static_cast< UnknownIndexType >( offset - run.Begin );
+      }
+    }
+  return -1;
+}
+
+} // end namespace itk
+
+#endif
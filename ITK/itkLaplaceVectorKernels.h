@@ -0,0 +1,189 @@
+#ifndef itkLaplaceVectorKernels_h_included
+#define itkLaplaceVectorKernels_h_included
+
+#include "itkThreadedRange.h"
+
+#include <itkIntTypes.h>
+#include <itkNumericTraits.h>
+
+#include <Eigen/Core>
+
+#include <vector>
+
+
+namespace itk
+{
+
+/** \class LaplaceVectorKernels
+ * \brief Multithreaded operator application and vector updates for
+ * the conjugate gradient and multigrid solvers of the Laplace filter.
+ *
+ * Vectors are split into blocks of BlockSize entries. Dot products are
+ * summed per block and the block sums are added in block order, so
+ * results do not depend on the number of threads. Vectors that fit in
+ * a single block are processed in the calling thread.
+ *
+ * The kernels fuse operations that would otherwise each need a pass
+ * over memory, e.g., the operator application with the dot product
+ * needed for the step length.
+ *
+ * Operators must provide ApplyRange( x, y, begin, end ), which computes
+ * entries [begin, end) of y = A x into an already sized y. */
+template< typename TValue >
+class LaplaceVectorKernels
+{
+public:
+  typedef LaplaceVectorKernels                               Self;
+  typedef TValue                                             ValueType;
+  typedef typename NumericTraits< TValue >::AccumulateType   AccumulateType;
+  typedef Eigen::Matrix< TValue, Eigen::Dynamic, 1 >         VectorType;
+
+  itkStaticConstMacro( BlockSize, SizeValueType, 16384 );
+
+  LaplaceVectorKernels();
+
+  /** Set/get the number of threads. With one thread everything runs
+   *  in the calling thread. */
+  void SetNumberOfThreads( ThreadIdType numberOfThreads )
+  { m_NumberOfThreads = numberOfThreads > 0 ? numberOfThreads : 1; }
+  ThreadIdType GetNumberOfThreads() const
+  { return m_NumberOfThreads; }
+
+  /** Run functor( block, begin, end ) over the blocks of [0, size). */
+  template< typename TFunctor >
+  void Execute( SizeValueType size, TFunctor & functor ) const
+  {
+    ThreadedRange::Execute( m_NumberOfThreads,
+                            this->GetNumberOfBlocks( size ), size, functor );
+  }
+
+  SizeValueType GetNumberOfBlocks( SizeValueType size ) const
+  { return ThreadedRange::GetNumberOfFixedSizeChunks( BlockSize, size ); }
+
+  /** y = A x */
+  template< typename TOperator >
+  void Apply( const TOperator & A, const VectorType & x, VectorType & y ) const;
+
+  /** q = A p, returns p . q */
+  template< typename TOperator >
+  ValueType ApplyAndDot( const TOperator & A, const VectorType & p, VectorType & q ) const;
+
+  /** r = b - A x, returns r . r */
+  template< typename TOperator >
+  ValueType Residual( const TOperator & A, const VectorType & b,
+                      const VectorType & x, VectorType & r ) const;
+
+  /** Returns a . b */
+  ValueType Dot( const VectorType & a, const VectorType & b ) const;
+
+  /** x += alpha p, r -= alpha q, returns r . r */
+  ValueType UpdateSolutionAndResidual( ValueType alpha,
+                                       const VectorType & p, const VectorType & q,
+                                       VectorType & x, VectorType & r ) const;
+
+  /** p = z + beta p */
+  void UpdateDirection( ValueType beta, const VectorType & z, VectorType & p ) const;
+
+  /** z = d .* r */
+  void CwiseProduct( const VectorType & d, const VectorType & r, VectorType & z ) const;
+
+  /** x += d .* ( b - y ) */
+  void AddScaledDifference( const VectorType & d, const VectorType & b,
+                            const VectorType & y, VectorType & x ) const;
+
+private:
+  /** Sum block results in block order. */
+  static ValueType Sum( const std::vector< AccumulateType > & blockSums );
+
+  template< typename TOperator >
+  struct ApplyFunctor
+  {
+    const TOperator *  Operator;
+    const VectorType * X;
+    VectorType *       Y;
+
+    void operator()( SizeValueType, SizeValueType begin, SizeValueType end );
+  };
+
+  template< typename TOperator >
+  struct ApplyAndDotFunctor
+  {
+    const TOperator *             Operator;
+    const VectorType *            P;
+    VectorType *                  Q;
+    std::vector< AccumulateType > BlockSums;
+
+    void operator()( SizeValueType block, SizeValueType begin, SizeValueType end );
+  };
+
+  template< typename TOperator >
+  struct ResidualFunctor
+  {
+    const TOperator *             Operator;
+    const VectorType *            B;
+    const VectorType *            X;
+    VectorType *                  R;
+    std::vector< AccumulateType > BlockSums;
+
+    void operator()( SizeValueType block, SizeValueType begin, SizeValueType end );
+  };
+
+  struct DotFunctor
+  {
+    const VectorType *            A;
+    const VectorType *            B;
+    std::vector< AccumulateType > BlockSums;
+
+    void operator()( SizeValueType block, SizeValueType begin, SizeValueType end );
+  };
+
+  struct UpdateSolutionAndResidualFunctor
+  {
+    ValueType                     Alpha;
+    const VectorType *            P;
+    const VectorType *            Q;
+    VectorType *                  X;
+    VectorType *                  R;
+    std::vector< AccumulateType > BlockSums;
+
+    void operator()( SizeValueType block, SizeValueType begin, SizeValueType end );
+  };
+
+  struct UpdateDirectionFunctor
+  {
+    ValueType          Beta;
+    const VectorType * Z;
+    VectorType *       P;
+
+    void operator()( SizeValueType, SizeValueType begin, SizeValueType end );
+  };
+
+  struct CwiseProductFunctor
+  {
+    const VectorType * D;
+    const VectorType * R;
+    VectorType *       Z;
+
+    void operator()( SizeValueType, SizeValueType begin, SizeValueType end );
+  };
+
+  struct AddScaledDifferenceFunctor
+  {
+    const VectorType * D;
+    const VectorType * B;
+    const VectorType * Y;
+    VectorType *       X;
+
+    void operator()( SizeValueType, SizeValueType begin, SizeValueType end );
+  };
+
+  ThreadIdType m_NumberOfThreads;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkLaplaceVectorKernels.hxx"
+#endif
+
+#endif
@@ -0,0 +1,279 @@
+#ifndef itkLaplaceVectorKernels_hxx_included
+#define itkLaplaceVectorKernels_hxx_included
+
+#include "itkLaplaceVectorKernels.h"
+
+namespace itk
+{
+
+template< typename TValue >
+LaplaceVectorKernels< TValue >
+::LaplaceVectorKernels()
+{
+  m_NumberOfThreads = 1;
+}
+
+template< typename TValue >
+typename LaplaceVectorKernels< TValue >::ValueType
+LaplaceVectorKernels< TValue >
+::Sum( const std::vector< AccumulateType > & blockSums )
+{
+  AccumulateType sum = 0.0;
+  for ( SizeValueType block = 0; block < blockSums.size(); ++block )
+    {
+    sum += blockSums[block];
+    }
+  return static_cast< ValueType >( sum );
+}
+
+template< typename TValue >
+template< typename TOperator >
+void
+LaplaceVectorKernels< TValue >
+::Apply( const TOperator & A, const VectorType & x, VectorType & y ) const
+{
+  y.resize( x.size() );
+
+  ApplyFunctor< TOperator > functor;
+  functor.Operator = &A;
+  functor.X = &x;
+  functor.Y = &y;
+  this->Execute( x.size(), functor );
+}
+
+template< typename TValue >
+template< typename TOperator >
+typename LaplaceVectorKernels< TValue >::ValueType
+LaplaceVectorKernels< TValue >
+::ApplyAndDot( const TOperator & A, const VectorType & p, VectorType & q ) const
+{
+  q.resize( p.size() );
+
+  ApplyAndDotFunctor< TOperator > functor;
+  functor.Operator = &A;
+  functor.P = &p;
+  functor.Q = &q;
+  functor.BlockSums.resize( this->GetNumberOfBlocks( p.size() ) );
+  this->Execute( p.size(), functor );
+
+  return Self::Sum( functor.BlockSums );
+}
+
+template< typename TValue >
+template< typename TOperator >
+typename LaplaceVectorKernels< TValue >::ValueType
+LaplaceVectorKernels< TValue >
+::Residual( const TOperator & A, const VectorType & b,
+            const VectorType & x, VectorType & r ) const
+{
+  r.resize( b.size() );
+
+  ResidualFunctor< TOperator > functor;
+  functor.Operator = &A;
+  functor.B = &b;
+  functor.X = &x;
+  functor.R = &r;
+  functor.BlockSums.resize( this->GetNumberOfBlocks( b.size() ) );
+  this->Execute( b.size(), functor );
+
+  return Self::Sum( functor.BlockSums );
+}
+
+template< typename TValue >
+typename LaplaceVectorKernels< TValue >::ValueType
+LaplaceVectorKernels< TValue >
+::Dot( const VectorType & a, const VectorType & b ) const
+{
+  DotFunctor functor;
+  functor.A = &a;
+  functor.B = &b;
+  functor.BlockSums.resize( this->GetNumberOfBlocks( a.size() ) );
+  this->Execute( a.size(), functor );
+
+  return Self::Sum( functor.BlockSums );
+}
+
+template< typename TValue >
+typename LaplaceVectorKernels< TValue >::ValueType
+LaplaceVectorKernels< TValue >
+::UpdateSolutionAndResidual( ValueType alpha,
+                             const VectorType & p, const VectorType & q,
+                             VectorType & x, VectorType & r ) const
+{
+  UpdateSolutionAndResidualFunctor functor;
+  functor.Alpha = alpha;
+  functor.P = &p;
+  functor.Q = &q;
+  functor.X = &x;
+  functor.R = &r;
+  functor.BlockSums.resize( this->GetNumberOfBlocks( p.size() ) );
+  this->Execute( p.size(), functor );
+
+  return Self::Sum( functor.BlockSums );
+}
+
+template< typename TValue >
+void
+LaplaceVectorKernels< TValue >
+::UpdateDirection( ValueType beta, const VectorType & z, VectorType & p ) const
+{
+  UpdateDirectionFunctor functor;
+  functor.Beta = beta;
+  functor.Z = &z;
+  functor.P = &p;
+  this->Execute( z.size(), functor );
+}
+
+template< typename TValue >
+void
+LaplaceVectorKernels< TValue >
+::CwiseProduct( const VectorType & d, const VectorType & r, VectorType & z ) const
+{
+  z.resize( r.size() );
+
+  CwiseProductFunctor functor;
+  functor.D = &d;
+  functor.R = &r;
+  functor.Z = &z;
+  this->Execute( r.size(), functor );
+}
+
+template< typename TValue >
+void
+LaplaceVectorKernels< TValue >
+::AddScaledDifference( const VectorType & d, const VectorType & b,
+                       const VectorType & y, VectorType & x ) const
+{
+  AddScaledDifferenceFunctor functor;
+  functor.D = &d;
+  functor.B = &b;
+  functor.Y = &y;
+  functor.X = &x;
+  this->Execute( x.size(), functor );
+}
+
+template< typename TValue >
+template< typename TOperator >
+void
+LaplaceVectorKernels< TValue >::ApplyFunctor< TOperator >
+::operator()( SizeValueType, SizeValueType begin, SizeValueType end )
+{
+  Operator->ApplyRange( *X, *Y, begin, end );
+}
+
+template< typename TValue >
+template< typename TOperator >
+void
+LaplaceVectorKernels< TValue >::ApplyAndDotFunctor< TOperator >
+::operator()( SizeValueType block, SizeValueType begin, SizeValueType end )
+{
+  Operator->ApplyRange( *P, *Q, begin, end );
+
+  const VectorType & p = *P;
+  const VectorType & q = *Q;
+  AccumulateType sum = 0.0;
+  for ( SizeValueType i = begin; i < end; ++i )
+    {
+    sum += p[i] * q[i];
+    }
+  BlockSums[block] = sum;
+}
+
+template< typename TValue >
+template< typename TOperator >
+void
+LaplaceVectorKernels< TValue >::ResidualFunctor< TOperator >
+::operator()( SizeValueType block, SizeValueType begin, SizeValueType end )
+{
+  VectorType & r = *R;
+  Operator->ApplyRange( *X, r, begin, end );
+
+  const VectorType & b = *B;
+  AccumulateType sum = 0.0;
+  for ( SizeValueType i = begin; i < end; ++i )
+    {
+    r[i] = b[i] - r[i];
+    sum += r[i] * r[i];
+    }
+  BlockSums[block] = sum;
+}
+
+template< typename TValue >
+void
+LaplaceVectorKernels< TValue >::DotFunctor
+::operator()( SizeValueType block, SizeValueType begin, SizeValueType end )
+{
+  const VectorType & a = *A;
+  const VectorType & b = *B;
+  AccumulateType sum = 0.0;
+  for ( SizeValueType i = begin; i < end; ++i )
+    {
+    sum += a[i] * b[i];
+    }
+  BlockSums[block] = sum;
+}
+
+template< typename TValue >
+void
+LaplaceVectorKernels< TValue >::UpdateSolutionAndResidualFunctor
+::operator()( SizeValueType block, SizeValueType begin, SizeValueType end )
+{
+  const VectorType & p = *P;
+  const VectorType & q = *Q;
+  VectorType & x = *X;
+  VectorType & r = *R;
+  AccumulateType sum = 0.0;
+  for ( SizeValueType i = begin; i < end; ++i )
+    {
+    x[i] += Alpha * p[i];
+    r[i] -= Alpha * q[i];
+    sum += r[i] * r[i];
+    }
+  BlockSums[block] = sum;
+}
+
+template< typename TValue >
+void
+LaplaceVectorKernels< TValue >::UpdateDirectionFunctor
+::operator()( SizeValueType, SizeValueType begin, SizeValueType end )
+{
+  const VectorType & z = *Z;
+  VectorType & p = *P;
+  for ( SizeValueType i = begin; i < end; ++i )
+    {
+    p[i] = z[i] + Beta * p[i];
+    }
+}
+
+template< typename TValue >
+void
+LaplaceVectorKernels< TValue >::CwiseProductFunctor
+::operator()( SizeValueType, SizeValueType begin, SizeValueType end )
+{
+  const VectorType & d = *D;
+  const VectorType & r = *R;
+  VectorType & z = *Z;
+  for ( SizeValueType i = begin; i < end; ++i )
+    {
+    z[i] = d[i] * r[i];
+    }
+}
+
+template< typename TValue >
+void
+LaplaceVectorKernels< TValue >::AddScaledDifferenceFunctor
+::operator()( SizeValueType, SizeValueType begin, SizeValueType end )
+{
+  const VectorType & d = *D;
+  const VectorType & b = *B;
+  const VectorType & y = *Y;
+  VectorType & x = *X;
+  for ( SizeValueType i = begin; i < end; ++i )
+    {
+    x[i] += d[i] * ( b[i] - y[i] );
+    }
+}
+
+} // end namespace itk
+
+#endif
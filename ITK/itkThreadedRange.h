@@ -0,0 +1,168 @@
+#ifndef itkThreadedRange_h_included
+#define itkThreadedRange_h_included
+
+#include <itkExceptionObject.h>
+#include <itkIntTypes.h>
+#include <itkMultiThreader.h>
+
+#include <exception>
+#include <string>
+#include <vector>
+
+
+namespace itk
+{
+
+/** \class ThreadedRange
+ * \brief Runs a functor over contiguous chunks of the range [0, size)
+ * with a local itk::MultiThreader.
+ *
+ * The range is split into a number of chunks whose bounds only
+ * depend on the chunk number, the number of chunks and the size, so
+ * callers can keep per-chunk buffers and combine them in chunk order
+ * to get results that do not depend on thread scheduling. The functor
+ * is called as functor( chunk, begin, end ).
+ *
+ * Exceptions thrown by the functor are caught in the worker threads
+ * and the one from the lowest chunk is rethrown by Execute(). */
+class ThreadedRange
+{
+public:
+  /** Number of chunks to use for one chunk per thread. */
+  static SizeValueType GetNumberOfChunks( ThreadIdType numberOfThreads,
+                                          SizeValueType size )
+  {
+    SizeValueType chunks = numberOfThreads > 0 ? numberOfThreads : 1;
+    if ( size < chunks )
+      {
+      chunks = size > 0 ? size : 1;
+      }
+    return chunks;
+  }
+
+  /** Number of chunks to use for chunks of about chunkSize elements.
+   *  Unlike GetNumberOfChunks(), the chunk bounds do not depend on the
+   *  number of threads. */
+  static SizeValueType GetNumberOfFixedSizeChunks( SizeValueType chunkSize,
+                                                   SizeValueType size )
+  {
+    SizeValueType chunks = ( size + chunkSize - 1 ) / chunkSize;
+    return chunks > 0 ? chunks : 1;
+  }
+
+  /** First element of a chunk. The chunk ends where the next one
+   *  begins. */
+  static SizeValueType GetChunkBegin( SizeValueType chunk,
+                                      SizeValueType numberOfChunks,
+                                      SizeValueType size )
+  {
+    return static_cast< SizeValueType >(
+      ( static_cast< double >( size ) * chunk ) / numberOfChunks );
+  }
+
+  /** Call functor( chunk, begin, end ) for each chunk with one thread
+   *  per chunk. */
+  template< typename TFunctor >
+  static void Execute( SizeValueType numberOfChunks, SizeValueType size,
+                       TFunctor & functor )
+  {
+    Self::Execute( static_cast< ThreadIdType >( numberOfChunks ),
+                   numberOfChunks, size, functor );
+  }
+
+  /** Call functor( chunk, begin, end ) for each chunk. Each thread
+   *  processes a contiguous block of chunks. Runs in the calling
+   *  thread if only one thread is needed. The threads come from a
+   *  threader of its own, so the thread count of a filter's threader
+   *  is never changed. */
+  template< typename TFunctor >
+  static void Execute( ThreadIdType numberOfThreads, SizeValueType numberOfChunks,
+                       SizeValueType size, TFunctor & functor )
+  {
+    if ( numberOfThreads > numberOfChunks )
+      {
+      numberOfThreads = static_cast< ThreadIdType >( numberOfChunks );
+      }
+
+    if ( numberOfThreads <= 1 )
+      {
+      for ( SizeValueType chunk = 0; chunk < numberOfChunks; ++chunk )
+        {
+        functor( chunk, GetChunkBegin( chunk, numberOfChunks, size ),
+                 GetChunkBegin( chunk + 1, numberOfChunks, size ) );
+        }
+      return;
+      }
+
+    ExecuteData< TFunctor > data;
+    data.Functor = &functor;
+    data.NumberOfChunks = numberOfChunks;
+    data.Size = size;
+    data.Errors.resize( numberOfChunks );
+
+    MultiThreader::Pointer threader = MultiThreader::New();
+    threader->SetNumberOfThreads( numberOfThreads );
+    threader->SetSingleMethod( &Self::ThreaderCallback< TFunctor >, &data );
+    threader->SingleMethodExecute();
+
+    for ( SizeValueType chunk = 0; chunk < numberOfChunks; ++chunk )
+      {
+      if ( !data.Errors[chunk].empty() )
+        {
+        itkGenericExceptionMacro( << data.Errors[chunk] );
+        }
+      }
+  }
+
+private:
+  typedef ThreadedRange Self;
+
+  template< typename TFunctor >
+  struct ExecuteData
+  {
+    TFunctor *                 Functor;
+    SizeValueType              NumberOfChunks;
+    SizeValueType              Size;
+    std::vector< std::string > Errors;
+  };
+
+  template< typename TFunctor >
+  static ITK_THREAD_RETURN_TYPE ThreaderCallback( void * arg )
+  {
+    MultiThreader::ThreadInfoStruct * info =
+      static_cast< MultiThreader::ThreadInfoStruct * >( arg );
+    ExecuteData< TFunctor > * data =
+      static_cast< ExecuteData< TFunctor > * >( info->UserData );
+
+    // The threader may run fewer threads than requested, so the
+    // chunks are divided among the threads that actually run.
+    const SizeValueType numberOfChunks = data->NumberOfChunks;
+    const SizeValueType firstChunk =
+      GetChunkBegin( info->ThreadID, info->NumberOfThreads, numberOfChunks );
+    const SizeValueType lastChunk =
+      GetChunkBegin( info->ThreadID + 1, info->NumberOfThreads, numberOfChunks );
+    for ( SizeValueType chunk = firstChunk; chunk < lastChunk; ++chunk )
+      {
+      try
+        {
+        ( *data->Functor )( chunk,
+                            GetChunkBegin( chunk, numberOfChunks, data->Size ),
+                            GetChunkBegin( chunk + 1, numberOfChunks, data->Size ) );
+        }
+      catch ( ExceptionObject & e )
+        {
+        data->Errors[chunk] = e.GetDescription();
+        }
+      catch ( std::exception & e )
+        {
+        data->Errors[chunk] = e.what();
+        }
+      }
+
+    return ITK_THREAD_RETURN_VALUE;
+  }
+};
+
+} // end namespace itk
+
+#endif
@@ -0,0 +1,287 @@
+#include "Profiler.h"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <time.h>
+#endif
+
+namespace
+{
+  // Quote a string for JSON
+  std::string Quote(const std::string & s)
+  {
+    std::string quoted("\"");
+    for (size_t i = 0; i < s.size(); ++i)
+      {
+      char c = s[i];
+      if (c == '"' || c == '\\')
+        {
+        quoted += '\\';
+        quoted += c;
+        }
+      else if (static_cast<unsigned char>(c) < 0x20)
+        {
+        char escaped[8];
+        sprintf(escaped, "\\u%04x", static_cast<unsigned int>(c));
+        quoted += escaped;
+        }
+      else
+        {
+        quoted += c;
+        }
+      }
+    quoted += '"';
+    return quoted;
+  }
+
+  // Whole microseconds for the trace events
+  double Microseconds(double seconds)
+  {
+    return std::floor(seconds * 1e6 + 0.5);
+  }
+}
+
+//----------------------------------------------------------------------------
+Profiler::Profiler()
+{
+  this->Enabled = false;
+  this->StartTime = 0.0;
+}
+
+//----------------------------------------------------------------------------
+Profiler & Profiler::GetInstance()
+{
+  static Profiler profiler;
+  return profiler;
+}
+
+//----------------------------------------------------------------------------
+void Profiler::Start(const std::string & executable, const std::string & fileName)
+{
+  this->Enabled = !fileName.empty();
+  this->Executable = executable;
+  this->FileName = fileName;
+  this->StartTime = GetTime();
+  this->Stages.clear();
+  this->OpenStages.clear();
+  this->Counters.clear();
+}
+
+//----------------------------------------------------------------------------
+void Profiler::BeginStage(const std::string & name)
+{
+  if (!this->Enabled)
+    {
+    return;
+    }
+
+  Stage stage;
+  stage.Name = name;
+  stage.Depth = static_cast<int>(this->OpenStages.size());
+  stage.Start = GetTime() - this->StartTime;
+  stage.Duration = 0.0;
+  stage.PeakResidentSetSize = 0.0;
+  this->OpenStages.push_back(this->Stages.size());
+  this->Stages.push_back(stage);
+}
+
+//----------------------------------------------------------------------------
+void Profiler::EndStage()
+{
+  if (!this->Enabled || this->OpenStages.empty())
+    {
+    return;
+    }
+
+  Stage & stage = this->Stages[this->OpenStages.back()];
+  this->OpenStages.pop_back();
+  stage.Duration = GetTime() - this->StartTime - stage.Start;
+  stage.PeakResidentSetSize = GetPeakResidentSetSize();
+}
+
+//----------------------------------------------------------------------------
+void Profiler::SetCounter(const std::string & name, double value)
+{
+  if (!this->Enabled)
+    {
+    return;
+    }
+
+  for (size_t i = 0; i < this->Counters.size(); ++i)
+    {
+    if (this->Counters[i].first == name)
+      {
+      this->Counters[i].second = value;
+      return;
+      }
+    }
+  this->Counters.push_back(std::make_pair(name, value));
+}
+
+//----------------------------------------------------------------------------
+void Profiler::AddToCounter(const std::string & name, double value)
+{
+  if (!this->Enabled)
+    {
+    return;
+    }
+
+  for (size_t i = 0; i < this->Counters.size(); ++i)
+    {
+    if (this->Counters[i].first == name)
+      {
+      this->Counters[i].second += value;
+      return;
+      }
+    }
+  this->Counters.push_back(std::make_pair(name, value));
+}
+
+//----------------------------------------------------------------------------
+bool Profiler::Write()
+{
+  if (!this->Enabled)
+    {
+    return true;
+    }
+
+  while (!this->OpenStages.empty())
+    {
+    this->EndStage();
+    }
+
+  double wallTime = GetTime() - this->StartTime;
+  double peakResidentSetSize = GetPeakResidentSetSize();
+
+  std::ostringstream json;
+  json.precision(17);
+  json << "{\n";
+  json << "  \"executable\": " << Quote(this->Executable) << ",\n";
+  json << "  \"wallTime\": " << wallTime << ",\n";
+  json << "  \"peakResidentSetSize\": " << peakResidentSetSize << ",\n";
+
+  json << "  \"stages\": [";
+  for (size_t i = 0; i < this->Stages.size(); ++i)
+    {
+    const Stage & stage = this->Stages[i];
+    json << (i > 0 ? ",\n" : "\n")
+         << "    { \"name\": " << Quote(stage.Name)
+         << ", \"depth\": " << stage.Depth
+         << ", \"start\": " << stage.Start
+         << ", \"duration\": " << stage.Duration
+         << ", \"peakResidentSetSize\": " << stage.PeakResidentSetSize << " }";
+    }
+  json << "\n  ],\n";
+
+  json << "  \"counters\": {";
+  for (size_t i = 0; i < this->Counters.size(); ++i)
+    {
+    json << (i > 0 ? ",\n" : "\n")
+         << "    " << Quote(this->Counters[i].first) << ": " << this->Counters[i].second;
+    }
+  json << "\n  },\n";
+
+  // Chrome trace: a complete event per stage and the peak resident
+  // set size as a counter track
+  json << "  \"displayTimeUnit\": \"ms\",\n";
+  json << "  \"traceEvents\": [";
+  json << "\n    { \"name\": \"process_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": 0"
+       << ", \"args\": { \"name\": " << Quote(this->Executable) << " } }";
+  for (size_t i = 0; i < this->Stages.size(); ++i)
+    {
+    const Stage & stage = this->Stages[i];
+    json << ",\n    { \"name\": " << Quote(stage.Name)
+         << ", \"cat\": \"stage\", \"ph\": \"X\", \"pid\": 0, \"tid\": 0"
+         << ", \"ts\": " << Microseconds(stage.Start)
+         << ", \"dur\": " << Microseconds(stage.Duration) << " }";
+    json << ",\n    { \"name\": \"peak resident set size\", \"ph\": \"C\", \"pid\": 0, \"tid\": 0"
+         << ", \"ts\": " << Microseconds(stage.Start + stage.Duration)
+         << ", \"args\": { \"bytes\": " << stage.PeakResidentSetSize << " } }";
+    }
+  json << "\n  ]\n";
+  json << "}\n";
+
+  std::ofstream file(this->FileName.c_str());
+  if (!file)
+    {
+    std::cerr << "Could not write profile '" << this->FileName << "'\n";
+    return false;
+    }
+  file << json.str();
+  return static_cast<bool>(file);
+}
+
+//----------------------------------------------------------------------------
+double Profiler::GetTime()
+{
+#if defined(_WIN32)
+  LARGE_INTEGER frequency, counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  return static_cast<double>(counter.QuadPart) / static_cast<double>(frequency.QuadPart);
+#else
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + 1e-9 * t.tv_nsec;
+#endif
+}
+
+//----------------------------------------------------------------------------
+double Profiler::GetPeakResidentSetSize()
+{
+#if defined(_WIN32)
+  PROCESS_MEMORY_COUNTERS counters;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+    return static_cast<double>(counters.PeakWorkingSetSize);
+    }
+  return 0.0;
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+    return 0.0;
+    }
+#if defined(__APPLE__)
+  // Bytes on macOS, kilobytes elsewhere
+  return static_cast<double>(usage.ru_maxrss);
+#else
+  return 1024.0 * static_cast<double>(usage.ru_maxrss);
+#endif
+#endif
+}
+
+//----------------------------------------------------------------------------
+ProfileTimer::ProfileTimer(const std::string & name)
+{
+  Profiler::GetInstance().BeginStage(name);
+}
+
+//----------------------------------------------------------------------------
+ProfileTimer::~ProfileTimer()
+{
+  Profiler::GetInstance().EndStage();
+}
+
+//----------------------------------------------------------------------------
+ProfileSession::ProfileSession(const std::string & executable,
+                               const std::string & fileName)
+{
+  Profiler::GetInstance().Start(executable, fileName);
+  Profiler::GetInstance().BeginStage(executable);
+}
+
+//----------------------------------------------------------------------------
+ProfileSession::~ProfileSession()
+{
+  Profiler::GetInstance().Write();
+}
@@ -0,0 +1,116 @@
+#ifndef Profiler_h
+#define Profiler_h
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// Description:
+// Records where a command line module spends its time: the wall time
+// of nested stages, the peak resident set size at the end of each
+// stage, and counters such as the number of voxels or contours.
+//
+// The results are written as one JSON file that is both a summary for
+// scripts ("stages", "counters", "peakResidentSetSize") and a Chrome
+// trace ("traceEvents") that chrome://tracing or Perfetto can open.
+//
+// There is one profiler per process. It is disabled unless a
+// ProfileSession gives it a file name, and then costs a few branches
+// per stage. Stages and counters must be recorded from the main
+// thread.
+class Profiler
+{
+public:
+  // Description:
+  // Get the profiler of the process.
+  static Profiler & GetInstance();
+
+  // Description:
+  // Start recording for the named executable. Results are written to
+  // fileName by Write(). An empty file name disables the profiler.
+  void Start(const std::string & executable, const std::string & fileName);
+
+  bool GetEnabled() const { return this->Enabled; }
+
+  // Description:
+  // Begin a stage nested in the current one, and end the current
+  // stage. Prefer ProfileTimer, which ends the stage on every return
+  // path.
+  void BeginStage(const std::string & name);
+  void EndStage();
+
+  // Description:
+  // Set a counter, or add to it. Counters are written in the order
+  // they are first set.
+  void SetCounter(const std::string & name, double value);
+  void AddToCounter(const std::string & name, double value);
+
+  // Description:
+  // End the open stages and write the results. Returns false, after
+  // printing why, if the file cannot be written. Does nothing if the
+  // profiler is disabled.
+  bool Write();
+
+  // Description:
+  // Wall clock time in seconds since an arbitrary origin, from a
+  // monotonic clock that system time changes do not affect.
+  static double GetTime();
+
+  // Description:
+  // Peak resident set size of the process in bytes so far, or 0 where
+  // it cannot be queried.
+  static double GetPeakResidentSetSize();
+
+private:
+  Profiler();
+  Profiler(const Profiler&); // Not implemented
+  void operator=(const Profiler&); // Not implemented
+
+  struct Stage
+  {
+    std::string Name;
+    int         Depth;
+    double      Start;
+    double      Duration;
+    double      PeakResidentSetSize;
+  };
+
+  bool                                         Enabled;
+  std::string                                  Executable;
+  std::string                                  FileName;
+  double                                       StartTime;
+  std::vector<Stage>                           Stages;
+  std::vector<size_t>                          OpenStages;
+  std::vector< std::pair<std::string, double> > Counters;
+};
+
+// Description:
+// Records a stage of the profiler from construction to destruction.
+class ProfileTimer
+{
+public:
+  explicit ProfileTimer(const std::string & name);
+  ~ProfileTimer();
+
+private:
+  ProfileTimer(const ProfileTimer&); // Not implemented
+  void operator=(const ProfileTimer&); // Not implemented
+};
+
+// Description:
+// Profiles a command line module: starts the profiler if fileName is
+// not empty, records the whole run as a stage named after the
+// executable, and writes the results when it goes out of scope. Meant
+// to be the first object of main().
+class ProfileSession
+{
+public:
+  ProfileSession(const std::string & executable, const std::string & fileName);
+  ~ProfileSession();
+
+private:
+  ProfileSession(const ProfileSession&); // Not implemented
+  void operator=(const ProfileSession&); // Not implemented
+};
+
+#endif // Profiler_h
@@ -19,6 +19,7 @@
 #include "itkImageFileReader.h"
 
 #include <vtkClipPolyData.h>
+#include <vtkPolyData.h>
 #include <vtkXMLPolyDataReader.h>
 #include <vtkXMLPolyDataWriter.h>
 #include <vtkSphere.h>
@@ -26,6 +27,7 @@
 
 #include "../ITK/itkRasterizeSphereImageFilter.h"
 #include "RemoveSphereCLP.h"
+#include "Profiler.h"
 
 // Use an anonymous namespace to keep class types and function names
 // from colliding when module is used as shared object module.  Every
@@ -89,14 +91,25 @@ int DoIt( int argc, char * argv[], T )
   writer->SetFileName( outputImage.c_str() );
   writer->SetUseCompression(1);
 
+  {
+    ProfileTimer timer( "read image" );
+    reader->Update();
+  }
+  Profiler::GetInstance().SetCounter( "voxels",
+    reader->GetOutput()->GetLargestPossibleRegion().GetNumberOfPixels() );
+
   // Setup the boundary method
   sphere->SetInput(  reader->GetOutput() );
-  sphere->Update();
+  {
+    ProfileTimer timer( "remove sphere" );
+    sphere->Update();
+  }
   // Write the output
   writer->SetInput( sphere->GetOutput() );
 
   try
     {
+    ProfileTimer timer( "write image" );
     writer->Update();
     writer->Write();
     }
@@ -126,7 +139,12 @@ int DoIt( int argc, char * argv[], T )
     vtkSmartPointer<vtkXMLPolyDataWriter>::New();
   surfaceWriter->SetFileName( outputGeometry.c_str() );
   surfaceWriter->SetInputConnection( clipper->GetOutputPort() );
-  surfaceWriter->Update();
+  {
+    ProfileTimer timer( "clip surface" );
+    surfaceWriter->Update();
+  }
+  Profiler::GetInstance().SetCounter( "surface cells",
+    surfaceReader->GetOutput()->GetNumberOfCells() );
 
   return EXIT_SUCCESS;
 }
@@ -138,6 +156,8 @@ int main( int argc, char * argv[] )
   // DoIt(argc, argv);
   PARSE_ARGS;
 
+  ProfileSession profileSession( "RemoveSphere", profile );
+
 
   itk::ImageIOBase::IOPixelType     pixelType;
   itk::ImageIOBase::IOComponentType componentType;
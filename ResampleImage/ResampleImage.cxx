@@ -3,6 +3,7 @@
 #endif
 
 #include "ResampleImageCLP.h"
+#include "Profiler.h"
 
 #include <itkBSplineInterpolateImageFunction.h>
 #include <itkIdentityTransform.h>
@@ -57,6 +58,7 @@ int DoIt(int argc, char* argv[], T)
   inputReader->SetFileName( inputImage.c_str() );
   try
     {
+    ProfileTimer timer( "read image" );
     inputReader->Update();
     }
   catch ( itk::ExceptionObject & except )
@@ -67,6 +69,8 @@ int DoIt(int argc, char* argv[], T)
     }
 
   typename ImageType::Pointer input = inputReader->GetOutput();
+  Profiler::GetInstance().SetCounter( "voxels",
+    input->GetLargestPossibleRegion().GetNumberOfPixels() );
 
   typedef double InterpolatorPrecision;
   typedef itk::ResampleImageFilter< ImageType, ImageType, InterpolatorPrecision >
@@ -134,6 +138,11 @@ int DoIt(int argc, char* argv[], T)
   outputWriter->SetInput( resampler->GetOutput() );
   try
     {
+    {
+      ProfileTimer timer( "resample" );
+      resampler->Update();
+    }
+    ProfileTimer timer( "write image" );
     outputWriter->Update();
     }
   catch ( itk::ExceptionObject & except )
@@ -143,6 +152,9 @@ int DoIt(int argc, char* argv[], T)
     return EXIT_FAILURE;
     }
 
+  Profiler::GetInstance().SetCounter( "output voxels",
+    resampler->GetOutput()->GetLargestPossibleRegion().GetNumberOfPixels() );
+
   return EXIT_SUCCESS;
 }
 
@@ -151,6 +163,8 @@ int main( int argc, char* argv[] )
 {
   PARSE_ARGS;
 
+  ProfileSession profileSession( "ResampleImage", profile );
+
   itk::ImageIOBase::IOPixelType     pixelType;
   itk::ImageIOBase::IOComponentType componentType;
 
@@ -153,7 +153,8 @@ int main(int argc, char *argv[])
   assert(normals);
   double *sectionNormal = normals->GetTuple3(index);
 
-  // Compute the cut plane
+  // Compute the cut plane. The projection on the cross-section plane
+  // does not depend on the length or sign of its normal.
   double projected[3] = { 0.0 };
   vtkPlane::GeneralizedProjectPoint(noseTip, epiglottisTip, sectionNormal,
       projected);
@@ -17,6 +17,7 @@
 =============================================================================*/
 
 #include "ThresholdLaplaceSolutionCLP.h"
+#include "Profiler.h"
 
 #include <itkImage.h>
 #include <itkImageFileReader.h>
@@ -24,6 +25,7 @@
 
 #include <vtkSmartPointer.h>
 #include <vtkThreshold.h>
+#include <vtkUnstructuredGrid.h>
 #include <vtkXMLUnstructuredGridWriter.h>
 
 namespace
@@ -71,10 +73,15 @@ int DoIt( int argc, char* argv[], T )
   typedef itk::ImageFileReader< HeatFlowImageType > HeatFlowReaderType;
   typename HeatFlowReaderType::Pointer heatFlowReader = HeatFlowReaderType::New();
   heatFlowReader->SetFileName( heatFlowImage.c_str() );
-  heatFlowReader->Update();
+  {
+    ProfileTimer timer( "read heat flow image" );
+    heatFlowReader->Update();
+  }
 
   typename HeatFlowImageType::Pointer originalImage =
     heatFlowReader->GetOutput();
+  Profiler::GetInstance().SetCounter( "voxels",
+    originalImage->GetLargestPossibleRegion().GetNumberOfPixels() );
 
   // First verify that image is in LPS orientation
   typename HeatFlowImageType::DirectionType originalImageDirection =
@@ -112,7 +119,14 @@ int DoIt( int argc, char* argv[], T )
   threshold->ThresholdBetween(0.0, 1.0);
   threshold->AllScalarsOff();
   threshold->SetInputData( itk2vtkFilter->GetOutput() );
+  {
+    ProfileTimer timer( "threshold" );
+    threshold->Update();
+  }
+  Profiler::GetInstance().SetCounter( "grid cells",
+    threshold->GetOutput()->GetNumberOfCells() );
 
+  ProfileTimer timer( "write grid" );
   vtkSmartPointer<vtkXMLUnstructuredGridWriter> writer =
     vtkSmartPointer<vtkXMLUnstructuredGridWriter>::New();
   writer->SetFileName(thresholdOutput.c_str());
@@ -129,6 +143,8 @@ int main( int argc, char* argv[])
 {
   PARSE_ARGS;
 
+  ProfileSession profileSession( "ThresholdLaplaceSolution", profile );
+
   itk::ImageIOBase::IOPixelType     inputPixelType;
   itk::ImageIOBase::IOComponentType inputComponentType;
 
@@ -39,16 +39,59 @@ def ExtractArgs(LandmarksFile):
                  landmarks['TracheaCarina'], list(trachVectorHead)])
     return args
 
+#############################################################################
+def ReadMetaImageGrid(imagePath):
+    # Read the size, spacing, origin and direction of a MetaImage from
+    # its header. Returns None if the file is not a readable MetaImage.
+    aliases = {'Position' : 'Offset', 'Origin' : 'Offset',
+               'Orientation' : 'TransformMatrix', 'Rotation' : 'TransformMatrix'}
+    gridKeys = ['NDims', 'DimSize', 'ElementSpacing', 'Offset', 'TransformMatrix']
+
+    grid = {}
+    try:
+        with open(imagePath, 'rb') as f:
+            for line in f:
+                if line.find('=') < 0:
+                    return None
+                key, value = [x.strip() for x in line.split('=', 1)]
+                key = aliases.get(key, key)
+                if (gridKeys.count(key) > 0):
+                    grid[key] = [float(x) for x in value.split()]
+                # The header ends with the data file
+                if (key == 'ElementDataFile'):
+                    break
+    except (IOError, ValueError):
+        return None
+
+    if (not grid.has_key('DimSize')):
+        return None
+    return grid
+
+#############################################################################
+def HaveSameGrid(grid1, grid2):
+    if (grid1 is None or grid2 is None):
+        return False
+    if (sorted(grid1.keys()) != sorted(grid2.keys())):
+        return False
+    for key in grid1.keys():
+        if (len(grid1[key]) != len(grid2[key])):
+            return False
+        for a, b in zip(grid1[key], grid2[key]):
+            if (abs(a - b) > 1e-6 * max(1.0, abs(a), abs(b))):
+                return False
+    return True
+
 #############################################################################
 def main():
     if len(sys.argv) < 5:
-        sys.stdout.write('Usage: %s <executable> <mouth removed image> <landmarks file> <output image> \n' % sys.argv[0])
+        sys.stdout.write('Usage: %s <executable> <mouth removed image> <landmarks file> <output image> [--warmStart]\n' % sys.argv[0])
         sys.exit(-1)
 
     executable        = sys.argv[1]
     inputImagePath    = sys.argv[2]
     landmarksFilePath = sys.argv[3]
     outputImagePath   = sys.argv[4]
+    warmStart         = '--warmStart' in sys.argv[5:]
 
     try:
         args = ExtractArgs(landmarksFilePath)
@@ -64,6 +107,18 @@ def main():
             "--tracheaVectorHead", ','.join([str(x) for x in args[3][:3]])
         ])
 
+        # Start from the previous solution only when asked to, e.g.,
+        # when rerunning after a landmark was moved. The previous
+        # output must be on the same grid as the input image, which
+        # changes if the image was segmented or cropped again.
+        if warmStart and os.path.exists(outputImagePath):
+            if HaveSameGrid(ReadMetaImageGrid(inputImagePath),
+                            ReadMetaImageGrid(outputImagePath)):
+                call.extend(["--initialSolution", outputImagePath])
+            else:
+                sys.stdout.write('Previous solution "%s" is not on the grid of "%s", starting from zero\n'
+                                 % (outputImagePath, inputImagePath))
+
         with time_limit(3600):
             sub.call( call )
 
@@ -136,7 +136,9 @@ def AddRemoveMouthStep(pipeline, scanId):
 
 #############################################################################
 def AddComputeLaplaceSolutionStep(pipeline, scanId):
-    # Laplace solution step
+    # Laplace solution step. When the step is rerun, e.g. after a
+    # landmark was moved, the solver starts from the previous
+    # _HEATFLOW.mha if it is on the grid of the input image.
     root = os.path.join(rootPath, scanId, scanId)
 
     cmd = [python,
@@ -144,14 +146,18 @@ def AddComputeLaplaceSolutionStep(pipeline, scanId):
            wf.infile(os.path.join(executablePath, 'ComputeLaplaceSolution')),
            wf.infile(root + '_MOUTH_REMOVED.mha'),
            wf.infile(root + '_LANDMARKS.fcsv'),
-           wf.outfile(root + '_HEATFLOW.mha')]
+           wf.outfile(root + '_HEATFLOW.mha'),
+           '--warmStart']
     laplaceCalculationStep = wf.CLIWorkflowStep('LaplaceCalculation-' + scanId, cmd)
 
     pipeline.AddStep(laplaceCalculationStep)
 
 #############################################################################
 def AddThresholdLaplaceSolutionStep(pipeline, scanId):
-    # Threshold the heatflow solution to only valid range [0, 1]
+    # Threshold the heatflow solution to only valid range [0, 1].
+    # Together with the heat contour step this is only used to inspect
+    # the contours; ComputeCrossSections contours the heatflow image
+    # in memory.
     root = os.path.join(rootPath, scanId, scanId)
     cmd = [os.path.join(executablePath, 'ThresholdLaplaceSolution'),
            wf.infile(root + '_HEATFLOW.mha'),
@@ -174,7 +180,7 @@ def AddComputeCrossSectionsStep(pipeline, scanId):
     # Full cross-section computation step
     root = os.path.join(rootPath, scanId, scanId)
     cmd = [os.path.join(executablePath, 'ComputeCrossSections'),
-           wf.infile(root + '_HEATFLOW_CROSS_SECTIONS.vtp'),
+           wf.infile(root + '_HEATFLOW.mha'),
            wf.infile(root + '_MOUTH_REMOVED.vtp'),
            wf.outfile(root + '_ALL_CROSS_SECTIONS.vtp'),
            wf.outfile(root + '_ALL_CROSS_SECTIONS.csv')]
@@ -270,8 +276,6 @@ def ProcessScan(scanId):
     AddExtractSpheresStep(pipeline, scanId)
     AddRemoveMouthStep(pipeline, scanId)
     AddComputeLaplaceSolutionStep(pipeline, scanId)
-    AddThresholdLaplaceSolutionStep(pipeline, scanId)
-    AddComputeHeatContoursStep(pipeline, scanId)
     AddComputeCrossSectionsStep(pipeline, scanId)
     AddExtractLandmarkCrossSectionsStep(pipeline, scanId)
     AddSplitEpiglottisCrossSectionStep(pipeline, scanId)